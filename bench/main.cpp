@@ -18,17 +18,32 @@ s file is part of cpp-ethereum.
  * @date 2014
  * RLP tool.
  */
+#include <atomic>
+#include <bitset>
 #include <clocale>
+#include <cstdlib>
 #include <fstream>
+#include <new>
+#include <thread>
 #include <iostream>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <json_spirit/JsonSpiritHeaders.h>
+#include <libdevcore/AsyncLog.h>
 #include <libdevcore/CommonIO.h>
 #include <libdevcore/RLP.h>
 #include <libdevcore/SHA3.h>
+#include <libdevcore/Keccak.h>
 #include <libdevcore/MemoryDB.h>
+#include <libdevcore/ShardedMemoryDB.h>
+#include <libdevcore/DatabaseFace.h>
+#include <libdevcore/MemoryDatabase.h>
+#include <libdevcore/OverlayDB.h>
 #include <libdevcore/TrieDB.h>
+#include <libdevcore/DeferredTrieDB.h>
+#include <libdevcore/TrieHash.h>
+#include <libdevcore/ParallelFor.h>
+#include <libdevcore/Uint256.h>
 #include <libdevcrypto/Common.h>
 #include <libdevcrypto/CryptoPP.h>
 using namespace std;
@@ -41,6 +56,14 @@ void help()
 		<< "Usage bench <mode> [OPTIONS]" << endl
 		<< "Modes:" << endl
 		<< "    trie  Trie benchmarks." << endl
+		<< "    sha3  Keccak-256 benchmarks, per kernel." << endl
+		<< "    memdb  Node store benchmarks (MemoryDB vs ShardedMemoryDB)." << endl
+		<< "    db  Storage engine benchmarks (LevelDB/RocksDB, memory, mmap)." << endl
+		<< "    commit  Trie commit benchmarks (sequential vs batched/parallel vs deferred)." << endl
+		<< "    log  Logging benchmarks (synchronous vs asynchronous, streams vs records)." << endl
+		<< "    hash  FixedHash benchmarks (comparison, bit operations, blooms and hashing, bytewise vs vectorised)." << endl
+		<< "    locks  Shared lock benchmarks (reader-biased vs boost::shared_mutex, contention profile)." << endl
+		<< "    u256  256-bit arithmetic benchmarks (EVM operations and storage maps, u256 vs uint256)." << endl
 		<< endl
 		<< "General options:" << endl
 		<< "    -h,--help  Print this help message and exit." << endl
@@ -80,9 +103,274 @@ void setDefaultOrCLocale()
 
 enum class Mode {
 	Trie,
-	SHA3
+	SHA3,
+	MemDB,
+	DB,
+	Commit,
+	Log,
+	Locks,
+	Hash,
+	U256
 };
 
+/// Live heap bytes, so that node stores can be compared on footprint.
+static std::atomic<size_t> s_heapBytes{0};
+static std::atomic<size_t> s_heapAllocs{0};
+
+void* operator new(size_t _n)
+{
+	// Prefix each block with its size so that delete can account for it.
+	size_t* p = (size_t*)std::malloc(_n + sizeof(max_align_t));
+	if (!p)
+		throw std::bad_alloc();
+	*p = _n;
+	s_heapBytes += _n;
+	s_heapAllocs++;
+	return (char*)p + sizeof(max_align_t);
+}
+
+void operator delete(void* _p) noexcept
+{
+	if (!_p)
+		return;
+	size_t* p = (size_t*)((char*)_p - sizeof(max_align_t));
+	s_heapBytes -= *p;
+	std::free(p);
+}
+
+void operator delete(void* _p, size_t) noexcept
+{
+	operator delete(_p);
+}
+
+template <class DB> void benchMemDB(char const* _name, vector<pair<h256, bytes>> const& _nodes)
+{
+	size_t heapBefore = s_heapBytes;
+	size_t allocsBefore = s_heapAllocs;
+	DB db;
+	Timer t;
+	for (auto const& n: _nodes)
+		db.insert(n.first, &n.second);
+	double insertTime = t.elapsed();
+	size_t heapUsed = s_heapBytes - heapBefore;
+	size_t allocs = s_heapAllocs - allocsBefore;
+
+	t.restart();
+	size_t found = 0;
+	for (auto const& n: _nodes)
+		found += db.lookup(n.first).size();
+	double lookupTime = t.elapsed();
+
+	t.restart();
+	for (size_t i = 0; i < _nodes.size(); i += 2)
+		db.kill(_nodes[i].first);
+	db.purge();
+	double killTime = t.elapsed();
+
+	cout << _name << ": "
+		<< (unsigned)(_nodes.size() / insertTime) << " inserts/s, "
+		<< (unsigned)(_nodes.size() / lookupTime) << " lookups/s, "
+		<< (unsigned)(_nodes.size() / killTime) << " kills/s (incl. purge), "
+		<< heapUsed / _nodes.size() << " bytes/node, "
+		<< (double)allocs / _nodes.size() << " allocs/node, "
+		<< db.keys().size() << " left"
+		<< (found ? "" : " !") << endl;
+}
+
+template <class DB> void benchMemDBThreaded(char const* _name, vector<pair<h256, bytes>> const& _nodes, unsigned _threads)
+{
+	DB db;
+	Timer t;
+	vector<thread> ts;
+	for (unsigned ti = 0; ti < _threads; ++ti)
+		ts.push_back(thread([&, ti]()
+		{
+			for (size_t i = ti; i < _nodes.size(); i += _threads)
+				db.insert(_nodes[i].first, &_nodes[i].second);
+		}));
+	for (auto& th: ts)
+		th.join();
+	cout << _name << " x" << _threads << " threads: " << (unsigned)(_nodes.size() / t.elapsed()) << " inserts/s" << endl;
+}
+
+/// The trie read path as it was before NodeRef: a copy of every node on the way down, plus the result.
+template <class DB> string copyingAt(DB const& _db, RLP const& _here, NibbleSlice _key)
+{
+	if (_here.isEmpty() || _here.isNull())
+		return string();
+	if (_here.itemCount() == 2)
+	{
+		auto k = keyOf(_here);
+		if (_key == k && isLeaf(_here))
+			return _here[1].toString();
+		if (!_key.contains(k) || isLeaf(_here))
+			return string();
+		if (_here[1].isList())
+			return copyingAt(_db, _here[1], _key.mid(k.size()));
+		string n = _db.lookup(_here[1].toHash<h256>());
+		return copyingAt(_db, RLP(n), _key.mid(k.size()));
+	}
+	if (_key.size() == 0)
+		return _here[16].toString();
+	RLP c = _here[_key[0]];
+	if (c.isEmpty())
+		return string();
+	if (c.isList())
+		return copyingAt(_db, c, _key.mid(1));
+	string n = _db.lookup(c.toHash<h256>());
+	return copyingAt(_db, RLP(n), _key.mid(1));
+}
+
+/// Allocations per state-style (32-byte key) lookup: copying walk vs at() vs atRef().
+template <class DB> void benchTrieReads(char const* _name, DB& _db, vector<pair<bytes, bytes>> const& _entries, h256 const& _root)
+{
+	GenericTrieDB<DB> t(&_db, _root);
+	size_t found = 0;
+	auto measure = [&](char const* _what, std::function<size_t(bytes const&)> const& _f)
+	{
+		size_t allocsBefore = s_heapAllocs;
+		Timer timer;
+		for (auto const& e: _entries)
+			found += _f(e.first);
+		double elapsed = timer.elapsed();
+		cout << "  " << _what << ": " << (double)(s_heapAllocs - allocsBefore) / _entries.size() << " allocs/lookup, "
+			<< (unsigned)(_entries.size() / elapsed) << " lookups/s" << endl;
+	};
+	cout << _name << ":" << endl;
+	measure("copying walk", [&](bytes const& _k) { string r = _db.lookup(_root); return copyingAt(_db, RLP(r), NibbleSlice(&_k)).size(); });
+	measure("at()", [&](bytes const& _k) { return t.at(&_k).size(); });
+	measure("atRef()", [&](bytes const& _k) { return t.atRef(&_k).size(); });
+	if (!found)
+		cout << "  !" << endl;
+}
+
+/// FixedHash<N> operations against the byte loops they replaced.
+template <unsigned N> void benchFixedHash(char const* _name)
+{
+	using H = FixedHash<N>;
+	vector<H> hs(1024);
+	h256 seed = sha3(_name);
+	for (auto& h: hs)
+		for (unsigned i = 0; i < N; ++i)
+		{
+			if (i % 32 == 0)
+				seed = sha3(seed);
+			h[i] = seed[i % 32];
+		}
+	// Half of the pairs equal up to the last byte, as with sorted keys or repeated lookups.
+	for (unsigned i = 0; i < hs.size(); i += 2)
+	{
+		hs[i + 1] = hs[i];
+		hs[i + 1][N - 1] ^= 1;
+	}
+
+	unsigned const rounds = 1000000 / N;
+	size_t sink = 0;
+	auto measure = [&](std::function<size_t(H&, H const&)> const& _f)
+	{
+		Timer t;
+		for (unsigned r = 0; r < rounds; ++r)
+			for (unsigned i = 0; i + 1 < hs.size(); i += 2)
+				sink += _f(hs[i], hs[i + 1]);
+		return t.elapsed() / (rounds * hs.size() / 2) * 1e9;
+	};
+	auto compare = [&](char const* _op, std::function<size_t(H&, H const&)> const& _bytewise, std::function<size_t(H&, H const&)> const& _current)
+	{
+		double b = measure(_bytewise);
+		double c = measure(_current);
+		cout << "  " << _op << ": bytewise " << b << " ns, now " << c << " ns (" << b / c << "x)" << endl;
+	};
+
+	cout << _name << ":" << endl;
+	compare("==", [](H& _a, H const& _b) { return _a.asArray() == _b.asArray(); }, [](H& _a, H const& _b) { return _a == _b; });
+	compare("<", [](H& _a, H const& _b) { for (unsigned i = 0; i < N; ++i) if (_a[i] != _b[i]) return _a[i] < _b[i]; return false; }, [](H& _a, H const& _b) { return _a < _b; });
+	compare("|=", [](H& _a, H const& _b) { for (unsigned i = 0; i < N; ++i) _a[i] |= _b[i]; return _a[0]; }, [](H& _a, H const& _b) { return (_a |= _b)[0]; });
+	compare("contains", [](H& _a, H const& _b) { H c = _a; for (unsigned i = 0; i < N; ++i) c[i] &= _b[i]; return c.asArray() == _b.asArray(); }, [](H& _a, H const& _b) { return _a.contains(_b); });
+	compare("popcount", [](H& _a, H const&) { size_t r = 0; for (unsigned i = 0; i < N; ++i) r += bitset<8>(_a[i]).count(); return r; }, [](H& _a, H const&) { return _a.popcount(); });
+	compare("hash", [](H& _a, H const&) { return boost::hash_range(_a.asArray().cbegin(), _a.asArray().cend()); }, [](H& _a, H const&) { return typename H::hash()(_a); });
+	if (!sink)
+		cout << "  !" << endl;
+}
+
+/// The EVM's arithmetic, as the interpreter did it on u256 and as it does on uint256, over operands of
+/// all sizes: small constants, 64-bit values, addresses and full 256-bit words.
+void benchUint256()
+{
+	vector<u256> us(1024);
+	h256 seed;
+	for (size_t i = 0; i < us.size(); ++i)
+	{
+		seed = sha3(seed);
+		u256 v(seed);
+		switch (i % 4)
+		{
+		case 0: us[i] = v % 1000 + 1; break;
+		case 1: us[i] = v >> 192; break;
+		case 2: us[i] = v >> 96; break;
+		default: us[i] = v; break;
+		}
+	}
+	vector<uint256> ws(us.begin(), us.end());
+
+	unsigned const rounds = 300;
+	size_t const ops = rounds * (us.size() - 2);
+	auto compare = [&](char const* _op, auto const& _u, auto const& _w)
+	{
+		u256 uSink = 0;
+		Timer t;
+		for (unsigned r = 0; r < rounds; ++r)
+			for (size_t i = 0; i + 2 < us.size(); ++i)
+				uSink ^= _u(&us[i]);
+		double u = t.elapsed() / ops * 1e9;
+		uint256 wSink = 0;
+		t.restart();
+		for (unsigned r = 0; r < rounds; ++r)
+			for (size_t i = 0; i + 2 < ws.size(); ++i)
+				wSink ^= _w(&ws[i]);
+		double w = t.elapsed() / ops * 1e9;
+		cout << "  " << _op << ": u256 " << u << " ns, uint256 " << w << " ns (" << u / w << "x)" << (uSink == u256(wSink) ? "" : " MISMATCH") << endl;
+	};
+
+	cout << "EVM arithmetic:" << endl;
+	compare("ADD", [](u256 const* _s) { return _s[0] + _s[1]; }, [](uint256 const* _s) { return _s[0] + _s[1]; });
+	compare("MUL", [](u256 const* _s) { return _s[0] * _s[1]; }, [](uint256 const* _s) { return _s[0] * _s[1]; });
+	compare("DIV", [](u256 const* _s) { return _s[1] ? _s[0] / _s[1] : 0; }, [](uint256 const* _s) { return _s[0] / _s[1]; });
+	compare("MOD", [](u256 const* _s) { return _s[1] ? _s[0] % _s[1] : 0; }, [](uint256 const* _s) { return _s[0] % _s[1]; });
+	compare("SDIV", [](u256 const* _s) { return _s[1] ? s2u(s256(s512(u2s(_s[0])) / s512(u2s(_s[1])))) : 0; }, [](uint256 const* _s) { return sdiv(_s[0], _s[1]); });
+	compare("ADDMOD", [](u256 const* _s) { return _s[2] ? u256((u512(_s[0]) + u512(_s[1])) % _s[2]) : 0; }, [](uint256 const* _s) { return addmod(_s[0], _s[1], _s[2]); });
+	compare("MULMOD", [](u256 const* _s) { return _s[2] ? u256((u512(_s[0]) * u512(_s[1])) % _s[2]) : 0; }, [](uint256 const* _s) { return mulmod(_s[0], _s[1], _s[2]); });
+	compare("EXP", [](u256 const* _s) { u256 r = 1, b = _s[0]; for (u256 e = _s[1] & 0xffff; e; e >>= 1) { if (e & 1) r *= b; b *= b; } return r; }, [](uint256 const* _s) { return exp(_s[0], _s[1] & 0xffff); });
+	compare("LT", [](u256 const* _s) { return u256(_s[0] < _s[1] ? 1 : 0); }, [](uint256 const* _s) { return uint256(_s[0] < _s[1] ? 1 : 0); });
+	compare("SLT", [](u256 const* _s) { return u256(u2s(_s[0]) < u2s(_s[1]) ? 1 : 0); }, [](uint256 const* _s) { return uint256(slt(_s[0], _s[1]) ? 1 : 0); });
+
+	// An account's storage overlay: SSTOREs followed by SLOADs of the same slots, half of them misses.
+	unordered_map<u256, u256> uMap;
+	unordered_map<uint256, uint256> wMap;
+	size_t found = 0;
+	Timer t;
+	for (unsigned r = 0; r < rounds; ++r)
+	{
+		uMap.clear();
+		for (size_t i = 0; i < us.size(); i += 2)
+			uMap[us[i]] = us[i + 1];
+		for (auto const& k: us)
+			found += uMap.count(k);
+	}
+	double u = t.elapsed();
+	t.restart();
+	for (unsigned r = 0; r < rounds; ++r)
+	{
+		wMap.clear();
+		for (size_t i = 0; i < ws.size(); i += 2)
+			wMap[ws[i]] = ws[i + 1];
+		for (auto const& k: ws)
+			found += wMap.count(k);
+	}
+	double w = t.elapsed();
+	size_t const accesses = rounds * us.size() * 3 / 2;
+	cout << "storage overlay: u256 " << u / accesses * 1e9 << " ns, uint256 " << w / accesses * 1e9 << " ns per access (" << u / w << "x)" << (found ? "" : " !") << endl;
+}
+
 enum class Alphabet
 {
 	Low, Mid, All
@@ -159,6 +447,20 @@ int main(int argc, char** argv)
 			mode = Mode::Trie;
 		else if (arg == "sha3")
 			mode = Mode::SHA3;
+		else if (arg == "memdb")
+			mode = Mode::MemDB;
+		else if (arg == "db")
+			mode = Mode::DB;
+		else if (arg == "commit")
+			mode = Mode::Commit;
+		else if (arg == "log")
+			mode = Mode::Log;
+		else if (arg == "locks")
+			mode = Mode::Locks;
+		else if (arg == "hash")
+			mode = Mode::Hash;
+		else if (arg == "u256")
+			mode = Mode::U256;
 		else if (arg == "-V" || arg == "--version")
 			version();
 	}
@@ -188,6 +490,77 @@ int main(int argc, char** argv)
 
 			cout << sm.first << ": " << e * 1000000 << " us, root=" << t.root() << endl;
 		}
+
+		// Reads: 32-byte keys as in the state trie, so lookups walk deep paths.
+		auto entries = StandardMap(Alphabet::All, 10000, 32, 0).make();
+		MemoryDB mdb;
+		ShardedMemoryDB sdb;
+		OverlayDB odb(unique_ptr<DatabaseFace>(new MemoryDatabase));
+		GenericTrieDB<MemoryDB> mt(&mdb);
+		GenericTrieDB<ShardedMemoryDB> st(&sdb);
+		GenericTrieDB<OverlayDB> ot(&odb);
+		mt.init();
+		st.init();
+		ot.init();
+		for (auto const& i: entries)
+		{
+			mt.insert(&i.first, &i.second);
+			st.insert(&i.first, &i.second);
+			ot.insert(&i.first, &i.second);
+		}
+		odb.commit();
+		benchTrieReads("MemoryDB", mdb, entries, mt.root());
+		benchTrieReads("ShardedMemoryDB", sdb, entries, st.root());
+		benchTrieReads("OverlayDB (cache, after commit)", odb, entries, ot.root());
+
+		// Transactions and receipts roots: index-keyed tries built once per block.
+		for (unsigned count: { 5000u, 20000u })
+		{
+			vector<bytes> txs(count);
+			vector<bytes> receipts(count);
+			h256 seed;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				seed = sha3(seed);
+				txs[i] = bytes(110 + seed[0] % 64, seed[1]);
+				receipts[i] = bytes(260 + seed[2] % 256, seed[3]);
+			}
+
+			Timer t;
+			BytesMap txMap;
+			BytesMap receiptMap;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				txMap[rlp(i)] = txs[i];
+				receiptMap[rlp(i)] = receipts[i];
+			}
+			h256 mapRoots[2] = { hash256(txMap), hash256(receiptMap) };
+			double mapTime = t.elapsed();
+
+			t.restart();
+			h256 roots[2] = { orderedTrieRoot(txs), orderedTrieRoot(receipts) };
+			double orderedTime = t.elapsed();
+
+			t.restart();
+			h256 parallelRoots[2];
+			parallelFor(2, [&](size_t i) { parallelRoots[i] = orderedTrieRoot(i ? receipts : txs); }, 2);
+			double parallelTime = t.elapsed();
+
+			// Receipts appended as execution produces them: only the last path is left for the end.
+			OrderedTrieAppender appender;
+			t.restart();
+			for (auto const& r: receipts)
+				appender.append(&r);
+			double appendTime = t.elapsed();
+			t.restart();
+			h256 appendedRoot = appender.root();
+			double finishTime = t.elapsed();
+			cout << count << " receipts appended: " << appendTime * 1000 << " ms during execution, root() " << finishTime * 1000000 << " us" << (appendedRoot == roots[1] ? "" : ", ROOT DIFFERS") << endl;
+
+			bool same = roots[0] == mapRoots[0] && roots[1] == mapRoots[1] && parallelRoots[0] == roots[0] && parallelRoots[1] == roots[1];
+			cout << count << " txs + receipts roots: hash256 " << mapTime * 1000 << " ms, ordered " << orderedTime * 1000 << " ms (" << mapTime / orderedTime << "x), ordered x2 threads "
+				<< parallelTime * 1000 << " ms (" << mapTime / parallelTime << "x)" << (same ? "" : ", ROOTS DIFFER") << endl;
+		}
 	}
 	else if (mode == Mode::SHA3)
 	{
@@ -200,7 +573,320 @@ int main(int argc, char** argv)
 				s = sha3(s);
 		}
 		cout << "sha3 x 1000: " << t.elapsed() / trials * 1000000 << "us " << endl;
+
+		// Per kernel: hashes one at a time and through sha3Batch, for hash-sized inputs, leaves and branches.
+		for (size_t size: { 32u, 110u, 532u })
+		{
+			size_t const count = 20000;
+			vector<bytes> inputs;
+			h256 seed;
+			for (size_t i = 0; i < count; ++i)
+			{
+				seed = sha3(seed);
+				inputs.push_back(bytes(size, seed[0]));
+			}
+			vector<bytesConstRef> refs;
+			for (auto const& i: inputs)
+				refs.push_back(&i);
+			vector<h256> out(count);
+			for (auto k: keccak::supportedKernels())
+			{
+				keccak::useKernel(k);
+				t.restart();
+				for (unsigned trial = 0; trial < 5; ++trial)
+					for (size_t i = 0; i < count; ++i)
+						out[i] = sha3(refs[i]);
+				double single = t.elapsed() / 5;
+				t.restart();
+				for (unsigned trial = 0; trial < 5; ++trial)
+					sha3Batch(refs.data(), count, out.data());
+				double batch = t.elapsed() / 5;
+				cout << size << " bytes, " << keccak::kernelName(k) << ": sha3 " << (unsigned)(count / single) << " hashes/s " << count * size / single / 1e9 << " GB/s"
+					<< ", sha3Batch " << (unsigned)(count / batch) << " hashes/s " << count * size / batch / 1e9 << " GB/s" << endl;
+			}
+		}
+		keccak::useKernel(keccak::supportedKernels().back());
+	}
+	else if (mode == Mode::MemDB)
+	{
+		// Node-shaped payloads: mostly short leaves with the odd 532-byte branch.
+		vector<pair<h256, bytes>> nodes;
+		h256 seed;
+		for (unsigned i = 0; i < 200000; ++i)
+		{
+			seed = sha3(seed);
+			bytes v(seed[31] % 8 ? 70 + seed[30] % 40 : 532, seed[29]);
+			nodes.push_back(make_pair(sha3(v + seed.asBytes()), v));
+		}
+		benchMemDB<MemoryDB>("MemoryDB", nodes);
+		benchMemDB<ShardedMemoryDB>("ShardedMemoryDB", nodes);
+
+		unsigned threads = max(2u, thread::hardware_concurrency());
+		benchMemDBThreaded<MemoryDB>("MemoryDB", nodes, 1);
+		benchMemDBThreaded<ShardedMemoryDB>("ShardedMemoryDB", nodes, threads);
+
+		// Same trie through both stores must give the same root.
+		MemoryDB mdb;
+		ShardedMemoryDB sdb;
+		GenericTrieDB<MemoryDB> mt(&mdb);
+		GenericTrieDB<ShardedMemoryDB> st(&sdb);
+		mt.init();
+		st.init();
+		for (auto const& i: StandardMap(Alphabet::All, 10000, 5, 27).make())
+		{
+			mt.insert(&i.first, &i.second);
+			st.insert(&i.first, &i.second);
+		}
+		cout << "trie roots " << (mt.root() == st.root() ? "match: " : "DIFFER: ") << st.root() << endl;
+	}
+	else if (mode == Mode::DB)
+	{
+		vector<pair<h256, bytes>> nodes;
+		h256 seed;
+		for (unsigned i = 0; i < 100000; ++i)
+		{
+			seed = sha3(seed);
+			nodes.push_back(make_pair(seed, bytes(70 + seed[31] % 100, seed[30])));
+		}
+		boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		boost::filesystem::create_directories(dir);
+		vector<pair<string, DatabaseKind>> kinds = { { "ldb", DatabaseKind::LDB }, { "memory", DatabaseKind::Memory }, { "mmap", DatabaseKind::MMap } };
+		for (auto const& k: kinds)
+		{
+			auto db = openDatabase((dir / k.first).string(), k.second);
+			Timer t;
+			for (size_t i = 0; i < nodes.size(); i += 1000)
+			{
+				auto batch = db->createWriteBatch();
+				for (size_t j = i; j < i + 1000 && j < nodes.size(); ++j)
+					batch->insert(nodes[j].first.ref(), &nodes[j].second);
+				db->commit(*batch);
+			}
+			double writeTime = t.elapsed();
+
+			t.restart();
+			size_t found = 0;
+			string v;
+			for (size_t i = 0; i < nodes.size(); ++i)
+				found += db->get(nodes[(i * 7919) % nodes.size()].first.ref(), v);
+			double readTime = t.elapsed();
+
+			cout << k.first << ": " << (unsigned)(nodes.size() / writeTime) << " batched puts/s, " << (unsigned)(nodes.size() / readTime) << " gets/s";
+			if (db->zeroCopy())
+			{
+				t.restart();
+				bytesConstRef r;
+				for (size_t i = 0; i < nodes.size(); ++i)
+					found += db->getRef(nodes[(i * 7919) % nodes.size()].first.ref(), r);
+				cout << ", " << (unsigned)(nodes.size() / t.elapsed()) << " zero-copy gets/s";
+			}
+			cout << (found ? "" : " !") << endl;
+		}
+		boost::filesystem::remove_all(dir);
+	}
+	else if (mode == Mode::Commit)
+	{
+		unsigned threads = max(1u, thread::hardware_concurrency());
+		vector<unsigned> threadCounts = { 1 };
+		if (threads > 1)
+			threadCounts.push_back(threads);
+		auto base = StandardMap(Alphabet::All, 100000, 32, 0).make();
+		MemoryDB baseDB;
+		GenericTrieDB<MemoryDB> baseTrie(&baseDB);
+		baseTrie.init();
+		for (auto const& i: base)
+			baseTrie.insert(&i.first, &i.second);
+
+		for (unsigned dirty: { 10000u, 100000u })
+		{
+			// Half updates of existing keys, half new keys.
+			TrieChanges changes;
+			h256 seed = sha3(bytes(1, 42));
+			for (unsigned i = 0; i < dirty; ++i)
+			{
+				seed = sha3(seed);
+				changes.push_back(make_pair(i % 2 ? base[i % base.size()].first : seed.asBytes(), seed.ref().cropped(0, 1 + seed[0] % 32).toBytes()));
+			}
+
+			MemoryDB sdb = baseDB;
+			GenericTrieDB<MemoryDB> st(&sdb, baseTrie.root());
+			Timer t;
+			for (auto const& c: changes)
+				st.insert(&c.first, &c.second);
+			double sequential = t.elapsed();
+			cout << dirty << " dirty keys: sequential " << sequential * 1000 << " ms";
+
+			for (unsigned th: threadCounts)
+			{
+				MemoryDB pdb = baseDB;
+				GenericTrieDB<MemoryDB> pt(&pdb, baseTrie.root());
+				t.restart();
+				pt.insertBatch(changes, th);
+				double e = t.elapsed();
+				cout << ", batch x" << th << " " << e * 1000 << " ms (" << sequential / e << "x" << (pt.root() == st.root() ? "" : ", ROOT DIFFERS") << ")";
+			}
+			cout << endl;
+		}
+
+		// Storage tries: many accounts with a few dirty slots each.
+		unsigned accounts = 2000;
+		vector<TrieChanges> storage(accounts);
+		h256 seed;
+		for (auto& s: storage)
+			for (unsigned i = 0; i < 50; ++i)
+			{
+				seed = sha3(seed);
+				s.push_back(make_pair(sha3(seed).asBytes(), rlp(u256(seed[0]))));
+			}
+		MemoryDB sdb;
+		h256s sequentialRoots;
+		Timer t;
+		for (auto const& s: storage)
+		{
+			GenericTrieDB<MemoryDB> st(&sdb);
+			st.init();
+			for (auto const& c: s)
+				st.insert(&c.first, &c.second);
+			sequentialRoots.push_back(st.root());
+		}
+		double sequential = t.elapsed();
+		MemoryDB pdb;
+		h256s roots(accounts, EmptyTrie);
+		t.restart();
+		insertBatches(pdb, roots, storage, threads);
+		double e = t.elapsed();
+		cout << accounts << " storage tries: sequential " << sequential * 1000 << " ms, concurrent x" << threads << " " << e * 1000 << " ms (" << sequential / e << "x"
+			<< (roots == sequentialRoots ? "" : ", ROOTS DIFFER") << ")" << endl;
+
+		// Hot keys written over and over within one block: only the last write should cost a hash.
+		for (unsigned writes: { 5u, 20u })
+		{
+			vector<pair<bytes, bytes>> updates;
+			for (unsigned w = 0; w < writes; ++w)
+				for (unsigned i = 0; i < 1000; ++i)
+				{
+					seed = sha3(seed);
+					updates.push_back(make_pair(base[(i * 97) % base.size()].first, seed.ref().cropped(0, 1 + seed[0] % 32).toBytes()));
+				}
+
+			MemoryDB sdb = baseDB;
+			GenericTrieDB<MemoryDB> st(&sdb, baseTrie.root());
+			Timer t;
+			for (auto const& u: updates)
+				st.insert(&u.first, &u.second);
+			double sequential = t.elapsed();
+
+			MemoryDB ddb = baseDB;
+			DeferredTrieDB<MemoryDB> dt(&ddb, baseTrie.root());
+			t.restart();
+			for (auto const& u: updates)
+				dt.insert(&u.first, &u.second);
+			dt.commit();
+			double e = t.elapsed();
+			cout << "1000 keys x" << writes << " writes: immediate " << sequential * 1000 << " ms, deferred " << e * 1000 << " ms (" << sequential / e << "x"
+				<< (dt.root() == st.root() ? "" : ", ROOT DIFFERS") << ")" << endl;
+		}
+	}
+	else if (mode == Mode::Log)
+	{
+		// What a per-transaction debug line costs the thread that logs it; the output itself is discarded.
+		auto post = g_logPost;
+		int verbosity = g_logVerbosity;
+		g_logPost = [](string const&, char const*) {};
+		g_logVerbosity = DebugChannel::verbosity;
+		unsigned const count = 200000;
+		h256 h = sha3("tx");
+		auto run = [&](bool _record)
+		{
+			Timer t;
+			for (unsigned i = 0; i < count; ++i)
+				if (_record)
+					crecord(DebugChannel, "PACK-TX: Hash={},time={}", h, utcTime());
+				else
+					cdebug << "PACK-TX: Hash=" << h << ",time=" << utcTime();
+			return t.elapsed() / count * 1e9;
+		};
+		for (bool async: { false, true })
+		{
+			if (async)
+				startAsyncLogging(1 << 18);
+			double stream = run(false);
+			double record = run(true);
+			if (async)
+				stopAsyncLogging();
+			cout << (async ? "async" : "sync") << ": cdebug stream " << stream << " ns/entry, crecord " << record << " ns/entry" << endl;
+		}
+		g_logVerbosity = verbosity - 10;
+		cout << "hidden channel: " << run(false) << " ns/entry" << endl;
+		cout << "async entries written " << asyncLogStats().written << ", dropped " << asyncLogStats().dropped << endl;
+		g_logVerbosity = verbosity;
+		g_logPost = post;
+	}
+	else if (mode == Mode::Locks)
+	{
+		// Read-mostly cache access, as the RPC threads do on BlockChain's caches.
+		auto run = [](unsigned _threads, function<void()> const& _read, function<void()> const& _write)
+		{
+			unsigned const count = 1000000;
+			vector<thread> ts;
+			Timer t;
+			for (unsigned i = 0; i < _threads; ++i)
+				ts.emplace_back([&]() { for (unsigned j = 1; j <= count; ++j) if (j % 1000) _read(); else _write(); });
+			for (auto& th: ts)
+				th.join();
+			return t.elapsed() / (count * _threads) * 1e9;
+		};
+		SharedMutex biased;
+		boost::shared_mutex plain;
+		unordered_map<unsigned, unsigned> cache{{1, 1}};
+		unsigned sink = 0;
+		for (unsigned threads: { 1u, 4u, max(4u, thread::hardware_concurrency()) })
+		{
+			double b = run(threads, [&]() { ReadGuard l(biased); sink += cache.count(1); }, [&]() { WriteGuard l(biased); cache[1]++; });
+			double p = run(threads, [&]() { boost::shared_lock<boost::shared_mutex> l(plain); sink += cache.count(1); }, [&]() { boost::unique_lock<boost::shared_mutex> l(plain); cache[1]++; });
+			cout << threads << " threads, 0.1% writes: SharedMutex " << b << " ns/op, boost::shared_mutex " << p << " ns/op (" << p / b << "x)" << endl;
+		}
+
+		g_lockProfiling = true;
+		Mutex x_hot;
+		run(4, [&]() { DEV_READ_GUARDED(biased) sink += cache.count(1); }, [&]() { DEV_GUARDED(x_hot) this_thread::sleep_for(chrono::microseconds(10)); });
+		cout << lockContentionReport() << endl;
+		g_lockProfiling = false;
+		(void)sink;
+	}
+	else if (mode == Mode::Hash)
+	{
+		benchFixedHash<32>("h256");
+		benchFixedHash<64>("h512");
+		benchFixedHash<256>("h2048");
+
+		// Matching a log filter's addresses and topics against block blooms, as LogFilter::matches() does.
+		vector<h2048> blooms(4096);
+		h256 seed;
+		for (auto& b: blooms)
+			for (unsigned i = 0; i < 20; ++i)
+				b.shiftBloom<3>(seed = sha3(seed));
+		h256s wanted;
+		for (unsigned i = 0; i < 8; ++i)
+			wanted.push_back(sha3(seed = sha3(seed)));
+		size_t hits = 0;
+		Timer t;
+		for (unsigned r = 0; r < 100; ++r)
+			for (auto const& b: blooms)
+				for (auto const& w: wanted)
+					hits += b.contains(w.bloomPart<3, 256>());
+		double viaPart = t.elapsed();
+		t.restart();
+		for (unsigned r = 0; r < 100; ++r)
+			for (auto const& b: blooms)
+				for (auto const& w: wanted)
+					hits += b.containsBloom<3>(w);
+		double direct = t.elapsed();
+		unsigned checks = 100 * blooms.size() * wanted.size();
+		cout << "bloom containment: via bloomPart " << viaPart / checks * 1e9 << " ns, containsBloom " << direct / checks * 1e9 << " ns (" << viaPart / direct << "x)" << (hits ? "" : " !") << endl;
 	}
+	else if (mode == Mode::U256)
+		benchUint256();
 
 	return 0;
 }
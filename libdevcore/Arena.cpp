@@ -0,0 +1,56 @@
+#include "Arena.h"
+#include <algorithm>
+#include <new>
+
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+char* Arena::newChunk(size_t _size)
+{
+	char* ret = static_cast<char*>(::operator new(_size));
+	chargeMemory(m_tag, _size);
+	m_chunks.push_back(make_pair(ret, _size));
+	m_capacity += _size;
+	return ret;
+}
+
+void* Arena::allocateInNewChunk(size_t _bytes, size_t _align)
+{
+	// operator new aligns to max_align_t; over-aligned requests may need to skip up to _align - 1 bytes.
+	size_t size = max(m_chunkSize, _bytes + (_align > alignof(max_align_t) ? _align : 0));
+	m_next = newChunk(size);
+	m_end = m_next + size;
+	return allocate(_bytes, _align);
+}
+
+void Arena::reset()
+{
+	if (m_chunks.size() > 1)
+	{
+		size_t total = m_capacity;
+		release();
+		newChunk(total);
+	}
+	if (!m_chunks.empty())
+	{
+		m_next = m_chunks.back().first;
+		m_end = m_next + m_chunks.back().second;
+	}
+}
+
+void Arena::release()
+{
+	for (auto const& c: m_chunks)
+	{
+		releaseMemory(m_tag, c.second);
+		::operator delete(c.first);
+	}
+	m_chunks.clear();
+	m_capacity = 0;
+	m_next = m_end = nullptr;
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "MemoryAccounting.h"
+
+namespace dev
+{
+
+/**
+ * @brief Bump allocator for data that all dies at once: the scratch of one block's execution or one
+ * trie commit.
+ *
+ * allocate() hands out the next aligned bytes of the current chunk and takes a new chunk when that runs
+ * out; nothing is freed one by one. reset() makes everything allocated so far invalid in one go and keeps
+ * the memory for the next round: if the round needed several chunks, they are swapped for one chunk as
+ * big as all of them, so that a steady workload ends up with a single chunk and no allocations at all.
+ * Chunks are charged to the tag given. Not thread-safe; give each thread its own.
+ */
+class Arena
+{
+public:
+	static const size_t c_defaultChunkSize = 64 * 1024;
+
+	explicit Arena(MemoryTag _tag = MemoryTag::Other, size_t _chunkSize = c_defaultChunkSize): m_tag(_tag), m_chunkSize(_chunkSize) {}
+	Arena(Arena const&) = delete;
+	Arena& operator=(Arena const&) = delete;
+	~Arena() { release(); }
+
+	/// @returns @a _bytes of memory aligned to @a _align, which must be a power of two.
+	void* allocate(size_t _bytes, size_t _align = alignof(std::max_align_t))
+	{
+		uintptr_t p = (reinterpret_cast<uintptr_t>(m_next) + _align - 1) & ~(uintptr_t)(_align - 1);
+		if (m_next && p + _bytes <= reinterpret_cast<uintptr_t>(m_end))
+		{
+			m_next = reinterpret_cast<char*>(p + _bytes);
+			return reinterpret_cast<void*>(p);
+		}
+		return allocateInNewChunk(_bytes, _align);
+	}
+
+	/// Forgets everything allocated, keeping the memory.
+	void reset();
+	/// Forgets everything allocated and frees the memory.
+	void release();
+
+	/// Bytes in the chunks held.
+	size_t capacity() const { return m_capacity; }
+
+private:
+	void* allocateInNewChunk(size_t _bytes, size_t _align);
+	char* newChunk(size_t _size);
+
+	MemoryTag m_tag;
+	size_t m_chunkSize;
+	std::vector<std::pair<char*, size_t>> m_chunks;	///< The current chunk is the last.
+	size_t m_capacity = 0;
+	char* m_next = nullptr;
+	char* m_end = nullptr;
+};
+
+/// std allocator on an Arena; deallocate() is a no-op, memory comes back with the arena's reset().
+template <class T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	ArenaAllocator(Arena& _arena): m_arena(&_arena) {}
+	template <class U> ArenaAllocator(ArenaAllocator<U> const& _a): m_arena(_a.arena()) {}
+
+	T* allocate(size_t _n) { return static_cast<T*>(m_arena->allocate(_n * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+
+	Arena* arena() const { return m_arena; }
+	template <class U> bool operator==(ArenaAllocator<U> const& _a) const { return m_arena == _a.arena(); }
+	template <class U> bool operator!=(ArenaAllocator<U> const& _a) const { return m_arena != _a.arena(); }
+
+private:
+	Arena* m_arena;
+};
+
+template <class T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}
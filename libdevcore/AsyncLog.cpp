@@ -0,0 +1,246 @@
+#include "AsyncLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include "Guards.h"
+#include "Worker.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+/// A thread's queue of records: written by that thread only, read by the writer only.
+class LogRing
+{
+public:
+	LogRing(size_t _size, string const& _thread): m_slots(_size), m_mask(_size - 1), m_thread(_thread) {}
+
+	/// @returns false, counting the record as dropped, if the ring is full.
+	bool push(LogRecord&& _r)
+	{
+		size_t tail = m_tail.load(memory_order_relaxed);
+		if (tail - m_head.load(memory_order_acquire) > m_mask)
+		{
+			m_dropped.fetch_add(1, memory_order_relaxed);
+			return false;
+		}
+		m_slots[tail & m_mask] = move(_r);
+		m_tail.store(tail + 1, memory_order_release);
+		return true;
+	}
+
+	/// Moves out all queued records, paired with this ring's thread name, onto @a io_out.
+	void drain(vector<pair<LogRecord, string const*>>& io_out)
+	{
+		size_t head = m_head.load(memory_order_relaxed);
+		size_t tail = m_tail.load(memory_order_acquire);
+		for (; head != tail; ++head)
+			io_out.emplace_back(move(m_slots[head & m_mask]), &m_thread);
+		m_head.store(head, memory_order_release);
+	}
+
+	bool empty() const { return m_head.load(memory_order_acquire) == m_tail.load(memory_order_acquire); }
+	uint64_t dropped() const { return m_dropped.load(memory_order_relaxed); }
+
+	atomic<bool> orphaned{false};		///< Set when the owning thread exits; the writer retires the ring once empty.
+
+private:
+	vector<LogRecord> m_slots;
+	size_t m_mask;
+	string m_thread;
+	char m_pad0[64];
+	atomic<size_t> m_head{0};
+	char m_pad1[64];
+	atomic<size_t> m_tail{0};
+	char m_pad2[64];
+	atomic<uint64_t> m_dropped{0};
+};
+
+class LogWriter: public Worker
+{
+public:
+	LogWriter(): Worker("log", 1) {}
+	~LogWriter() { stop(); }
+
+	void start() { startWorking(); }
+	void stop() { stopWorking(); }
+
+	/// Writes out everything queued so far, from whichever thread calls it.
+	void flush();
+
+private:
+	void doWork() override { flush(); }
+	void doneWorking() override { flush(); }
+};
+
+atomic<bool> s_asyncLogging{false};
+atomic<size_t> s_ringSize{4096};
+
+Mutex x_rings;
+vector<shared_ptr<LogRing>> s_rings;
+uint64_t s_retiredDropped = 0;			///< Drops of rings since retired. Guarded by x_rings.
+
+Mutex x_flush;
+atomic<uint64_t> s_written{0};
+uint64_t s_droppedReported = 0;			///< Guarded by x_flush.
+
+LogWriter s_writer;
+
+/// Gives the thread's ring over to the writer when the thread exits.
+struct RingOwner
+{
+	~RingOwner() { if (ring) ring->orphaned = true; }
+	shared_ptr<LogRing> ring;
+};
+
+LogRing& localRing()
+{
+	static thread_local RingOwner s_owner;
+	if (!s_owner.ring)
+	{
+		size_t size = 2;
+		while (size < s_ringSize)
+			size *= 2;
+		s_owner.ring = make_shared<LogRing>(size, getThreadName());
+		Guard l(x_rings);
+		s_rings.push_back(s_owner.ring);
+	}
+	return *s_owner.ring;
+}
+
+uint64_t droppedSoFar()
+{
+	Guard l(x_rings);
+	uint64_t ret = s_retiredDropped;
+	for (auto const& r: s_rings)
+		ret += r->dropped();
+	return ret;
+}
+
+void LogWriter::flush()
+{
+	Guard l(x_flush);
+
+	vector<shared_ptr<LogRing>> rings;
+	DEV_GUARDED(x_rings)
+		rings = s_rings;
+
+	vector<pair<LogRecord, string const*>> batch;
+	for (auto const& r: rings)
+		r->drain(batch);
+	// Each ring is in order already; this interleaves the threads.
+	stable_sort(batch.begin(), batch.end(), [](pair<LogRecord, string const*> const& _a, pair<LogRecord, string const*> const& _b) { return _a.first.time < _b.first.time; });
+
+	for (auto const& i: batch)
+		if (i.first.format)
+			g_logPost(formatLogRecord(i.first, *i.second), i.first.channel);
+		else
+			g_logPost(i.first.text, i.first.channel);
+	s_written += batch.size();
+
+	uint64_t dropped = droppedSoFar();
+	if (dropped != s_droppedReported)
+	{
+		g_logPost(toString(dropped - s_droppedReported) + " log entries dropped (ring full)", WarnChannel::name());
+		s_droppedReported = dropped;
+	}
+
+	DEV_GUARDED(x_rings)
+		for (auto it = s_rings.begin(); it != s_rings.end();)
+			if ((*it)->orphaned && (*it)->empty())
+			{
+				s_retiredDropped += (*it)->dropped();
+				it = s_rings.erase(it);
+			}
+			else
+				++it;
+}
+
+}
+
+void LogArg::streamOut(ostream& _out) const
+{
+	switch (m_kind)
+	{
+	case Signed: _out << EthBlue << m_signed << EthReset; break;
+	case Unsigned: _out << EthBlue << m_unsigned << EthReset; break;
+	case Big: _out << EthNavy << fromBigEndian<u256>(bytesConstRef(m_bytes, 32)) << EthReset; break;
+	case Hash: _out << EthCyan "#" << toHex(bytesConstRef(m_bytes, m_size)) << EthReset; break;
+	case Address: _out << EthRed "@" << toHex(bytesConstRef(m_bytes, m_size)) << EthReset; break;
+	}
+}
+
+string formatLogRecord(LogRecord const& _r, string const& _thread)
+{
+	ostringstream out;
+	streamLogPrefix(out, _r.channel, _r.time, _thread, string());
+	out << logFileName(_r.site.file, _r.site.line, _r.site.function, _r.site.timestamp) << " ";
+	unsigned arg = 0;
+	for (char const* f = _r.format; *f; ++f)
+		if (f[0] == '{' && f[1] == '}' && arg < _r.argCount)
+		{
+			_r.args[arg++].streamOut(out);
+			++f;
+		}
+		else
+			out << *f;
+	return out.str();
+}
+
+void postLog(LogRecord&& _r)
+{
+	if (s_asyncLogging)
+		localRing().push(move(_r));
+	else
+		g_logPost(formatLogRecord(_r, getThreadName()), _r.channel);
+}
+
+void postLog(string&& _entry, char const* _channel)
+{
+	if (!s_asyncLogging)
+	{
+		g_logPost(_entry, _channel);
+		return;
+	}
+	LogRecord r;
+	r.channel = _channel;
+	r.text = move(_entry);
+	r.time = chrono::system_clock::now();
+	localRing().push(move(r));
+}
+
+void startAsyncLogging(size_t _ringSize)
+{
+	s_ringSize = _ringSize;
+	s_asyncLogging = true;
+	s_writer.start();
+}
+
+void stopAsyncLogging()
+{
+	s_asyncLogging = false;
+	s_writer.stop();
+	s_writer.flush();
+}
+
+bool isAsyncLogging()
+{
+	return s_asyncLogging;
+}
+
+AsyncLogStats asyncLogStats()
+{
+	AsyncLogStats ret;
+	ret.written = s_written;
+	ret.dropped = droppedSoFar();
+	return ret;
+}
+
+}
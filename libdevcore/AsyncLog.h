@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "Common.h"
+#include "FixedHash.h"
+#include "Log.h"
+
+namespace dev
+{
+
+/**
+ * Asynchronous logging.
+ *
+ * Once startAsyncLogging() is called, finished log entries no longer go to g_logPost on the thread
+ * that logged them. Each logging thread gets its own single-producer ring of records, and a background
+ * writer drains the rings, puts the records in time order and hands them to g_logPost. Logging thus
+ * never blocks on output, nor on another thread. When a ring is full the record is dropped and counted
+ * (see asyncLogStats()); the writer also reports drops on the log itself.
+ *
+ * Besides the usual clog()/cdebug streams, crecord() logs fixed-format records whose arguments
+ * (integers, u256, hashes) are copied into the record as they are and only formatted by the writer.
+ */
+
+/// Where a log record was made. All pointers are to string literals.
+struct LogSite
+{
+	char const* file;
+	int line;
+	char const* function;
+	char const* timestamp;
+};
+
+/// An argument of a log record: an integer, a u256 or a hash of up to 32 bytes, kept unformatted.
+class LogArg
+{
+public:
+	LogArg() = default;
+	template <class T, class = typename std::enable_if<std::is_integral<T>::value>::type> LogArg(T _v):
+		m_kind(std::is_signed<T>::value ? Signed : Unsigned)
+	{
+		if (std::is_signed<T>::value)
+			m_signed = (int64_t)_v;
+		else
+			m_unsigned = (uint64_t)_v;
+	}
+	LogArg(u256 const& _v): m_kind(Big), m_size(32) { bytesRef r(m_bytes, 32); toBigEndian(_v, r); }
+	template <unsigned N> LogArg(FixedHash<N> const& _h): m_kind(N == 20 ? Address : Hash), m_size(N)
+	{
+		static_assert(N <= 32, "log record hashes are at most 32 bytes");
+		memcpy(m_bytes, _h.data(), N);
+	}
+
+	void streamOut(std::ostream& _out) const;
+
+private:
+	enum Kind: uint8_t { Signed, Unsigned, Big, Hash, Address };
+
+	Kind m_kind = Unsigned;
+	uint8_t m_size = 0;
+	union
+	{
+		int64_t m_signed;
+		uint64_t m_unsigned;
+		byte m_bytes[32];
+	};
+};
+
+/// An entry on its way to the writer: either formatted already, or a format and the arguments for it.
+struct LogRecord
+{
+	static const unsigned c_maxArgs = 6;
+
+	char const* channel = nullptr;
+	std::string text;				///< The whole entry, if format is null.
+	char const* format = nullptr;	///< A literal with a "{}" for each argument.
+	LogSite site;
+	std::chrono::system_clock::time_point time;
+	unsigned argCount = 0;
+	LogArg args[c_maxArgs];
+};
+
+/// Starts the background writer. Each thread then logs into a ring of @a _ringSize records (rounded up
+/// to a power of two) created on its first entry.
+void startAsyncLogging(size_t _ringSize = 4096);
+/// Writes out what is queued, stops the writer and goes back to posting entries directly.
+void stopAsyncLogging();
+bool isAsyncLogging();
+
+struct AsyncLogStats
+{
+	uint64_t written = 0;	///< Entries handed to g_logPost by the writer.
+	uint64_t dropped = 0;	///< Entries lost to full rings.
+};
+AsyncLogStats asyncLogStats();
+
+/// Queues @a _r for the writer or, if async logging is off, formats and posts it right away.
+void postLog(LogRecord&& _r);
+/// @returns the formatted entry of @a _r, as logged by the thread called @a _thread.
+std::string formatLogRecord(LogRecord const& _r, std::string const& _thread);
+
+template <class Channel, class... Args> void logRecord(LogSite const& _site, char const* _format, Args const&... _args)
+{
+	static_assert(sizeof...(Args) <= LogRecord::c_maxArgs, "too many arguments for a log record");
+	LogRecord r;
+	r.channel = Channel::name();
+	r.format = _format;
+	r.site = _site;
+	r.time = std::chrono::system_clock::now();
+	int expand[] = { 0, ((void)(r.args[r.argCount++] = LogArg(_args)), 0)... };
+	(void)expand;
+	postLog(std::move(r));
+}
+
+}
+
+/// Logs a fixed-format record to channel X, e.g. crecord(dev::DebugChannel, "PACK-TX: Hash={},time={}", h, t).
+/// As with clog(), nothing is evaluated unless the channel is visible.
+#if NLOG
+#define crecord(X, ...) DEV_STATEMENT_SKIP() dev::NullOutputStream()
+#else
+#define crecord(X, ...) DEV_STATEMENT_IF(DEV_LOG_VISIBLE(X)) dev::logRecord<X>(dev::LogSite{__FILE__, __LINE__, __FUNCTION__, __TIMESTAMP__}, __VA_ARGS__)
+#endif
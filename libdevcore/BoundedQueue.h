@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "EventCount.h"
+
+namespace dev
+{
+
+/**
+ * @brief Bounded multi-producer, multi-consumer queue on a lock-free ring.
+ *
+ * Each slot carries a sequence number that says whether it is free for the producer at a given position
+ * or full for the consumer at it (Vyukov's bounded queue), so neither side takes a lock and the two only
+ * meet on the slot they hand over. The head and tail counters live on cache lines of their own. Threads
+ * that must wait, for an item or under back-pressure for room, sleep on an EventCount, which costs the
+ * other side nothing while nobody sleeps.
+ *
+ * When full, push() either waits for room (Overflow::Block) or throws out the oldest item to make it
+ * (Overflow::DropOldest), counting it in dropped(). pushFor() waits for room only so long, then gives
+ * up on the new item and counts that instead; it suits producers that must not stall, like I/O threads.
+ */
+template <class T>
+class BoundedQueue
+{
+public:
+	enum class Overflow
+	{
+		Block,
+		DropOldest
+	};
+
+	static const size_t c_defaultCapacity = 4096;
+
+	/// @a _capacity is rounded up to a power of two.
+	explicit BoundedQueue(size_t _capacity = c_defaultCapacity, Overflow _overflow = Overflow::Block):
+		m_overflow(_overflow),
+		m_slots(roundUp(_capacity)),
+		m_mask(m_slots.size() - 1)
+	{
+		for (size_t i = 0; i < m_slots.size(); ++i)
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	BoundedQueue(BoundedQueue const&) = delete;
+	BoundedQueue& operator=(BoundedQueue const&) = delete;
+	~BoundedQueue() { T t; while (take(t)) {} }
+
+	/// Appends @a _item, waiting for room or dropping the oldest item if the queue is full.
+	template <class U> void push(U&& _item)
+	{
+		while (!tryPush(std::forward<U>(_item)))
+			if (m_overflow == Overflow::DropOldest)
+			{
+				T oldest;
+				if (take(oldest))
+					m_dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				auto key = m_notFull.prepareWait();
+				if (full())
+					m_notFull.wait(key);
+				else
+					m_notFull.cancelWait();
+			}
+	}
+
+	/// Appends @a _item, waiting up to @a _timeout for room. @returns false, and counts @a _item as
+	/// dropped, on timeout.
+	template <class U> bool pushFor(U&& _item, std::chrono::milliseconds _timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + _timeout;
+		while (!tryPush(std::forward<U>(_item)))
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (now >= deadline)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			auto key = m_notFull.prepareWait();
+			if (full())
+				// Rounded up, so that the full wait is had before giving up.
+				m_notFull.waitFor(key, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds(1));
+			else
+				m_notFull.cancelWait();
+		}
+		return true;
+	}
+
+	/// Appends @a _item if there is room. @returns false, leaving @a _item alone, if there is not.
+	template <class U> bool tryPush(U&& _item)
+	{
+		size_t pos = m_tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Slot& s = m_slots[pos & m_mask];
+			intptr_t d = (intptr_t)s.sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+			if (d == 0)
+			{
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					new (&s.storage) T(std::forward<U>(_item));
+					s.sequence.store(pos + 1, std::memory_order_release);
+					m_notEmpty.notifyOne();
+					return true;
+				}
+			}
+			else if (d < 0)
+				return false;
+			else
+				pos = m_tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	/// Takes the oldest item into @a o_item if there is one. @returns false if the queue is empty.
+	bool tryPop(T& o_item) { return take(o_item); }
+
+	/// Takes the oldest item, waiting up to @a _timeout for one. @returns false on timeout.
+	bool tryPop(T& o_item, std::chrono::milliseconds _timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + _timeout;
+		while (!take(o_item))
+		{
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			if (left.count() <= 0)
+				return false;
+			auto key = m_notEmpty.prepareWait();
+			if (empty())
+				m_notEmpty.waitFor(key, left);
+			else
+				m_notEmpty.cancelWait();
+		}
+		return true;
+	}
+
+	/// concurrent_queue's interface: as above, with the item in the pair.
+	std::pair<bool, T> tryPop(int _milliseconds)
+	{
+		std::pair<bool, T> ret;
+		ret.first = tryPop(ret.second, std::chrono::milliseconds(_milliseconds));
+		return ret;
+	}
+
+	/// Takes the oldest item, waiting for one.
+	T pop()
+	{
+		T ret;
+		while (!take(ret))
+		{
+			auto key = m_notEmpty.prepareWait();
+			if (empty())
+				m_notEmpty.wait(key);
+			else
+				m_notEmpty.cancelWait();
+		}
+		return ret;
+	}
+
+	/// Moves up to @a _max items, oldest first, onto the end of @a io_items without waiting. @returns how many.
+	size_t popBulk(std::vector<T>& io_items, size_t _max)
+	{
+		size_t n = 0;
+		T item;
+		for (; n < _max && take(item); ++n)
+			io_items.push_back(std::move(item));
+		return n;
+	}
+
+	/// As popBulk(), but first waits up to @a _timeout for at least one item.
+	size_t popBulk(std::vector<T>& io_items, size_t _max, std::chrono::milliseconds _timeout)
+	{
+		if (!_max)
+			return 0;
+		T item;
+		if (!tryPop(item, _timeout))
+			return 0;
+		io_items.push_back(std::move(item));
+		return 1 + popBulk(io_items, _max - 1);
+	}
+
+	/// @returns the number of items; only a snapshot while other threads are at work.
+	size_t size() const
+	{
+		size_t head = m_head.load(std::memory_order_acquire);
+		size_t tail = m_tail.load(std::memory_order_acquire);
+		return tail > head ? tail - head : 0;
+	}
+	bool empty() const { return size() == 0; }
+	bool full() const { return size() > m_mask; }
+	size_t capacity() const { return m_mask + 1; }
+	/// @returns how many items Overflow::DropOldest has thrown out and pushFor() has given up on.
+	uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+	static const size_t c_cacheLine = 64;
+
+	static size_t roundUp(size_t _capacity)
+	{
+		size_t ret = 2;
+		while (ret < _capacity)
+			ret *= 2;
+		return ret;
+	}
+
+	/// The non-blocking pop behind all the others.
+	bool take(T& o_item)
+	{
+		size_t pos = m_head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Slot& s = m_slots[pos & m_mask];
+			intptr_t d = (intptr_t)s.sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+			if (d == 0)
+			{
+				if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					T* item = reinterpret_cast<T*>(&s.storage);
+					o_item = std::move(*item);
+					item->~T();
+					s.sequence.store(pos + m_mask + 1, std::memory_order_release);
+					m_notFull.notifyOne();
+					return true;
+				}
+			}
+			else if (d < 0)
+				return false;
+			else
+				pos = m_head.load(std::memory_order_relaxed);
+		}
+	}
+
+	struct Slot
+	{
+		std::atomic<size_t> sequence{0};
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+	};
+
+	Overflow m_overflow;
+	std::vector<Slot> m_slots;
+	size_t m_mask;
+	char m_pad0[c_cacheLine];
+	std::atomic<size_t> m_tail{0};
+	char m_pad1[c_cacheLine];
+	std::atomic<size_t> m_head{0};
+	char m_pad2[c_cacheLine];
+	std::atomic<uint64_t> m_dropped{0};
+	EventCount m_notEmpty;
+	EventCount m_notFull;
+};
+
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "Common.h"
+#include "Guards.h"
+
+namespace dev
+{
+
+struct ClockCacheStats
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t insertions = 0;
+	uint64_t evictions = 0;
+	size_t entries = 0;
+	size_t bytes = 0;
+	size_t budget = 0;
+
+	double hitRatio() const { return hits + misses ? double(hits) / double(hits + misses) : 0; }
+};
+
+inline std::ostream& operator<<(std::ostream& _out, ClockCacheStats const& _s)
+{
+	_out << _s.entries << " entries, " << (_s.bytes / 1024) << "/" << (_s.budget / 1024) << " KB, "
+		<< _s.hits << " hits, " << _s.misses << " misses";
+	if (_s.hits + _s.misses)
+		_out << " (" << (_s.hits * 100 / (_s.hits + _s.misses)) << "% hit)";
+	return _out << ", " << _s.insertions << " insertions, " << _s.evictions << " evictions";
+}
+
+/// The default cost of a cache entry: just its size.
+template <class V> struct SizeofCost
+{
+	size_t operator()(V const&) const { return sizeof(V); }
+};
+
+/**
+ * @brief Sharded cache of values by key, kept within a byte budget by CLOCK eviction.
+ *
+ * Each shard keeps its entries in a ring of slots with a small use count (generalised CLOCK). A hit
+ * takes the shard's SharedMutex shared, whose read bias keeps readers off any shared cache line, and
+ * writes nothing shared on the way: the entry's count is only written when the sweep has run it down
+ * to zero, when the hit sets it back to c_maxUses, and hits and misses are counted in per-thread
+ * stripes. So concurrent hits, the common case, neither serialise nor bounce lines between cores.
+ * Inserting takes the shard's write lock and, while the shard is over its share of the budget, sweeps
+ * the clock hand: entries with a count lose one and stay, the others go. New entries start at zero,
+ * so values read once (a scan over old blocks) are the first to go, and entries hit since the hand
+ * last passed survive a scan of up to c_maxUses times the cache's size.
+ *
+ * An entry's cost is @a Cost()(value) plus a fixed overhead for its slot and index node.
+ *
+ * It is a cache only: whatever is in it may go at any time, so values that must not be lost (written
+ * and not yet stored) are to be kept elsewhere.
+ */
+template <class K, class V, class Cost = SizeofCost<V>, class Hash = std::hash<K>>
+class ClockCache
+{
+public:
+	static const unsigned c_shards = 16;
+	static const uint8_t c_maxUses = 3;
+
+	explicit ClockCache(size_t _budget = 0): m_shardBudget(_budget / c_shards)
+	{
+		for (unsigned i = 0; i < c_shards; ++i)
+			m_shards.emplace_back(new Shard);
+	}
+
+	/// Walks a snapshot of the entries as std::pair<K, V>s, taken when it begins.
+	class const_iterator
+	{
+	public:
+		using Snapshot = std::vector<std::pair<K, V>>;
+		const_iterator() = default;
+		explicit const_iterator(std::shared_ptr<Snapshot const> const& _s): m_snapshot(_s) {}
+		std::pair<K, V> const& operator*() const { return (*m_snapshot)[m_i]; }
+		std::pair<K, V> const* operator->() const { return &(*m_snapshot)[m_i]; }
+		const_iterator& operator++() { ++m_i; return *this; }
+		bool operator==(const_iterator const& _o) const { return atEnd() == _o.atEnd() && (atEnd() || m_i == _o.m_i); }
+		bool operator!=(const_iterator const& _o) const { return !operator==(_o); }
+
+	private:
+		bool atEnd() const { return !m_snapshot || m_i == m_snapshot->size(); }
+		std::shared_ptr<Snapshot const> m_snapshot;
+		size_t m_i = 0;
+	};
+
+	const_iterator begin() const
+	{
+		auto ret = std::make_shared<typename const_iterator::Snapshot>();
+		for (auto const& s: m_shards)
+		{
+			ReadGuard l(s->x_shard);
+			for (auto const& i: s->index)
+				ret->emplace_back(i.first, s->slots[i.second].value);
+		}
+		return const_iterator(ret);
+	}
+	const_iterator end() const { return const_iterator(); }
+
+	/// @returns true and sets @a o_value if @a _k is cached. Counts a hit or a miss.
+	bool lookup(K const& _k, V& o_value) const
+	{
+		Shard& s = shardFor(_k);
+		{
+			ReadGuard l(s.x_shard);
+			auto it = s.index.find(_k);
+			if (it != s.index.end())
+			{
+				Slot const& slot = s.slots[it->second];
+				// Only a count the sweep ran down is written, so hot entries' lines stay shared.
+				if (!slot.uses.load(std::memory_order_relaxed))
+					slot.uses.store(c_maxUses, std::memory_order_relaxed);
+				o_value = slot.value;
+				counters().hits.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		counters().misses.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	/// @returns 1 if @a _k is cached, else 0, as the map's count() did. Counts neither a hit nor a miss.
+	size_t count(K const& _k) const
+	{
+		Shard& s = shardFor(_k);
+		ReadGuard l(s.x_shard);
+		return s.index.count(_k);
+	}
+
+	size_t size() const
+	{
+		size_t ret = 0;
+		for (auto const& s: m_shards)
+		{
+			ReadGuard l(s->x_shard);
+			ret += s->index.size();
+		}
+		return ret;
+	}
+
+	/// Caches @a _v under @a _k, replacing what is there.
+	void insert(K const& _k, V const& _v) { insertIf(_k, _v, []() { return true; }); }
+
+	/// As insert(), if @a _p() holds; it is called under the shard's lock, so that a reader's fill can be
+	/// ordered against the writer that made it stale.
+	template <class P> void insertIf(K const& _k, V const& _v, P const& _p)
+	{
+		if (!m_shardBudget)
+			return;
+		size_t cost = Cost()(_v) + c_entryOverhead;
+		Shard& s = shardFor(_k);
+		WriteGuard l(s.x_shard);
+		if (!_p())
+			return;
+		auto it = s.index.find(_k);
+		size_t i;
+		if (it != s.index.end())
+		{
+			i = it->second;
+			Slot& slot = s.slots[i];
+			s.bytes = s.bytes - slot.cost + cost;
+			slot.value = _v;
+			slot.cost = cost;
+		}
+		else
+		{
+			if (s.free.empty())
+			{
+				i = s.slots.size();
+				s.slots.emplace_back();
+			}
+			else
+			{
+				i = s.free.back();
+				s.free.pop_back();
+			}
+			Slot& slot = s.slots[i];
+			slot.key = _k;
+			slot.value = _v;
+			slot.cost = cost;
+			slot.used = true;
+			slot.uses.store(0, std::memory_order_relaxed);
+			s.index.emplace(_k, i);
+			s.bytes += cost;
+			++s.insertions;
+		}
+		evict(s, i);
+	}
+
+	void erase(K const& _k)
+	{
+		Shard& s = shardFor(_k);
+		WriteGuard l(s.x_shard);
+		auto it = s.index.find(_k);
+		if (it != s.index.end())
+			remove(s, it->second);
+	}
+
+	void clear()
+	{
+		for (auto const& s: m_shards)
+		{
+			WriteGuard l(s->x_shard);
+			clear(*s);
+		}
+	}
+
+	void setBudget(size_t _budget)
+	{
+		m_shardBudget = _budget / c_shards;
+		for (auto const& s: m_shards)
+		{
+			WriteGuard l(s->x_shard);
+			if (m_shardBudget)
+				evict(*s, c_noSlot);
+			else
+				clear(*s);
+		}
+	}
+	size_t budget() const { return m_shardBudget * c_shards; }
+
+	ClockCacheStats stats() const
+	{
+		ClockCacheStats ret;
+		ret.budget = budget();
+		for (Counters const& c: m_counters)
+		{
+			ret.hits += c.hits.load(std::memory_order_relaxed);
+			ret.misses += c.misses.load(std::memory_order_relaxed);
+		}
+		for (auto const& s: m_shards)
+		{
+			ReadGuard l(s->x_shard);
+			ret.insertions += s->insertions;
+			ret.evictions += s->evictions;
+			ret.entries += s->index.size();
+			ret.bytes += s->bytes;
+		}
+		return ret;
+	}
+
+private:
+	/// Rough cost of a slot, its index node and the allocator's bookkeeping.
+	static const size_t c_entryOverhead = sizeof(K) + 2 * sizeof(size_t) + 64;
+	static const size_t c_noSlot = (size_t)-1;
+	static const unsigned c_counterStripes = 8;
+
+	struct Slot
+	{
+		K key;
+		V value;
+		size_t cost = 0;
+		bool used = false;
+		mutable std::atomic<uint8_t> uses{0};
+	};
+
+	struct Shard
+	{
+		mutable SharedMutex x_shard;
+		std::unordered_map<K, size_t, Hash> index;	///< Key to slot.
+		std::deque<Slot> slots;						///< The clock; unused slots are in free.
+		std::vector<size_t> free;
+		size_t hand = 0;
+		size_t bytes = 0;
+		uint64_t insertions = 0;
+		uint64_t evictions = 0;
+	};
+
+	/// Hit and miss counts of the threads dealt this stripe (round-robin, as SharedMutex deals its readers).
+	struct alignas(64) Counters
+	{
+		std::atomic<uint64_t> hits{0};
+		std::atomic<uint64_t> misses{0};
+	};
+
+	Shard& shardFor(K const& _k) const { return *m_shards[Hash()(_k) % c_shards]; }
+
+	Counters& counters() const
+	{
+		static std::atomic<unsigned> s_next{0};
+		static thread_local unsigned const s_stripe = s_next.fetch_add(1, std::memory_order_relaxed) % c_counterStripes;
+		return m_counters[s_stripe];
+	}
+
+	/// Sweeps the clock until @a _s is within budget, sparing slot @a _keep (the entry just inserted).
+	void evict(Shard& _s, size_t _keep)
+	{
+		size_t budget = m_shardBudget;
+		while (_s.bytes > budget && _s.index.size() > (_keep == c_noSlot ? 0 : 1))
+		{
+			if (_s.hand >= _s.slots.size())
+				_s.hand = 0;
+			size_t i = _s.hand++;
+			Slot& slot = _s.slots[i];
+			if (!slot.used || i == _keep)
+				continue;
+			uint8_t uses = slot.uses.load(std::memory_order_relaxed);
+			if (uses)
+				slot.uses.store(uses - 1, std::memory_order_relaxed);
+			else
+			{
+				remove(_s, i);
+				++_s.evictions;
+			}
+		}
+	}
+
+	void remove(Shard& _s, size_t _i)
+	{
+		Slot& slot = _s.slots[_i];
+		_s.bytes -= slot.cost;
+		_s.index.erase(slot.key);
+		slot.value = V();
+		slot.used = false;
+		_s.free.push_back(_i);
+	}
+
+	static void clear(Shard& _s)
+	{
+		_s.index.clear();
+		_s.slots.clear();
+		_s.free.clear();
+		_s.hand = 0;
+		_s.bytes = 0;
+	}
+
+	std::vector<std::unique_ptr<Shard>> m_shards;
+	std::atomic<size_t> m_shardBudget;
+	mutable Counters m_counters[c_counterStripes];
+};
+
+}
@@ -0,0 +1,43 @@
+#include "DatabaseFace.h"
+#include "LDBDatabase.h"
+#include "MemoryDatabase.h"
+#include "MMapDatabase.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+void DatabaseFace::getMany(std::vector<bytesConstRef> const& _keys, std::vector<std::string>& o_values) const
+{
+	o_values.assign(_keys.size(), std::string());
+	for (size_t i = 0; i < _keys.size(); ++i)
+		get(_keys[i], o_values[i]);
+}
+
+DatabaseKind defaultDatabaseKind()
+{
+#if ETH_DB_MMAP
+	return DatabaseKind::MMap;
+#elif ETH_DB_MEMORY
+	return DatabaseKind::Memory;
+#else
+	return DatabaseKind::LDB;
+#endif
+}
+
+std::unique_ptr<DatabaseFace> openDatabase(std::string const& _path, DatabaseKind _kind)
+{
+	switch (_kind)
+	{
+	case DatabaseKind::Memory:
+		return unique_ptr<DatabaseFace>(new MemoryDatabase);
+	case DatabaseKind::MMap:
+		return unique_ptr<DatabaseFace>(new MMapDatabase(_path));
+	case DatabaseKind::LDB:
+	default:
+		return unique_ptr<DatabaseFace>(new LDBDatabase(_path));
+	}
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Common.h"
+#include "Exceptions.h"
+
+namespace dev
+{
+
+struct DatabaseError: virtual Exception { DatabaseError(std::string _message = std::string()): Exception(_message) {} };
+
+/**
+ * @brief A set of writes applied atomically by DatabaseFace::commit().
+ */
+class WriteBatchFace
+{
+public:
+	virtual ~WriteBatchFace() {}
+
+	virtual void insert(bytesConstRef _key, bytesConstRef _value) = 0;
+	virtual void kill(bytesConstRef _key) = 0;
+	/// @returns the number of operations added so far.
+	virtual size_t size() const = 0;
+};
+
+/**
+ * @brief Engine-neutral write batch that records the operations for replay, in order, on commit.
+ */
+class BufferedWriteBatch: public WriteBatchFace
+{
+public:
+	struct Op
+	{
+		std::string key;
+		std::string value;
+		bool kill;
+	};
+
+	void insert(bytesConstRef _key, bytesConstRef _value) override { m_ops.push_back(Op{_key.toString(), _value.toString(), false}); }
+	void kill(bytesConstRef _key) override { m_ops.push_back(Op{_key.toString(), std::string(), true}); }
+	size_t size() const override { return m_ops.size(); }
+
+	std::vector<Op> const& ops() const { return m_ops; }
+
+private:
+	std::vector<Op> m_ops;
+};
+
+/**
+ * @brief A consistent, read-only view of a database as it was when the snapshot was taken.
+ */
+class DatabaseSnapshotFace
+{
+public:
+	virtual ~DatabaseSnapshotFace() {}
+
+	virtual bool get(bytesConstRef _key, std::string& o_value) const = 0;
+	/// Visits entries in key order until @a _f returns false.
+	virtual void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const = 0;
+};
+
+/**
+ * @brief Key-value storage engine behind OverlayDB and friends.
+ *
+ * Engines: LDBDatabase (LevelDB, or RocksDB with ETH_ROCKSDB), MemoryDatabase and MMapDatabase. Pick one at
+ * run time through openDatabase(); the default is fixed at build time (see defaultDatabaseKind()).
+ * Failed writes throw DatabaseError.
+ */
+class DatabaseFace
+{
+public:
+	virtual ~DatabaseFace() {}
+
+	/// @returns true and sets @a o_value if @a _key is present.
+	virtual bool get(bytesConstRef _key, std::string& o_value) const = 0;
+	/// Batched get(); @a o_values is resized to match @a _keys, with empty strings for missing keys.
+	virtual void getMany(std::vector<bytesConstRef> const& _keys, std::vector<std::string>& o_values) const;
+	virtual bool exists(bytesConstRef _key) const { std::string v; return get(_key, v); }
+
+	/// Zero-copy reads, for engines where zeroCopy() is true: @a o_value then points into the engine's
+	/// own storage and remains valid until the database is closed.
+	virtual bool zeroCopy() const { return false; }
+	virtual bool getRef(bytesConstRef _key, bytesConstRef& o_value) const { (void)_key; (void)o_value; return false; }
+
+	virtual void put(bytesConstRef _key, bytesConstRef _value) = 0;
+	virtual void kill(bytesConstRef _key) = 0;
+
+	virtual std::unique_ptr<WriteBatchFace> createWriteBatch() const = 0;
+	/// Applies @a _batch atomically. The batch is left untouched, so a failed commit may be retried.
+	virtual void commit(WriteBatchFace& _batch) = 0;
+
+	/// Visits entries in key order until @a _f returns false.
+	virtual void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const = 0;
+	virtual std::unique_ptr<DatabaseSnapshotFace> snapshot() const = 0;
+};
+
+enum class DatabaseKind
+{
+	LDB,		///< LevelDB, or RocksDB when built with ETH_ROCKSDB.
+	Memory,		///< Volatile; for benchmarks and tests.
+	MMap		///< Append-only memory-mapped file with zero-copy reads.
+};
+
+/// The engine chosen at build time: ETH_DB_MMAP or ETH_DB_MEMORY, otherwise LDB.
+DatabaseKind defaultDatabaseKind();
+
+/// Opens (creating if necessary) a database of kind @a _kind at @a _path; throws DatabaseError on failure.
+std::unique_ptr<DatabaseFace> openDatabase(std::string const& _path, DatabaseKind _kind = defaultDatabaseKind());
+
+}
@@ -0,0 +1,566 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Arena.h"
+#include "Common.h"
+#include "FixedHash.h"
+#include "SHA3.h"
+#include "TrieCommon.h"
+#include "TrieDB.h"
+
+namespace dev
+{
+
+/**
+ * @brief Merkle Patricia trie that keeps changes as a mutable in-memory node tree until commit().
+ *
+ * GenericTrieDB encodes, hashes and stores every node on the path to the root on each insert() and
+ * remove(), and kills the nodes they replace, so updating the same keys repeatedly hashes and stores
+ * intermediate nodes only to kill them again. Here insert() and remove() merely load the nodes they
+ * touch and mark them dirty. root() hashes the dirty nodes (each once, until it changes again) and
+ * commit() writes them to the database, killing the nodes they replaced, in a single pass.
+ *
+ * The committed database contents and root are the same as GenericTrieDB would leave after the same
+ * sequence of insert() and remove() calls. Keys are taken as is; hash them first for secure tries.
+ * Unchanged subtries are never loaded, and reads of them go straight to the database.
+ */
+template <class _DB>
+class DeferredTrieDB
+{
+public:
+	using DB = _DB;
+
+	explicit DeferredTrieDB(DB* _db = nullptr): m_db(_db) {}
+	DeferredTrieDB(DB* _db, h256 const& _root, Verification _v = Verification::Normal) { open(_db, _root, _v); }
+
+	void open(DB* _db) { m_db = _db; }
+	void open(DB* _db, h256 const& _root, Verification _v = Verification::Normal) { m_db = _db; setRoot(_root, _v); }
+
+	void init() { GenericTrieDB<DB> t(m_db); t.init(); setRoot(t.root(), Verification::Skip); }
+	/// Drops any uncommitted changes.
+	void setRoot(h256 const& _root, Verification _v = Verification::Normal)
+	{
+		m_root = GenericTrieDB<DB>(m_db, _root, _v).root();
+		rollback();
+	}
+
+	std::string at(bytes const& _key) const { return at(&_key); }
+	std::string at(bytesConstRef _key) const { return atAux(m_top, NibbleSlice(_key)); }
+	bool contains(bytes const& _key) const { return contains(&_key); }
+	bool contains(bytesConstRef _key) const { return !at(_key).empty(); }
+
+	void insert(bytes const& _key, bytes const& _value) { insert(&_key, &_value); }
+	void insert(bytesConstRef _key, bytesConstRef _value);
+	void remove(bytes const& _key) { remove(&_key); }
+	void remove(bytesConstRef _key);
+
+	/// True if there are uncommitted changes.
+	bool isDirty() const { return m_dirty; }
+	/// The root the trie has with the uncommitted changes. Hashes what is dirty but writes nothing.
+	h256 root() const;
+	/// Writes the changes to the database. @returns the new root.
+	h256 const& commit();
+	/// Drops the uncommitted changes.
+	void rollback();
+
+	DB const* db() const { return m_db; }
+	DB* db() { return m_db; }
+
+private:
+	struct Node;
+
+	/// A child slot: a loaded node, or else the reference to one as found in the parent (a hash, an inline
+	/// node or nothing). The reference stays valid while the node is loaded but clean.
+	struct Ref
+	{
+		bytes rlp;
+		std::unique_ptr<Node> node;
+	};
+
+	enum class Kind { Leaf, Extension, Branch };
+
+	struct Node
+	{
+		Kind kind;
+		bytes key;					///< Leaves and extensions: the partial key, one nibble per byte.
+		bytes value;				///< Leaves: the value; branches: the value at this node, if any.
+		Ref child;					///< Extensions: the child.
+		std::vector<Ref> children;	///< Branches: the 16 children.
+		h256 origin;				///< Hash it was loaded from; null if it was inline or is new.
+		bool dirty = false;
+		mutable bytes rlp;			///< Cached encoding of a dirty node; empty when out of date.
+		mutable h256 hash;			///< Cached hash, if rlp is 32 bytes or more.
+	};
+
+	static std::unique_ptr<Node> makeNode(Kind _kind, bytes&& _key = bytes())
+	{
+		std::unique_ptr<Node> ret(new Node);
+		ret->kind = _kind;
+		ret->key = std::move(_key);
+		ret->dirty = true;
+		if (_kind == Kind::Branch)
+			ret->children.resize(16);
+		return ret;
+	}
+	static bytes nibbles(NibbleSlice _s) { bytes ret(_s.size()); for (unsigned i = 0; i < _s.size(); ++i) ret[i] = _s[i]; return ret; }
+	static unsigned shared(bytes const& _a, NibbleSlice _b) { unsigned i = 0; while (i < _a.size() && i < _b.size() && _a[i] == _b[i]) ++i; return i; }
+
+	/// Makes sure @a _r's node is loaded. @returns false if there is none.
+	bool load(Ref& _r);
+	void loadTop();
+	/// Marks @a _n as changed; the node it was loaded from is now to be killed.
+	void touch(Node& _n) { if (!_n.dirty) { _n.dirty = true; if (_n.origin) m_dead.push_back(_n.origin); } _n.rlp.clear(); }
+	/// @a _n goes away.
+	void discard(Node const& _n) { if (!_n.dirty && _n.origin) m_dead.push_back(_n.origin); }
+
+	void insertAt(Ref& _r, NibbleSlice _key, bytesConstRef _value);
+	bool removeAt(Ref& _r, NibbleSlice _key);
+	/// Puts a branch left with a single item into canonical form.
+	void collapse(Ref& _r);
+
+	std::string atAux(Ref const& _r, NibbleSlice _key) const;
+
+	/// Encodes @a _n, whose dirty children must be encoded already; with @a _hash, hashes it too if needed.
+	bytes const& encode(Node const& _n, bool _hash = true) const;
+	void appendRef(RLPStream& _s, Ref const& _r) const;
+	/// Encodes and hashes the out-of-date nodes beneath @a _r, deepest first, a level at a time, so that
+	/// each level is hashed with one sha3Batch().
+	void hashDirty(Ref const& _r) const;
+	void collectStale(Ref const& _r, unsigned _depth, ArenaVector<ArenaVector<Node const*>>& o_levels) const;
+	/// Inserts every dirty node beneath @a _r into the database.
+	void store(Ref const& _r);
+
+	h256 m_root;
+	Ref m_top;					///< The root; its node's origin is left null since m_root is killed separately.
+	bool m_dirty = false;
+	h256s m_dead;				///< Stored nodes replaced by the uncommitted changes.
+	DB* m_db = nullptr;
+	mutable Arena m_scratch{MemoryTag::Trie, 16 * 1024};	///< hashDirty()'s per-call working lists.
+};
+
+template <class DB> bool DeferredTrieDB<DB>::load(Ref& _r)
+{
+	if (_r.node)
+		return true;
+	if (_r.rlp.empty())
+		return false;
+	RLP r(_r.rlp);
+	if (r.isEmpty())
+	{
+		_r.rlp.clear();
+		return false;
+	}
+	std::string stored;
+	h256 origin;
+	if (!r.isList())
+	{
+		origin = r.toHash<h256>();
+		stored = m_db->lookup(origin);
+		if (stored.empty())
+			BOOST_THROW_EXCEPTION(InvalidTrie());
+		r = RLP(stored);
+		if (r.isEmpty())
+		{
+			// Only the root may be an empty node.
+			_r.rlp.clear();
+			return false;
+		}
+	}
+	std::unique_ptr<Node> n(new Node);
+	n->origin = origin;
+	if (r.itemCount() == 2)
+	{
+		n->kind = isLeaf(r) ? Kind::Leaf : Kind::Extension;
+		n->key = nibbles(keyOf(r));
+		if (n->kind == Kind::Leaf)
+			n->value = r[1].payload().toBytes();
+		else
+			n->child.rlp = r[1].data().toBytes();
+	}
+	else if (r.itemCount() == 17)
+	{
+		n->kind = Kind::Branch;
+		n->children.resize(16);
+		for (unsigned i = 0; i < 16; ++i)
+			if (!r[i].isEmpty())
+				n->children[i].rlp = r[i].data().toBytes();
+		n->value = r[16].payload().toBytes();
+	}
+	else
+		BOOST_THROW_EXCEPTION(InvalidTrie());
+	_r.node = std::move(n);
+	return true;
+}
+
+template <class DB> void DeferredTrieDB<DB>::loadTop()
+{
+	if (!m_top.node && load(m_top))
+		m_top.node->origin = h256();
+}
+
+template <class DB> void DeferredTrieDB<DB>::insert(bytesConstRef _key, bytesConstRef _value)
+{
+	loadTop();
+	insertAt(m_top, NibbleSlice(_key), _value);
+	m_dirty = true;
+}
+
+template <class DB> void DeferredTrieDB<DB>::remove(bytesConstRef _key)
+{
+	loadTop();
+	if (removeAt(m_top, NibbleSlice(_key)))
+		m_dirty = true;
+}
+
+template <class DB> void DeferredTrieDB<DB>::insertAt(Ref& _r, NibbleSlice _key, bytesConstRef _value)
+{
+	if (!load(_r))
+	{
+		_r.node = makeNode(Kind::Leaf, nibbles(_key));
+		_r.node->value = _value.toBytes();
+		return;
+	}
+	Node& n = *_r.node;
+	if (n.kind == Kind::Branch)
+	{
+		touch(n);
+		if (_key.empty())
+			n.value = _value.toBytes();
+		else
+			insertAt(n.children[_key[0]], _key.mid(1), _value);
+		return;
+	}
+
+	unsigned p = shared(n.key, _key);
+	if (n.kind == Kind::Leaf && p == n.key.size() && p == _key.size())
+	{
+		touch(n);
+		n.value = _value.toBytes();
+		return;
+	}
+	if (n.kind == Kind::Extension && p == n.key.size())
+	{
+		touch(n);
+		insertAt(n.child, _key.mid(p), _value);
+		return;
+	}
+
+	// Keys part at nibble p: a branch there (beneath an extension for the shared part) takes what is left
+	// of this node and a new leaf.
+	std::unique_ptr<Node> old = std::move(_r.node);
+	touch(*old);
+	bytes prefix(old->key.begin(), old->key.begin() + p);
+	std::unique_ptr<Node> b = makeNode(Kind::Branch);
+	if (old->kind == Kind::Leaf && p == old->key.size())
+		b->value = std::move(old->value);
+	else
+	{
+		byte i = old->key[p];
+		if (old->kind == Kind::Extension && old->key.size() == p + 1)
+			b->children[i] = std::move(old->child);
+		else
+		{
+			old->key.erase(old->key.begin(), old->key.begin() + p + 1);
+			b->children[i].node = std::move(old);
+		}
+	}
+	if (p == _key.size())
+		b->value = _value.toBytes();
+	else
+	{
+		Ref& leaf = b->children[_key[p]];
+		leaf.node = makeNode(Kind::Leaf, nibbles(_key.mid(p + 1)));
+		leaf.node->value = _value.toBytes();
+	}
+	if (p)
+	{
+		_r.node = makeNode(Kind::Extension, std::move(prefix));
+		_r.node->child.node = std::move(b);
+	}
+	else
+		_r.node = std::move(b);
+}
+
+template <class DB> bool DeferredTrieDB<DB>::removeAt(Ref& _r, NibbleSlice _key)
+{
+	if (!load(_r))
+		return false;
+	Node& n = *_r.node;
+	if (n.kind == Kind::Leaf)
+	{
+		if (n.key.size() != _key.size() || shared(n.key, _key) != n.key.size())
+			return false;
+		discard(n);
+		_r.node.reset();
+		_r.rlp.clear();
+		return true;
+	}
+	if (n.kind == Kind::Extension)
+	{
+		unsigned s = n.key.size();
+		if (shared(n.key, _key) != s || !removeAt(n.child, _key.mid(s)))
+			return false;
+		touch(n);
+		// A branch beneath may have collapsed into a leaf or extension; if so, absorb it.
+		load(n.child);
+		Node& c = *n.child.node;
+		if (c.kind != Kind::Branch)
+		{
+			touch(c);
+			c.key.insert(c.key.begin(), n.key.begin(), n.key.end());
+			std::unique_ptr<Node> keep = std::move(n.child.node);
+			_r.node = std::move(keep);
+		}
+		return true;
+	}
+
+	if (_key.empty())
+	{
+		if (n.value.empty())
+			return false;
+		touch(n);
+		n.value.clear();
+	}
+	else if (removeAt(n.children[_key[0]], _key.mid(1)))
+		touch(n);
+	else
+		return false;
+	collapse(_r);
+	return true;
+}
+
+template <class DB> void DeferredTrieDB<DB>::collapse(Ref& _r)
+{
+	Node& n = *_r.node;
+	unsigned used = n.value.empty() ? 0 : 1;
+	int only = -1;
+	for (unsigned i = 0; i < 16; ++i)
+		if (n.children[i].node || !n.children[i].rlp.empty())
+		{
+			++used;
+			only = i;
+		}
+	if (used != 1)
+		return;
+
+	if (only < 0)
+	{
+		// Just the value: a leaf with an empty key.
+		std::unique_ptr<Node> leaf = makeNode(Kind::Leaf);
+		leaf->value = std::move(n.value);
+		_r.node = std::move(leaf);
+		return;
+	}
+	Ref& c = n.children[only];
+	load(c);
+	if (c.node->kind == Kind::Branch)
+	{
+		// The branch stays where it is, behind a one-nibble extension.
+		std::unique_ptr<Node> ext = makeNode(Kind::Extension, bytes(1, (byte)only));
+		ext->child = std::move(c);
+		_r.node = std::move(ext);
+	}
+	else
+	{
+		touch(*c.node);
+		c.node->key.insert(c.node->key.begin(), (byte)only);
+		std::unique_ptr<Node> keep = std::move(c.node);
+		_r.node = std::move(keep);
+	}
+}
+
+template <class DB> std::string DeferredTrieDB<DB>::atAux(Ref const& _r, NibbleSlice _key) const
+{
+	if (Node const* n = _r.node.get())
+	{
+		unsigned s = shared(n->key, _key);
+		switch (n->kind)
+		{
+		case Kind::Leaf:
+			return s == n->key.size() && s == _key.size() ? asString(n->value) : std::string();
+		case Kind::Extension:
+			return s == n->key.size() ? atAux(n->child, _key.mid(s)) : std::string();
+		default:
+			return _key.empty() ? asString(n->value) : atAux(n->children[_key[0]], _key.mid(1));
+		}
+	}
+	if (_r.rlp.empty())
+		return std::string();
+
+	// Not loaded: walk the stored nodes as GenericTrieDB::atRef() does.
+	NodeRef held;
+	RLP here(_r.rlp);
+	while (true)
+	{
+		if (!here.isList())
+		{
+			if (here.isEmpty())
+				return std::string();
+			held = m_db->lookupRef(here.toHash<h256>());
+			here = RLP(held.data());
+		}
+		if (here.isEmpty() || here.isNull())
+			return std::string();
+		if (here.itemCount() == 2)
+		{
+			auto k = keyOf(here);
+			if (_key == k && isLeaf(here))
+				return here[1].toString();
+			if (!_key.contains(k) || isLeaf(here))
+				return std::string();
+			_key = _key.mid(k.size());
+			here = here[1];
+		}
+		else
+		{
+			if (_key.empty())
+				return here[16].toString();
+			here = here[_key[0]];
+			_key = _key.mid(1);
+		}
+	}
+}
+
+template <class DB> bytes const& DeferredTrieDB<DB>::encode(Node const& _n, bool _hash) const
+{
+	if (!_n.rlp.empty())
+		return _n.rlp;
+	RLPStream s;
+	if (_n.kind == Kind::Branch)
+	{
+		s.appendList(17);
+		for (auto const& c: _n.children)
+			appendRef(s, c);
+		s << _n.value;
+	}
+	else
+	{
+		s.appendList(2) << hexPrefixEncode(_n.key, _n.kind == Kind::Leaf);
+		if (_n.kind == Kind::Leaf)
+			s << _n.value;
+		else
+			appendRef(s, _n.child);
+	}
+	s.swapOut(_n.rlp);
+	if (_hash && _n.rlp.size() >= 32)
+		_n.hash = sha3(_n.rlp);
+	return _n.rlp;
+}
+
+template <class DB> void DeferredTrieDB<DB>::collectStale(Ref const& _r, unsigned _depth, ArenaVector<ArenaVector<Node const*>>& o_levels) const
+{
+	Node const* n = _r.node.get();
+	// Any change beneath a node clears its encoding too, so an encoded node has nothing stale below it.
+	if (!n || !n->dirty || !n->rlp.empty())
+		return;
+	while (o_levels.size() <= _depth)
+		o_levels.emplace_back(o_levels.get_allocator());
+	o_levels[_depth].push_back(n);
+	if (n->kind == Kind::Branch)
+		for (auto const& c: n->children)
+			collectStale(c, _depth + 1, o_levels);
+	else if (n->kind == Kind::Extension)
+		collectStale(n->child, _depth + 1, o_levels);
+}
+
+template <class DB> void DeferredTrieDB<DB>::hashDirty(Ref const& _r) const
+{
+	m_scratch.reset();
+	ArenaAllocator<Node const*> scratch(m_scratch);
+	ArenaVector<ArenaVector<Node const*>> levels(scratch);
+	collectStale(_r, 0, levels);
+	ArenaVector<bytesConstRef> in(scratch);
+	ArenaVector<Node const*> hashed(scratch);
+	ArenaVector<h256> out(scratch);
+	for (auto l = levels.rbegin(); l != levels.rend(); ++l)
+	{
+		in.clear();
+		hashed.clear();
+		for (Node const* n: *l)
+			if (encode(*n, false).size() >= 32)
+			{
+				in.push_back(&n->rlp);
+				hashed.push_back(n);
+			}
+		out.resize(in.size());
+		sha3Batch(in.data(), in.size(), out.data());
+		for (size_t i = 0; i < hashed.size(); ++i)
+			hashed[i]->hash = out[i];
+	}
+}
+
+template <class DB> void DeferredTrieDB<DB>::appendRef(RLPStream& _s, Ref const& _r) const
+{
+	if (_r.node && _r.node->dirty)
+	{
+		bytes const& e = encode(*_r.node);
+		if (e.size() < 32)
+			_s.appendRaw(e);
+		else
+			_s << _r.node->hash;
+	}
+	else if (!_r.rlp.empty())
+		_s.appendRaw(_r.rlp);
+	else
+		_s << "";
+}
+
+template <class DB> h256 DeferredTrieDB<DB>::root() const
+{
+	if (!m_dirty)
+		return m_root;
+	if (!m_top.node)
+		return sha3(rlp(""));
+	hashDirty(m_top);
+	// The root is always stored by hash, however short.
+	bytes const& e = encode(*m_top.node);
+	return e.size() >= 32 ? m_top.node->hash : sha3(e);
+}
+
+template <class DB> void DeferredTrieDB<DB>::store(Ref const& _r)
+{
+	Node const* n = _r.node.get();
+	if (!n || !n->dirty)
+		return;
+	if (n->kind == Kind::Branch)
+		for (auto const& c: n->children)
+			store(c);
+	else if (n->kind == Kind::Extension)
+		store(n->child);
+	bytes const& e = encode(*n);
+	if (e.size() >= 32)
+		m_db->insert(n->hash, &e);
+}
+
+template <class DB> h256 const& DeferredTrieDB<DB>::commit()
+{
+	if (!m_dirty)
+		return m_root;
+	h256 newRoot = root();
+	for (auto const& h: m_dead)
+		m_db->kill(h);
+	m_db->kill(m_root);
+	if (m_top.node)
+	{
+		store(m_top);
+		bytes const& e = encode(*m_top.node);
+		if (e.size() < 32)
+			m_db->insert(newRoot, &e);
+	}
+	else
+		m_db->insert(newRoot, &RLPNull);
+	m_root = newRoot;
+	rollback();
+	return m_root;
+}
+
+template <class DB> void DeferredTrieDB<DB>::rollback()
+{
+	m_top.node.reset();
+	m_top.rlp = rlp(m_root);
+	m_dead.clear();
+	m_dirty = false;
+}
+
+}
@@ -0,0 +1,83 @@
+#include "EventCount.h"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+#if defined(__linux__)
+
+namespace
+{
+
+long futex(atomic<uint32_t>* _addr, int _op, uint32_t _value, timespec const* _timeout = nullptr)
+{
+	static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+	return syscall(SYS_futex, reinterpret_cast<uint32_t*>(_addr), _op, _value, _timeout, nullptr, 0);
+}
+
+}
+
+void EventCount::wait(Key _key)
+{
+	futex(&m_epoch, FUTEX_WAIT_PRIVATE, _key);
+	m_waiters.fetch_sub(1, memory_order_seq_cst);
+}
+
+bool EventCount::waitFor(Key _key, chrono::milliseconds _timeout)
+{
+	timespec t;
+	t.tv_sec = _timeout.count() / 1000;
+	t.tv_nsec = (_timeout.count() % 1000) * 1000000;
+	long r = futex(&m_epoch, FUTEX_WAIT_PRIVATE, _key, &t);
+	m_waiters.fetch_sub(1, memory_order_seq_cst);
+	return !(r == -1 && errno == ETIMEDOUT);
+}
+
+void EventCount::wake(bool _all)
+{
+	m_epoch.fetch_add(1, memory_order_seq_cst);
+	futex(&m_epoch, FUTEX_WAKE_PRIVATE, _all ? INT_MAX : 1);
+}
+
+#else
+
+void EventCount::wait(Key _key)
+{
+	unique_lock<mutex> l(x_sleep);
+	m_sleep.wait(l, [&]() { return m_epoch.load() != _key; });
+	m_waiters.fetch_sub(1, memory_order_seq_cst);
+}
+
+bool EventCount::waitFor(Key _key, chrono::milliseconds _timeout)
+{
+	unique_lock<mutex> l(x_sleep);
+	bool ret = m_sleep.wait_for(l, _timeout, [&]() { return m_epoch.load() != _key; });
+	m_waiters.fetch_sub(1, memory_order_seq_cst);
+	return ret;
+}
+
+void EventCount::wake(bool _all)
+{
+	{
+		lock_guard<mutex> l(x_sleep);
+		m_epoch.fetch_add(1, memory_order_seq_cst);
+	}
+	if (_all)
+		m_sleep.notify_all();
+	else
+		m_sleep.notify_one();
+}
+
+#endif
+
+}
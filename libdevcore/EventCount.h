@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace dev
+{
+
+/**
+ * @brief Lets threads sleep until a lock-free condition may have changed, at no cost to notifiers when
+ * nobody sleeps.
+ *
+ * A waiter calls prepareWait(), checks its condition once more and then either cancelWait()s or
+ * wait()s with the key it got. A notifier makes the condition true and calls notifyOne() or
+ * notifyAll(), which do nothing but an atomic load unless someone is waiting. A notification between
+ * prepareWait() and wait() is not lost: wait() then returns at once. On Linux sleeping is a futex on
+ * the epoch counter; elsewhere it falls back to a condition variable.
+ */
+class EventCount
+{
+public:
+	using Key = uint32_t;
+
+	Key prepareWait() { m_waiters.fetch_add(1, std::memory_order_seq_cst); return m_epoch.load(std::memory_order_seq_cst); }
+	void cancelWait() { m_waiters.fetch_sub(1, std::memory_order_seq_cst); }
+	/// Sleeps unless notified since prepareWait() returned @a _key. Spurious returns are possible.
+	void wait(Key _key);
+	/// As wait(), giving up after @a _timeout. @returns false on timeout.
+	bool waitFor(Key _key, std::chrono::milliseconds _timeout);
+
+	void notifyOne() { notify(false); }
+	void notifyAll() { notify(true); }
+
+private:
+	void notify(bool _all)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_waiters.load(std::memory_order_seq_cst))
+			wake(_all);
+	}
+	void wake(bool _all);
+
+	std::atomic<uint32_t> m_epoch{0};
+	std::atomic<uint32_t> m_waiters{0};
+#if !defined(__linux__)
+	std::mutex x_sleep;
+	std::condition_variable m_sleep;
+#endif
+};
+
+}
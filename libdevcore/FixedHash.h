@@ -7,6 +7,7 @@
 #include <boost/random/uniform_int_distribution.hpp>
 #include <boost/functional/hash.hpp>
 #include "CommonData.h"
+#include "FixedHashOps.h"
 
 namespace dev
 {
@@ -69,22 +70,22 @@ public:
 	operator Arith() const { return fromBigEndian<Arith>(m_data); }
 
 	/// @returns true iff this is the empty hash.
-	explicit operator bool() const { return std::any_of(m_data.begin(), m_data.end(), [](byte _b) { return _b != 0; }); }
+	explicit operator bool() const { return !hashops::isZero<N>(data()); }
 
 	// The obvious comparison operators.
-	bool operator==(FixedHash const& _c) const { return m_data == _c.m_data; }
-	bool operator!=(FixedHash const& _c) const { return m_data != _c.m_data; }
-	bool operator<(FixedHash const& _c) const { for (unsigned i = 0; i < N; ++i) if (m_data[i] < _c.m_data[i]) return true; else if (m_data[i] > _c.m_data[i]) return false; return false; }
+	bool operator==(FixedHash const& _c) const { return hashops::equal<N>(data(), _c.data()); }
+	bool operator!=(FixedHash const& _c) const { return !operator==(_c); }
+	bool operator<(FixedHash const& _c) const { return hashops::less<N>(data(), _c.data()); }
 	bool operator>=(FixedHash const& _c) const { return !operator<(_c); }
-	bool operator<=(FixedHash const& _c) const { return operator==(_c) || operator<(_c); }
-	bool operator>(FixedHash const& _c) const { return !operator<=(_c); }
+	bool operator<=(FixedHash const& _c) const { return !_c.operator<(*this); }
+	bool operator>(FixedHash const& _c) const { return _c.operator<(*this); }
 
 	// The obvious binary operators.
-	FixedHash& operator^=(FixedHash const& _c) { for (unsigned i = 0; i < N; ++i) m_data[i] ^= _c.m_data[i]; return *this; }
+	FixedHash& operator^=(FixedHash const& _c) { hashops::xorInto<N>(data(), _c.data()); return *this; }
 	FixedHash operator^(FixedHash const& _c) const { return FixedHash(*this) ^= _c; }
-	FixedHash& operator|=(FixedHash const& _c) { for (unsigned i = 0; i < N; ++i) m_data[i] |= _c.m_data[i]; return *this; }
+	FixedHash& operator|=(FixedHash const& _c) { hashops::orInto<N>(data(), _c.data()); return *this; }
 	FixedHash operator|(FixedHash const& _c) const { return FixedHash(*this) |= _c; }
-	FixedHash& operator&=(FixedHash const& _c) { for (unsigned i = 0; i < N; ++i) m_data[i] &= _c.m_data[i]; return *this; }
+	FixedHash& operator&=(FixedHash const& _c) { hashops::andInto<N>(data(), _c.data()); return *this; }
 	FixedHash operator&(FixedHash const& _c) const { return FixedHash(*this) &= _c; }
 	FixedHash operator~() const { FixedHash ret; for (unsigned i = 0; i < N; ++i) ret[i] = ~m_data[i]; return ret; }
 
@@ -92,7 +93,10 @@ public:
 	FixedHash& operator++() { for (unsigned i = size; i > 0 && !++m_data[--i]; ) {} return *this; }
 
 	/// @returns true if all one-bits in @a _c are set in this object.
-	bool contains(FixedHash const& _c) const { return (*this & _c) == _c; }
+	bool contains(FixedHash const& _c) const { return hashops::containsAll<N>(data(), _c.data()); }
+
+	/// @returns the number of one-bits.
+	unsigned popcount() const { return hashops::popcount<N>(data()); }
 
 	/// @returns a particular byte from the hash.
 	byte& operator[](unsigned _i) { return m_data[_i]; }
@@ -143,20 +147,46 @@ public:
 	struct hash
 	{
 		/// Make a hash of the object's data.
-		size_t operator()(FixedHash const& _value) const { return boost::hash_range(_value.m_data.cbegin(), _value.m_data.cend()); }
+		size_t operator()(FixedHash const& _value) const { return (size_t)hashops::hash<N>(_value.data()); }
 	};
 
+	/// Sets the @a P bits of @a _h's bloom in this.
 	template <unsigned P, unsigned M> inline FixedHash& shiftBloom(FixedHash<M> const& _h)
 	{
-		return (*this |= _h.template bloomPart<P, N>());
+		for (unsigned i = 0; i < P; ++i)
+		{
+			unsigned index = _h.template bloomIndex<P, N>(i);
+			m_data[N - 1 - index / 8] |= (1 << (index % 8));
+		}
+		return *this;
 	}
 
-	template <unsigned P, unsigned M> inline bool containsBloom(FixedHash<M> const& _h)
+	/// @returns true if all @a P bits of @a _h's bloom are set in this; tests just those bits.
+	template <unsigned P, unsigned M> inline bool containsBloom(FixedHash<M> const& _h) const
 	{
-		return contains(_h.template bloomPart<P, N>());
+		for (unsigned i = 0; i < P; ++i)
+		{
+			unsigned index = _h.template bloomIndex<P, N>(i);
+			if (!(m_data[N - 1 - index / 8] & (1 << (index % 8))))
+				return false;
+		}
+		return true;
 	}
 
 	template <unsigned P, unsigned M> inline FixedHash<M> bloomPart() const
+	{
+		FixedHash<M> ret;
+		for (unsigned i = 0; i < P; ++i)
+		{
+			unsigned index = bloomIndex<P, M>(i);
+			ret[M - 1 - index / 8] |= (1 << (index % 8));
+		}
+		return ret;
+	}
+
+	/// @returns the bit, counted from the least significant, that part @a _i of this hash sets in an
+	/// @a M byte bloom of @a P parts.
+	template <unsigned P, unsigned M> inline unsigned bloomIndex(unsigned _i) const
 	{
 		unsigned const c_bloomBits = M * 8;
 		unsigned const c_mask = c_bloomBits - 1;
@@ -165,17 +195,11 @@ public:
 		static_assert((M & (M - 1)) == 0, "M must be power-of-two");
 		static_assert(P * c_bloomBytes <= N, "out of range");
 
-		FixedHash<M> ret;
-		byte const* p = data();
-		for (unsigned i = 0; i < P; ++i)
-		{
-			unsigned index = 0;
-			for (unsigned j = 0; j < c_bloomBytes; ++j, ++p)
-				index = (index << 8) | *p;
-			index &= c_mask;
-			ret[M - 1 - index / 8] |= (1 << (index % 8));
-		}
-		return ret;
+		unsigned index = 0;
+		byte const* p = data() + _i * c_bloomBytes;
+		for (unsigned j = 0; j < c_bloomBytes; ++j)
+			index = (index << 8) | p[j];
+		return index & c_mask;
 	}
 
 	/// Returns the index of the first bit set to one, or size() * 8 if no bits are set.
@@ -276,21 +300,6 @@ public:
 	void clear() { ref().cleanse(); }
 };
 
-/// Fast equality operator for h256.
-template<> inline bool FixedHash<32>::operator==(FixedHash<32> const& _other) const
-{
-	const uint64_t* hash1 = (const uint64_t*)data();
-	const uint64_t* hash2 = (const uint64_t*)_other.data();
-	return (hash1[0] == hash2[0]) && (hash1[1] == hash2[1]) && (hash1[2] == hash2[2]) && (hash1[3] == hash2[3]);
-}
-
-/// Fast std::hash compatible hash function object for h256.
-template<> inline size_t FixedHash<32>::hash::operator()(FixedHash<32> const& value) const
-{
-	uint64_t const* data = reinterpret_cast<uint64_t const*>(value.data());
-	return boost::hash_range(data, data + 4);
-}
-
 /// Stream I/O for the FixedHash class.
 template <unsigned N>
 inline std::ostream& operator<<(std::ostream& _out, FixedHash<N> const& _h)
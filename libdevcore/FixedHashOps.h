@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "Common.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace dev
+{
+namespace hashops
+{
+
+/**
+ * Whole-array operations on the N bytes of a FixedHash<N>.
+ *
+ * Each operation works in the widest lanes that divide N and that the build targets: 32-byte AVX2
+ * registers, 16-byte SSE2 registers (always there on x86-64), 64-bit words, or single bytes. The
+ * choice is made at compile time, as these are inlined into every hash comparison and map lookup;
+ * h256, h512 and h2048 all take the vector paths, odd sizes such as h160 and h520 the narrower ones.
+ */
+
+inline uint64_t load64(byte const* _p) { uint64_t ret; memcpy(&ret, _p, 8); return ret; }
+inline void store64(byte* _p, uint64_t _v) { memcpy(_p, &_v, 8); }
+
+inline unsigned popcount64(uint64_t _v)
+{
+#if defined(__POPCNT__)
+	return (unsigned)__builtin_popcountll(_v);
+#else
+	_v -= (_v >> 1) & 0x5555555555555555ULL;
+	_v = (_v & 0x3333333333333333ULL) + ((_v >> 2) & 0x3333333333333333ULL);
+	_v = (_v + (_v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return (unsigned)((_v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/// The width in bytes of the lanes used for N-byte arrays.
+template <unsigned N> struct LaneWidth
+{
+	static const unsigned value =
+#if defined(__AVX2__)
+		N % 32 == 0 ? 32 :
+#endif
+#if defined(__SSE2__)
+		N % 16 == 0 ? 16 :
+#endif
+		N % 8 == 0 ? 8 : 1;
+};
+
+template <unsigned W> struct Lanes;
+
+template <> struct Lanes<1>
+{
+	template <unsigned N> static bool equal(byte const* _a, byte const* _b) { return !memcmp(_a, _b, N); }
+	template <unsigned N> static bool less(byte const* _a, byte const* _b) { return memcmp(_a, _b, N) < 0; }
+	template <unsigned N> static bool isZero(byte const* _a) { for (unsigned i = 0; i < N; ++i) if (_a[i]) return false; return true; }
+	template <unsigned N> static bool containsAll(byte const* _a, byte const* _c) { for (unsigned i = 0; i < N; ++i) if (_c[i] & ~_a[i]) return false; return true; }
+	template <unsigned N> static void orInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; ++i) _a[i] |= _b[i]; }
+	template <unsigned N> static void andInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; ++i) _a[i] &= _b[i]; }
+	template <unsigned N> static void xorInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; ++i) _a[i] ^= _b[i]; }
+};
+
+template <> struct Lanes<8>
+{
+	template <unsigned N> static bool equal(byte const* _a, byte const* _b)
+	{
+		uint64_t diff = 0;
+		for (unsigned i = 0; i < N; i += 8)
+			diff |= load64(_a + i) ^ load64(_b + i);
+		return !diff;
+	}
+	template <unsigned N> static bool less(byte const* _a, byte const* _b)
+	{
+		for (unsigned i = 0; i < N; i += 8)
+		{
+			uint64_t a = load64(_a + i);
+			uint64_t b = load64(_b + i);
+			if (a != b)
+				return __builtin_bswap64(a) < __builtin_bswap64(b);
+		}
+		return false;
+	}
+	template <unsigned N> static bool isZero(byte const* _a)
+	{
+		uint64_t acc = 0;
+		for (unsigned i = 0; i < N; i += 8)
+			acc |= load64(_a + i);
+		return !acc;
+	}
+	template <unsigned N> static bool containsAll(byte const* _a, byte const* _c)
+	{
+		uint64_t missing = 0;
+		for (unsigned i = 0; i < N; i += 8)
+			missing |= load64(_c + i) & ~load64(_a + i);
+		return !missing;
+	}
+	template <unsigned N> static void orInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 8) store64(_a + i, load64(_a + i) | load64(_b + i)); }
+	template <unsigned N> static void andInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 8) store64(_a + i, load64(_a + i) & load64(_b + i)); }
+	template <unsigned N> static void xorInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 8) store64(_a + i, load64(_a + i) ^ load64(_b + i)); }
+};
+
+#if defined(__SSE2__)
+template <> struct Lanes<16>
+{
+	static __m128i load(byte const* _p) { return _mm_loadu_si128(reinterpret_cast<__m128i const*>(_p)); }
+	static void store(byte* _p, __m128i _v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(_p), _v); }
+	static bool zero(__m128i _v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(_v, _mm_setzero_si128())) == 0xffff; }
+
+	template <unsigned N> static bool equal(byte const* _a, byte const* _b)
+	{
+		__m128i diff = _mm_setzero_si128();
+		for (unsigned i = 0; i < N; i += 16)
+			diff = _mm_or_si128(diff, _mm_xor_si128(load(_a + i), load(_b + i)));
+		return zero(diff);
+	}
+	template <unsigned N> static bool less(byte const* _a, byte const* _b)
+	{
+		for (unsigned i = 0; i < N; i += 16)
+		{
+			unsigned same = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(load(_a + i), load(_b + i)));
+			if (same != 0xffff)
+			{
+				unsigned at = i + __builtin_ctz(~same);
+				return _a[at] < _b[at];
+			}
+		}
+		return false;
+	}
+	template <unsigned N> static bool isZero(byte const* _a)
+	{
+		__m128i acc = _mm_setzero_si128();
+		for (unsigned i = 0; i < N; i += 16)
+			acc = _mm_or_si128(acc, load(_a + i));
+		return zero(acc);
+	}
+	template <unsigned N> static bool containsAll(byte const* _a, byte const* _c)
+	{
+		__m128i missing = _mm_setzero_si128();
+		for (unsigned i = 0; i < N; i += 16)
+			missing = _mm_or_si128(missing, _mm_andnot_si128(load(_a + i), load(_c + i)));
+		return zero(missing);
+	}
+	template <unsigned N> static void orInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 16) store(_a + i, _mm_or_si128(load(_a + i), load(_b + i))); }
+	template <unsigned N> static void andInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 16) store(_a + i, _mm_and_si128(load(_a + i), load(_b + i))); }
+	template <unsigned N> static void xorInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 16) store(_a + i, _mm_xor_si128(load(_a + i), load(_b + i))); }
+};
+#endif
+
+#if defined(__AVX2__)
+template <> struct Lanes<32>
+{
+	static __m256i load(byte const* _p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(_p)); }
+	static void store(byte* _p, __m256i _v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(_p), _v); }
+
+	template <unsigned N> static bool equal(byte const* _a, byte const* _b)
+	{
+		__m256i diff = _mm256_setzero_si256();
+		for (unsigned i = 0; i < N; i += 32)
+			diff = _mm256_or_si256(diff, _mm256_xor_si256(load(_a + i), load(_b + i)));
+		return _mm256_testz_si256(diff, diff);
+	}
+	template <unsigned N> static bool less(byte const* _a, byte const* _b)
+	{
+		for (unsigned i = 0; i < N; i += 32)
+		{
+			unsigned same = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(load(_a + i), load(_b + i)));
+			if (same != 0xffffffffu)
+			{
+				unsigned at = i + __builtin_ctz(~same);
+				return _a[at] < _b[at];
+			}
+		}
+		return false;
+	}
+	template <unsigned N> static bool isZero(byte const* _a)
+	{
+		__m256i acc = _mm256_setzero_si256();
+		for (unsigned i = 0; i < N; i += 32)
+			acc = _mm256_or_si256(acc, load(_a + i));
+		return _mm256_testz_si256(acc, acc);
+	}
+	template <unsigned N> static bool containsAll(byte const* _a, byte const* _c)
+	{
+		__m256i missing = _mm256_setzero_si256();
+		for (unsigned i = 0; i < N; i += 32)
+			missing = _mm256_or_si256(missing, _mm256_andnot_si256(load(_a + i), load(_c + i)));
+		return _mm256_testz_si256(missing, missing);
+	}
+	template <unsigned N> static void orInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 32) store(_a + i, _mm256_or_si256(load(_a + i), load(_b + i))); }
+	template <unsigned N> static void andInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 32) store(_a + i, _mm256_and_si256(load(_a + i), load(_b + i))); }
+	template <unsigned N> static void xorInto(byte* _a, byte const* _b) { for (unsigned i = 0; i < N; i += 32) store(_a + i, _mm256_xor_si256(load(_a + i), load(_b + i))); }
+};
+#endif
+
+/// Long arrays (blooms) go to memcmp(), which the C library dispatches at runtime to the widest vectors the
+/// CPU has, and which stops at the first difference.
+template <unsigned N> bool equal(byte const* _a, byte const* _b) { return N > 64 ? !memcmp(_a, _b, N) : Lanes<LaneWidth<N>::value>::template equal<N>(_a, _b); }
+/// Big-endian (lexicographic) ordering.
+template <unsigned N> bool less(byte const* _a, byte const* _b) { return Lanes<LaneWidth<N>::value>::template less<N>(_a, _b); }
+template <unsigned N> bool isZero(byte const* _a) { return Lanes<LaneWidth<N>::value>::template isZero<N>(_a); }
+/// @returns true if every bit set in @a _c is set in @a _a.
+template <unsigned N> bool containsAll(byte const* _a, byte const* _c) { return Lanes<LaneWidth<N>::value>::template containsAll<N>(_a, _c); }
+template <unsigned N> void orInto(byte* _a, byte const* _b) { Lanes<LaneWidth<N>::value>::template orInto<N>(_a, _b); }
+template <unsigned N> void andInto(byte* _a, byte const* _b) { Lanes<LaneWidth<N>::value>::template andInto<N>(_a, _b); }
+template <unsigned N> void xorInto(byte* _a, byte const* _b) { Lanes<LaneWidth<N>::value>::template xorInto<N>(_a, _b); }
+
+/// @returns the number of bits set.
+template <unsigned N> unsigned popcount(byte const* _a)
+{
+	unsigned ret = 0;
+	unsigned i = 0;
+	for (; i + 8 <= N; i += 8)
+		ret += popcount64(load64(_a + i));
+	for (; i < N; ++i)
+		ret += popcount64(_a[i]);
+	return ret;
+}
+
+/// A 64-bit hash of the N bytes at @a _a: each word is folded in with a multiply and the result is
+/// finalised as in MurmurHash3, so that every input bit affects every output bit, also for inputs that
+/// are not already uniformly random (blooms, small numbers).
+template <unsigned N> uint64_t hash(byte const* _a)
+{
+	uint64_t const c_multiplier = 0x9e3779b97f4a7c15ULL;
+	uint64_t h = N * c_multiplier;
+	unsigned i = 0;
+	for (; i + 8 <= N; i += 8)
+	{
+		h = (h ^ load64(_a + i)) * c_multiplier;
+		h ^= h >> 32;
+	}
+	if (i < N)
+	{
+		uint64_t tail = 0;
+		memcpy(&tail, _a + i, N - i);
+		h = (h ^ tail) * c_multiplier;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+}
+}
@@ -0,0 +1,141 @@
+#include "Guards.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+atomic<bool> g_lockProfiling{false};
+
+namespace
+{
+
+/// The bias stays off this many times as long as revoking it took.
+const int64_t c_inhibitMultiplier = 9;
+
+atomic<LockSite*> s_sites{nullptr};
+
+int64_t steadyNs()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @returns the last two components of @a _path.
+string shortPath(char const* _path)
+{
+	string p(_path);
+	size_t slash = p.rfind('/');
+	if (slash != string::npos && slash > 0)
+		slash = p.rfind('/', slash - 1);
+	return slash == string::npos ? p : p.substr(slash + 1);
+}
+
+}
+
+unsigned SharedMutex::nextStripe()
+{
+	static atomic<unsigned> s_next{0};
+	return s_next.fetch_add(1, memory_order_relaxed) % c_stripes;
+}
+
+void SharedMutex::lockSharedSlow()
+{
+	m_slow.lock_shared();
+	if (!m_readBias.load(memory_order_relaxed) && steadyNs() >= m_inhibitUntil.load(memory_order_relaxed))
+		m_readBias.store(true, memory_order_relaxed);
+}
+
+void SharedMutex::revokeReadBias()
+{
+	if (!m_readBias.load(memory_order_relaxed))
+		return;
+	int64_t start = steadyNs();
+	m_readBias.store(false, memory_order_seq_cst);
+	for (Stripe& s: m_readers)
+		for (unsigned spins = 0; s.count.load(memory_order_acquire); ++spins)
+			if (spins < 100)
+				this_thread::yield();
+			else
+				this_thread::sleep_for(chrono::microseconds(50));
+	int64_t now = steadyNs();
+	m_inhibitUntil.store(now + (now - start) * c_inhibitMultiplier, memory_order_relaxed);
+}
+
+bool SharedMutex::tryRevokeReadBias()
+{
+	if (!m_readBias.load(memory_order_relaxed))
+		return true;
+	m_readBias.store(false, memory_order_seq_cst);
+	for (Stripe& s: m_readers)
+		if (s.count.load(memory_order_acquire))
+		{
+			m_readBias.store(true, memory_order_relaxed);
+			return false;
+		}
+	return true;
+}
+
+bool SharedMutex::try_lock()
+{
+	if (!m_slow.try_lock())
+		return false;
+	if (tryRevokeReadBias())
+		return true;
+	m_slow.unlock();
+	return false;
+}
+
+LockSite::LockSite(char const* _file, int _line, char const* _name): file(_file), line(_line), name(_name)
+{
+	next = s_sites.load(memory_order_relaxed);
+	while (!s_sites.compare_exchange_weak(next, this, memory_order_release, memory_order_relaxed)) {}
+}
+
+void LockSite::noteWait(chrono::steady_clock::duration _d)
+{
+	uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(_d).count();
+	contended.fetch_add(1, memory_order_relaxed);
+	waitNs.fetch_add(ns, memory_order_relaxed);
+	uint64_t max = maxWaitNs.load(memory_order_relaxed);
+	while (ns > max && !maxWaitNs.compare_exchange_weak(max, ns, memory_order_relaxed)) {}
+}
+
+vector<LockContention> lockContention()
+{
+	vector<LockContention> ret;
+	for (LockSite* s = s_sites.load(memory_order_acquire); s; s = s->next)
+		if (s->contended)
+			ret.push_back(LockContention{shortPath(s->file) + ":" + to_string(s->line), s->name, s->acquisitions, s->contended, s->waitNs / 1e6, s->maxWaitNs / 1e6});
+	sort(ret.begin(), ret.end(), [](LockContention const& _a, LockContention const& _b) { return _a.waitMs > _b.waitMs; });
+	return ret;
+}
+
+string lockContentionReport(unsigned _top)
+{
+	ostringstream out;
+	auto sites = lockContention();
+	out << "Lock contention at " << sites.size() << " sites" << (g_lockProfiling ? "" : " (profiling off)");
+	out << fixed << setprecision(3);
+	for (size_t i = 0; i < sites.size() && i < _top; ++i)
+		out << "\n  " << setw(10) << sites[i].waitMs << " ms waited, " << sites[i].contended << "/" << sites[i].acquisitions << " contended, max "
+			<< sites[i].maxWaitMs << " ms: " << sites[i].name << " at " << sites[i].site;
+	return out.str();
+}
+
+void resetLockContention()
+{
+	for (LockSite* s = s_sites.load(memory_order_acquire); s; s = s->next)
+	{
+		s->acquisitions = 0;
+		s->contended = 0;
+		s->waitNs = 0;
+		s->maxWaitNs = 0;
+	}
+}
+
+}
@@ -3,6 +3,11 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
 #pragma warning(push)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -13,22 +18,191 @@
 namespace dev
 {
 
+/**
+ * @brief Reader-biased shared mutex (BRAVO).
+ *
+ * While the lock is read-biased, a reader only bumps a counter on a cache line it shares with few
+ * other threads (threads are dealt round-robin over c_stripes counters) and never touches the
+ * underlying boost::shared_mutex, so readers on different cores do not contend. A writer takes the
+ * underlying mutex, revokes the bias and waits for the counters to drain. Revocation is slow, so the
+ * bias stays off for a while afterwards, in proportion to what the revocation cost; in the meantime
+ * readers use the underlying mutex, and the first one after that resets the bias.
+ *
+ * Interface and semantics are those of boost::shared_mutex, upgrade locking included.
+ */
+class SharedMutex
+{
+public:
+	SharedMutex() = default;
+	SharedMutex(SharedMutex const&) = delete;
+	SharedMutex& operator=(SharedMutex const&) = delete;
+
+	void lock() { m_slow.lock(); revokeReadBias(); }
+	bool try_lock();
+	void unlock() { m_slow.unlock(); }
+
+	void lock_shared() { if (!tryFastRead()) lockSharedSlow(); }
+	bool try_lock_shared() { return tryFastRead() || m_slow.try_lock_shared(); }
+	void unlock_shared()
+	{
+		Reader& r = reader();
+		for (unsigned i = r.holds; i--;)
+			if (r.locks[i] == this)
+			{
+				r.locks[i] = r.locks[--r.holds];
+				m_readers[r.stripe].count.fetch_sub(1, std::memory_order_release);
+				return;
+			}
+		m_slow.unlock_shared();
+	}
+
+	void lock_upgrade() { m_slow.lock_upgrade(); }
+	void unlock_upgrade() { m_slow.unlock_upgrade(); }
+	void unlock_upgrade_and_lock() { m_slow.unlock_upgrade_and_lock(); revokeReadBias(); }
+	void unlock_and_lock_upgrade() { m_slow.unlock_and_lock_upgrade(); }
+
+private:
+	static const unsigned c_stripes = 8;
+	static const unsigned c_maxHolds = 8;
+
+	/// A counter of the readers of one stripe, alone on its cache line.
+	struct alignas(64) Stripe
+	{
+		std::atomic<uint32_t> count{0};
+	};
+
+	/// The fast-path read locks a thread holds, so unlock_shared() knows which path a lock took.
+	struct Reader
+	{
+		unsigned stripe = c_stripes;
+		unsigned holds = 0;
+		SharedMutex const* locks[c_maxHolds] = {};
+	};
+
+	static Reader& reader()
+	{
+		static thread_local Reader s_reader;
+		if (s_reader.stripe == c_stripes)
+			s_reader.stripe = nextStripe();
+		return s_reader;
+	}
+	static unsigned nextStripe();
+
+	bool tryFastRead()
+	{
+		if (!m_readBias.load(std::memory_order_relaxed))
+			return false;
+		Reader& r = reader();
+		if (r.holds == c_maxHolds)
+			return false;
+		std::atomic<uint32_t>& count = m_readers[r.stripe].count;
+		count.fetch_add(1, std::memory_order_seq_cst);
+		// Pairs with the store in revokeReadBias(): either we see the revocation or the writer sees us.
+		if (m_readBias.load(std::memory_order_seq_cst))
+		{
+			r.locks[r.holds++] = this;
+			return true;
+		}
+		count.fetch_sub(1, std::memory_order_release);
+		return false;
+	}
+	void lockSharedSlow();
+	/// Turns the bias off and waits for the fast-path readers to leave. Call with m_slow held exclusively.
+	void revokeReadBias();
+	/// As revokeReadBias(), but restores the bias rather than wait. @returns false if there were readers.
+	bool tryRevokeReadBias();
+
+	Stripe m_readers[c_stripes];
+	std::atomic<bool> m_readBias{true};
+	std::atomic<int64_t> m_inhibitUntil{0};		///< Steady-clock nanoseconds before which the bias stays off.
+	boost::shared_mutex m_slow;
+};
+
 using Mutex = std::mutex;
 using RecursiveMutex = std::recursive_mutex;
-using SharedMutex = boost::shared_mutex;
 
 using Guard = std::lock_guard<std::mutex>;
 using UniqueGuard = std::unique_lock<std::mutex>;
 using RecursiveGuard = std::lock_guard<std::recursive_mutex>;
-using ReadGuard = boost::shared_lock<boost::shared_mutex>;
-using UpgradableGuard = boost::upgrade_lock<boost::shared_mutex>;
-using UpgradeGuard = boost::upgrade_to_unique_lock<boost::shared_mutex>;
-using WriteGuard = boost::unique_lock<boost::shared_mutex>;
+using ReadGuard = boost::shared_lock<SharedMutex>;
+using UpgradableGuard = boost::upgrade_lock<SharedMutex>;
+using UpgradeGuard = boost::upgrade_to_unique_lock<SharedMutex>;
+using WriteGuard = boost::unique_lock<SharedMutex>;
+
+/// Whether the DEV_*_GUARDED macros record how long they wait for their locks. Off by default.
+extern std::atomic<bool> g_lockProfiling;
+
+/// A place in the code that takes a lock through a DEV_*_GUARDED macro, with what it waited so far.
+struct LockSite
+{
+	LockSite(char const* _file, int _line, char const* _name);
+
+	void noteWait(std::chrono::steady_clock::duration _d);
+
+	char const* file;
+	int line;
+	char const* name;
+	std::atomic<uint64_t> acquisitions{0};	///< Acquisitions while profiling.
+	std::atomic<uint64_t> contended{0};		///< Acquisitions that had to wait.
+	std::atomic<uint64_t> waitNs{0};
+	std::atomic<uint64_t> maxWaitNs{0};
+	LockSite* next = nullptr;
+};
+
+struct LockContention
+{
+	std::string site;		///< file:line
+	std::string name;		///< The mutex expression.
+	uint64_t acquisitions;
+	uint64_t contended;
+	double waitMs;
+	double maxWaitMs;
+};
+
+/// @returns the lock sites that had to wait since profiling began or was last reset, longest total wait first.
+std::vector<LockContention> lockContention();
+/// @returns lockContention() as a table, at most @a _top lines, for metrics dumps and logs.
+std::string lockContentionReport(unsigned _top = 20);
+void resetLockContention();
+
+template <class GuardType> struct GuardTraits { static const bool shared = false; using Adopt = std::adopt_lock_t; };
+template <class M> struct GuardTraits<boost::shared_lock<M>> { static const bool shared = true; using Adopt = boost::adopt_lock_t; };
+template <class M> struct GuardTraits<boost::unique_lock<M>> { static const bool shared = false; using Adopt = boost::adopt_lock_t; };
+
+/// Locks @a _m exclusively; when profiling, tries first and records at @a _site how long it had to wait.
+template <class MutexType> MutexType& lockAtSite(MutexType& _m, LockSite& _site, std::false_type)
+{
+	if (!g_lockProfiling.load(std::memory_order_relaxed))
+		_m.lock();
+	else if (_site.acquisitions.fetch_add(1, std::memory_order_relaxed), !_m.try_lock())
+	{
+		auto start = std::chrono::steady_clock::now();
+		_m.lock();
+		_site.noteWait(std::chrono::steady_clock::now() - start);
+	}
+	return _m;
+}
+
+/// As above, for shared ownership.
+template <class MutexType> MutexType& lockAtSite(MutexType& _m, LockSite& _site, std::true_type)
+{
+	if (!g_lockProfiling.load(std::memory_order_relaxed))
+		_m.lock_shared();
+	else if (_site.acquisitions.fetch_add(1, std::memory_order_relaxed), !_m.try_lock_shared())
+	{
+		auto start = std::chrono::steady_clock::now();
+		_m.lock_shared();
+		_site.noteWait(std::chrono::steady_clock::now() - start);
+	}
+	return _m;
+}
 
 template <class GuardType, class MutexType>
 struct GenericGuardBool: GuardType
 {
 	GenericGuardBool(MutexType& _m): GuardType(_m) {}
+	GenericGuardBool(MutexType& _m, LockSite& _site):
+		GuardType(lockAtSite(_m, _site, std::integral_constant<bool, GuardTraits<GuardType>::shared>()), typename GuardTraits<GuardType>::Adopt()) {}
 	bool b = true;
 };
 template <class MutexType>
@@ -120,14 +294,18 @@ private:
  * @endcode
  */
 
+/// The LockSite of the macro it is used in; one per place in the code.
+#define DEV_LOCK_SITE(MUTEX) \
+	([]() -> dev::LockSite& { static dev::LockSite s_site(__FILE__, __LINE__, #MUTEX); return s_site; }())
+
 #define DEV_GUARDED(MUTEX) \
-	for (GenericGuardBool<Guard, Mutex> __eth_l(MUTEX); __eth_l.b; __eth_l.b = false)
+	for (GenericGuardBool<Guard, Mutex> __eth_l(MUTEX, DEV_LOCK_SITE(MUTEX)); __eth_l.b; __eth_l.b = false)
 #define DEV_READ_GUARDED(MUTEX) \
-	for (GenericGuardBool<ReadGuard, SharedMutex> __eth_l(MUTEX); __eth_l.b; __eth_l.b = false)
+	for (GenericGuardBool<ReadGuard, SharedMutex> __eth_l(MUTEX, DEV_LOCK_SITE(MUTEX)); __eth_l.b; __eth_l.b = false)
 #define DEV_WRITE_GUARDED(MUTEX) \
-	for (GenericGuardBool<WriteGuard, SharedMutex> __eth_l(MUTEX); __eth_l.b; __eth_l.b = false)
+	for (GenericGuardBool<WriteGuard, SharedMutex> __eth_l(MUTEX, DEV_LOCK_SITE(MUTEX)); __eth_l.b; __eth_l.b = false)
 #define DEV_RECURSIVE_GUARDED(MUTEX) \
-	for (GenericGuardBool<RecursiveGuard, RecursiveMutex> __eth_l(MUTEX); __eth_l.b; __eth_l.b = false)
+	for (GenericGuardBool<RecursiveGuard, RecursiveMutex> __eth_l(MUTEX, DEV_LOCK_SITE(MUTEX)); __eth_l.b; __eth_l.b = false)
 #define DEV_UNGUARDED(MUTEX) \
 	for (GenericUnguardBool<Mutex> __eth_l(MUTEX); __eth_l.b; __eth_l.b = false)
 #define DEV_READ_UNGUARDED(MUTEX) \
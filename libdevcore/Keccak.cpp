@@ -0,0 +1,328 @@
+#include "Keccak.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define DEV_KECCAK_X86 1
+#endif
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+namespace keccak
+{
+
+namespace
+{
+
+/*
+ * The permutation follows libkeccak-tiny (David Leon Gil; CC0): the same constants and the same
+ * macro-unrolled rounds, written once over a lane type so that every kernel shares them. A kernel is the
+ * loop body instantiated for uint64_t (one state) or for a vector holding the same lane of several states.
+ */
+
+static const uint8_t rho[24] =
+	{ 1,  3,   6, 10, 15, 21,
+	28, 36, 45, 55,  2, 14,
+	27, 41, 56,  8, 25, 43,
+	62, 18, 39, 61, 20, 44};
+static const uint8_t pi[24] =
+	{10,  7, 11, 17, 18, 3,
+	5, 16,  8, 21, 24, 4,
+	15, 23, 19, 13, 12, 2,
+	20, 14, 22,  9, 6,  1};
+static const uint64_t RC[24] =
+	{1ULL, 0x8082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+	0x808bULL, 0x80000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x8aULL, 0x88ULL, 0x80008009ULL, 0x8000000aULL,
+	0x8000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL, 0x800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL, 0x80000001ULL, 0x8000000080008008ULL};
+
+#define KECCAK_REPEAT5(e) e e e e e
+#define KECCAK_REPEAT24(e) KECCAK_REPEAT5(e e e e) e e e e
+#define KECCAK_FOR5(v, s, e) \
+	v = 0; \
+	KECCAK_REPEAT5(e; v += s;)
+
+/// Keccak-f[1600] over the 25 lanes @a A of type @a LANE, given laneXor, laneAndNot (~a & b), laneRol and
+/// laneXorConstant for it.
+#define KECCAK_F1600(LANE, A) \
+	{ \
+		LANE b[5]; \
+		LANE t; \
+		unsigned x; \
+		unsigned y; \
+		for (int i = 0; i < 24; ++i) \
+		{ \
+			/* Theta */ \
+			KECCAK_FOR5(x, 1, b[x] = laneXor(laneXor(laneXor(laneXor(A[x], A[x + 5]), A[x + 10]), A[x + 15]), A[x + 20])) \
+			KECCAK_FOR5(x, 1, t = laneXor(b[(x + 4) % 5], laneRol(b[(x + 1) % 5], 1)); KECCAK_FOR5(y, 5, A[y + x] = laneXor(A[y + x], t))) \
+			/* Rho and pi */ \
+			t = A[1]; \
+			x = 0; \
+			KECCAK_REPEAT24(b[0] = A[pi[x]]; A[pi[x]] = laneRol(t, rho[x]); t = b[0]; x++;) \
+			/* Chi */ \
+			KECCAK_FOR5(y, 5, KECCAK_FOR5(x, 1, b[x] = A[y + x]) KECCAK_FOR5(x, 1, A[y + x] = laneXor(b[x], laneAndNot(b[(x + 1) % 5], b[(x + 2) % 5])))) \
+			/* Iota */ \
+			A[0] = laneXorConstant(A[0], RC[i]); \
+		} \
+	}
+
+inline uint64_t laneXor(uint64_t _a, uint64_t _b) { return _a ^ _b; }
+inline uint64_t laneAndNot(uint64_t _a, uint64_t _b) { return ~_a & _b; }
+inline uint64_t laneRol(uint64_t _a, unsigned _s) { return (_a << _s) | (_a >> (64 - _s)); }
+inline uint64_t laneXorConstant(uint64_t _a, uint64_t _c) { return _a ^ _c; }
+
+void permutePortable(uint64_t* _s)
+{
+	uint64_t A[25];
+	memcpy(A, _s, sizeof(A));
+	KECCAK_F1600(uint64_t, A)
+	memcpy(_s, A, sizeof(A));
+}
+
+#if DEV_KECCAK_X86
+
+// Same code; the compiler picks andn and rorx for the lane operations.
+__attribute__((target("bmi,bmi2"))) void permuteBMI2(uint64_t* _s)
+{
+	uint64_t A[25];
+	memcpy(A, _s, sizeof(A));
+	KECCAK_F1600(uint64_t, A)
+	memcpy(_s, A, sizeof(A));
+}
+
+__attribute__((target("avx2"))) inline __m256i laneXor(__m256i _a, __m256i _b) { return _mm256_xor_si256(_a, _b); }
+__attribute__((target("avx2"))) inline __m256i laneAndNot(__m256i _a, __m256i _b) { return _mm256_andnot_si256(_a, _b); }
+__attribute__((target("avx2"))) inline __m256i laneRol(__m256i _a, unsigned _s) { return _mm256_or_si256(_mm256_slli_epi64(_a, _s), _mm256_srli_epi64(_a, 64 - _s)); }
+__attribute__((target("avx2"))) inline __m256i laneXorConstant(__m256i _a, uint64_t _c) { return _mm256_xor_si256(_a, _mm256_set1_epi64x(_c)); }
+
+/// Four interleaved states: lane k of state l at _s[k * 4 + l].
+__attribute__((target("avx2"))) void permuteAVX2(uint64_t* _s)
+{
+	__m256i A[25];
+	for (unsigned k = 0; k < 25; ++k)
+		A[k] = _mm256_load_si256((__m256i const*)(_s + k * 4));
+	KECCAK_F1600(__m256i, A)
+	for (unsigned k = 0; k < 25; ++k)
+		_mm256_store_si256((__m256i*)(_s + k * 4), A[k]);
+}
+
+__attribute__((target("avx512f"))) inline __m512i laneXor(__m512i _a, __m512i _b) { return _mm512_xor_si512(_a, _b); }
+__attribute__((target("avx512f"))) inline __m512i laneAndNot(__m512i _a, __m512i _b) { return _mm512_andnot_si512(_a, _b); }
+__attribute__((target("avx512f"))) inline __m512i laneRol(__m512i _a, unsigned _s) { return _mm512_rolv_epi64(_a, _mm512_set1_epi64(_s)); }
+__attribute__((target("avx512f"))) inline __m512i laneXorConstant(__m512i _a, uint64_t _c) { return _mm512_xor_si512(_a, _mm512_set1_epi64(_c)); }
+
+/// Eight interleaved states: lane k of state l at _s[k * 8 + l].
+__attribute__((target("avx512f"))) void permuteAVX512(uint64_t* _s)
+{
+	__m512i A[25];
+	for (unsigned k = 0; k < 25; ++k)
+		A[k] = _mm512_load_si512((void const*)(_s + k * 8));
+	KECCAK_F1600(__m512i, A)
+	for (unsigned k = 0; k < 25; ++k)
+		_mm512_store_si512((void*)(_s + k * 8), A[k]);
+}
+
+#endif
+
+typedef void (*Permutation)(uint64_t*);
+
+struct KernelInfo
+{
+	Permutation permute;
+	unsigned lanes;				///< States permuted together.
+	Permutation scalar;			///< Used for single inputs.
+};
+
+KernelInfo const& info(Kernel _k)
+{
+	static const KernelInfo c_kernels[] =
+	{
+		{ permutePortable, 1, permutePortable },
+#if DEV_KECCAK_X86
+		{ permuteBMI2, 1, permuteBMI2 },
+		{ permuteAVX2, 4, permuteBMI2 },
+		{ permuteAVX512, 8, permuteBMI2 },
+#endif
+	};
+	return c_kernels[(unsigned)_k];
+}
+
+bool supported(Kernel _k)
+{
+#if DEV_KECCAK_X86
+	// May run before libgcc's own initialisation, e.g. from static initialisers such as EmptySHA3.
+	__builtin_cpu_init();
+	switch (_k)
+	{
+	case Kernel::Portable: return true;
+	case Kernel::BMI2: return __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+	// The multi-buffer kernels fall back to the BMI2 one for single inputs.
+	case Kernel::AVX2: return supported(Kernel::BMI2) && __builtin_cpu_supports("avx2");
+	case Kernel::AVX512: return supported(Kernel::BMI2) && __builtin_cpu_supports("avx512f");
+	}
+	return false;
+#else
+	return _k == Kernel::Portable;
+#endif
+}
+
+atomic<int> s_kernel{-1};
+
+KernelInfo const& current()
+{
+	int k = s_kernel.load(memory_order_relaxed);
+	if (k < 0)
+	{
+		k = (int)supportedKernels().back();
+		s_kernel.store(k, memory_order_relaxed);
+	}
+	return info((Kernel)k);
+}
+
+static const size_t c_rate = 136;	///< Bytes absorbed per permutation for a 256-bit output.
+
+inline uint64_t load64(byte const* _p)
+{
+	uint64_t ret = 0;
+	for (unsigned i = 0; i < 8; ++i)
+		ret |= uint64_t(_p[i]) << (8 * i);
+	return ret;
+}
+
+inline void store64(byte* o_p, uint64_t _v)
+{
+	for (unsigned i = 0; i < 8; ++i)
+		o_p[i] = byte(_v >> (8 * i));
+}
+
+/// Permutations needed for @a _input, the last one for the padded tail.
+inline size_t blockCount(bytesConstRef _input) { return _input.size() / c_rate + 1; }
+
+/// XORs block @a _b of @a _input, padded if it is the last, into state @a _l of the @a _lanes interleaved ones.
+void absorb(uint64_t* io_s, unsigned _lanes, unsigned _l, bytesConstRef _input, size_t _b)
+{
+	size_t offset = _b * c_rate;
+	byte const* p = _input.data() + offset;
+	byte tail[c_rate];
+	if (_input.size() - offset < c_rate)
+	{
+		size_t left = _input.size() - offset;
+		memset(tail, 0, c_rate);
+		if (left)
+			memcpy(tail, p, left);
+		tail[left] ^= 0x01;
+		tail[c_rate - 1] ^= 0x80;
+		p = tail;
+	}
+	for (unsigned k = 0; k < c_rate / 8; ++k)
+		io_s[k * _lanes + _l] ^= load64(p + k * 8);
+}
+
+/// Hashes the @a _n inputs _inputs[_order[0 ... _n)] in the lanes of one multi-buffer state.
+void sponge(Permutation _permute, unsigned _lanes, bytesConstRef const* _inputs, size_t const* _order, unsigned _n, h256* o_outputs)
+{
+	alignas(64) uint64_t s[25 * 8];
+	memset(s, 0, sizeof(uint64_t) * 25 * _lanes);
+	size_t blocks = 0;
+	for (unsigned l = 0; l < _n; ++l)
+		blocks = max(blocks, blockCount(_inputs[_order[l]]));
+
+	for (size_t b = 0; b < blocks; ++b)
+	{
+		for (unsigned l = 0; l < _n; ++l)
+			if (b < blockCount(_inputs[_order[l]]))
+				absorb(s, _lanes, l, _inputs[_order[l]], b);
+		_permute(s);
+		for (unsigned l = 0; l < _n; ++l)
+			if (b + 1 == blockCount(_inputs[_order[l]]))
+				for (unsigned k = 0; k < 4; ++k)
+					store64(o_outputs[_order[l]].data() + k * 8, s[k * _lanes + l]);
+	}
+}
+
+}
+
+char const* kernelName(Kernel _k)
+{
+	switch (_k)
+	{
+	case Kernel::Portable: return "portable";
+	case Kernel::BMI2: return "bmi2";
+	case Kernel::AVX2: return "avx2x4";
+	case Kernel::AVX512: return "avx512x8";
+	}
+	return "?";
+}
+
+std::vector<Kernel> supportedKernels()
+{
+	std::vector<Kernel> ret;
+	for (Kernel k: { Kernel::Portable, Kernel::BMI2, Kernel::AVX2, Kernel::AVX512 })
+		if (supported(k))
+			ret.push_back(k);
+	return ret;
+}
+
+Kernel currentKernel()
+{
+	current();
+	return (Kernel)s_kernel.load(memory_order_relaxed);
+}
+
+bool useKernel(Kernel _k)
+{
+	if (!supported(_k))
+		return false;
+	s_kernel.store((int)_k, memory_order_relaxed);
+	return true;
+}
+
+void hash256(bytesConstRef _input, byte* o_output)
+{
+	alignas(8) uint64_t s[25] = {};
+	Permutation permute = current().scalar;
+	size_t blocks = blockCount(_input);
+	for (size_t b = 0; b < blocks; ++b)
+	{
+		absorb(s, 1, 0, _input, b);
+		permute(s);
+	}
+	for (unsigned k = 0; k < 4; ++k)
+		store64(o_output + k * 8, s[k]);
+}
+
+void hash256Batch(bytesConstRef const* _inputs, size_t _count, h256* o_outputs)
+{
+	KernelInfo const& k = current();
+	if (k.lanes == 1 || _count < 2)
+	{
+		for (size_t i = 0; i < _count; ++i)
+			hash256(_inputs[i], o_outputs[i].data());
+		return;
+	}
+
+	// A group of lanes runs for as many blocks as its longest input, so group inputs of similar length.
+	std::vector<size_t> order(_count);
+	iota(order.begin(), order.end(), 0);
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return blockCount(_inputs[a]) < blockCount(_inputs[b]); });
+
+	for (size_t i = 0; i < _count; i += k.lanes)
+	{
+		unsigned n = (unsigned)min<size_t>(k.lanes, _count - i);
+		// Too few to be worth a full multi-buffer permutation.
+		if (n * 2 < k.lanes)
+			for (unsigned l = 0; l < n; ++l)
+				hash256(_inputs[order[i + l]], o_outputs[order[i + l]].data());
+		else
+			sponge(k.permute, k.lanes, _inputs, order.data() + i, n, o_outputs);
+	}
+}
+
+}
+}
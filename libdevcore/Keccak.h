@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include "Common.h"
+#include "FixedHash.h"
+
+namespace dev
+{
+namespace keccak
+{
+
+/// Implementations of the Keccak-f[1600] permutation; which of them can run is found out at runtime.
+enum class Kernel
+{
+	Portable,		///< Plain C++.
+	BMI2,			///< Scalar, built for BMI1/BMI2 (andn, rorx).
+	AVX2,			///< Four states at once.
+	AVX512			///< Eight states at once.
+};
+
+char const* kernelName(Kernel _k);
+/// @returns the kernels this CPU supports, slowest first.
+std::vector<Kernel> supportedKernels();
+/// @returns the kernel in use: the fastest supported one, unless changed with useKernel().
+Kernel currentKernel();
+/// Switches to @a _k, e.g. to benchmark the kernels against each other. @returns false if it is not supported.
+bool useKernel(Kernel _k);
+
+/// Keccak-256 of @a _input into the 32 bytes at @a o_output.
+void hash256(bytesConstRef _input, byte* o_output);
+/// Keccak-256 of each of the @a _count inputs. Multi-buffer kernels hash several inputs at once, so this
+/// is the way to hash many independent buffers.
+void hash256Batch(bytesConstRef const* _inputs, size_t _count, h256* o_outputs);
+
+}
+}
@@ -0,0 +1,143 @@
+#include "LDBDatabase.h"
+#include "Log.h"
+#include "ParallelFor.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+inline ldb::Slice toSlice(bytesConstRef _b) { return ldb::Slice((char const*)_b.data(), _b.size()); }
+
+class LDBWriteBatch: public WriteBatchFace
+{
+public:
+	void insert(bytesConstRef _key, bytesConstRef _value) override { m_batch.Put(toSlice(_key), toSlice(_value)); ++m_size; }
+	void kill(bytesConstRef _key) override { m_batch.Delete(toSlice(_key)); ++m_size; }
+	size_t size() const override { return m_size; }
+
+	ldb::WriteBatch& batch() { return m_batch; }
+
+private:
+	ldb::WriteBatch m_batch;
+	size_t m_size = 0;
+};
+
+class WriteBatchNoter: public ldb::WriteBatch::Handler
+{
+	virtual void Put(ldb::Slice const& _key, ldb::Slice const& _value) { cnote << "Put" << toHex(bytesConstRef(_key)) << "=>" << toHex(bytesConstRef(_value)); }
+	virtual void Delete(ldb::Slice const& _key) { cnote << "Delete" << toHex(bytesConstRef(_key)); }
+};
+
+void forEachIn(ldb::DB& _db, ldb::ReadOptions const& _o, std::function<bool(bytesConstRef, bytesConstRef)> const& _f)
+{
+	unique_ptr<ldb::Iterator> it(_db.NewIterator(_o));
+	for (it->SeekToFirst(); it->Valid(); it->Next())
+		if (!_f(bytesConstRef(it->key()), bytesConstRef(it->value())))
+			break;
+}
+
+class LDBSnapshot: public DatabaseSnapshotFace
+{
+public:
+	LDBSnapshot(ldb::DB* _db): m_db(_db), m_snapshot(_db->GetSnapshot()) { m_readOptions.snapshot = m_snapshot; }
+	~LDBSnapshot() { m_db->ReleaseSnapshot(m_snapshot); }
+
+	bool get(bytesConstRef _key, std::string& o_value) const override { return m_db->Get(m_readOptions, toSlice(_key), &o_value).ok(); }
+	void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const override { forEachIn(*m_db, m_readOptions, _f); }
+
+private:
+	ldb::DB* m_db;
+	ldb::Snapshot const* m_snapshot;
+	ldb::ReadOptions m_readOptions;
+};
+
+}
+
+ldb::Options LDBDatabase::defaultOptions()
+{
+	ldb::Options o;
+	o.max_open_files = 256;
+	o.create_if_missing = true;
+	return o;
+}
+
+LDBDatabase::LDBDatabase(std::string const& _path, ldb::Options const& _options)
+{
+	ldb::DB* db = nullptr;
+	ldb::Status status = ldb::DB::Open(_options, _path, &db);
+	if (!status.ok() || !db)
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot open " + _path + ": " + status.ToString()));
+	m_db.reset(db);
+}
+
+bool LDBDatabase::get(bytesConstRef _key, std::string& o_value) const
+{
+	return m_db->Get(m_readOptions, toSlice(_key), &o_value).ok();
+}
+
+void LDBDatabase::getMany(std::vector<bytesConstRef> const& _keys, std::vector<std::string>& o_values) const
+{
+#if ETH_ROCKSDB
+	std::vector<ldb::Slice> keys;
+	keys.reserve(_keys.size());
+	for (auto const& k: _keys)
+		keys.push_back(toSlice(k));
+	std::vector<ldb::Status> statuses = m_db->MultiGet(m_readOptions, keys, &o_values);
+	for (size_t i = 0; i < statuses.size(); ++i)
+		if (!statuses[i].ok())
+			o_values[i].clear();
+#else
+	o_values.assign(_keys.size(), std::string());
+	unsigned threads = (unsigned)min<size_t>(c_maxReadThreads, _keys.size() / c_minReadsPerThread);
+	parallelFor(_keys.size(), [&](size_t i) { m_db->Get(m_readOptions, toSlice(_keys[i]), &o_values[i]); }, max(threads, 1u));
+#endif
+}
+
+void LDBDatabase::put(bytesConstRef _key, bytesConstRef _value)
+{
+	ldb::Status s = m_db->Put(m_writeOptions, toSlice(_key), toSlice(_value));
+	if (!s.ok())
+		BOOST_THROW_EXCEPTION(DatabaseError(s.ToString()));
+}
+
+void LDBDatabase::kill(bytesConstRef _key)
+{
+	ldb::Status s = m_db->Delete(m_writeOptions, toSlice(_key));
+	if (!s.ok())
+		BOOST_THROW_EXCEPTION(DatabaseError(s.ToString()));
+}
+
+std::unique_ptr<WriteBatchFace> LDBDatabase::createWriteBatch() const
+{
+	return unique_ptr<WriteBatchFace>(new LDBWriteBatch);
+}
+
+void LDBDatabase::commit(WriteBatchFace& _batch)
+{
+	LDBWriteBatch* b = dynamic_cast<LDBWriteBatch*>(&_batch);
+	if (!b)
+		BOOST_THROW_EXCEPTION(DatabaseError("Foreign write batch"));
+	ldb::Status s = m_db->Write(m_writeOptions, &b->batch());
+	if (!s.ok())
+	{
+		WriteBatchNoter n;
+		b->batch().Iterate(&n);
+		BOOST_THROW_EXCEPTION(DatabaseError(s.ToString()));
+	}
+}
+
+void LDBDatabase::forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const
+{
+	forEachIn(*m_db, m_readOptions, _f);
+}
+
+std::unique_ptr<DatabaseSnapshotFace> LDBDatabase::snapshot() const
+{
+	return unique_ptr<DatabaseSnapshotFace>(new LDBSnapshot(m_db.get()));
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include "db.h"
+#include "DatabaseFace.h"
+
+namespace dev
+{
+
+/**
+ * @brief DatabaseFace over LevelDB, or RocksDB when built with ETH_ROCKSDB.
+ */
+class LDBDatabase: public DatabaseFace
+{
+public:
+	static const unsigned c_maxReadThreads = 8;
+	static const unsigned c_minReadsPerThread = 16;
+
+	static ldb::Options defaultOptions();
+
+	/// Opens, creating if missing, the database at @a _path.
+	explicit LDBDatabase(std::string const& _path, ldb::Options const& _options = defaultOptions());
+	/// Adopts an already open database.
+	explicit LDBDatabase(ldb::DB* _db): m_db(_db) {}
+
+	ldb::DB* db() const { return m_db.get(); }
+
+	bool get(bytesConstRef _key, std::string& o_value) const override;
+	/// MultiGet on RocksDB; LevelDB lacks it, so concurrent Gets on the TaskScheduler's threads let the
+	/// OS overlap the random reads.
+	void getMany(std::vector<bytesConstRef> const& _keys, std::vector<std::string>& o_values) const override;
+
+	void put(bytesConstRef _key, bytesConstRef _value) override;
+	void kill(bytesConstRef _key) override;
+
+	std::unique_ptr<WriteBatchFace> createWriteBatch() const override;
+	void commit(WriteBatchFace& _batch) override;
+
+	void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const override;
+	std::unique_ptr<DatabaseSnapshotFace> snapshot() const override;
+
+private:
+	std::unique_ptr<ldb::DB> m_db;
+	ldb::ReadOptions m_readOptions;
+	ldb::WriteOptions m_writeOptions;
+};
+
+}
@@ -1,5 +1,6 @@
 #include "Log.h"
 
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <thread>
@@ -19,9 +20,13 @@ mutex x_logOverride;
 /// If a channel has no entry, then it will output as long as its verbosity (LogChannel::verbosity) is less than
 /// or equal to the currently output verbosity (g_logVerbosity).
 static map<type_info const*, bool> s_logOverride;
+/// Size of s_logOverride, so that the common case of no overrides needs no lock.
+static atomic<size_t> s_logOverrides{0};
 
 bool dev::isChannelVisible(std::type_info const* _ch, bool _default)
 {
+	if (!s_logOverrides)
+		return _default;
 	Guard l(x_logOverride);
 	if (s_logOverride.count(_ch))
 		return s_logOverride[_ch];
@@ -34,6 +39,7 @@ LogOverrideAux::LogOverrideAux(std::type_info const* _ch, bool _value):
 	Guard l(x_logOverride);
 	m_old = s_logOverride.count(_ch) ? (int)s_logOverride[_ch] : c_null;
 	s_logOverride[m_ch] = _value;
+	s_logOverrides = s_logOverride.size();
 }
 
 LogOverrideAux::~LogOverrideAux()
@@ -43,6 +49,7 @@ LogOverrideAux::~LogOverrideAux()
 		s_logOverride.erase(m_ch);
 	else
 		s_logOverride[m_ch] = (bool)m_old;
+	s_logOverrides = s_logOverride.size();
 }
 
 #if defined(_WIN32)
@@ -80,25 +87,34 @@ std::string dev::logFileName(const char *file, int line, const char *fun, const
     return std::string(buf);
 }
 
+void dev::streamLogPrefix(ostream& _out, char const* _id, chrono::system_clock::time_point _time, string const& _thread, string const& _context)
+{
+	time_t rawTime = chrono::system_clock::to_time_t(_time);
+	unsigned ms = chrono::duration_cast<chrono::milliseconds>(_time.time_since_epoch()).count() % 1000;
+	// localtime() and strftime() cost more than the rest of a typical entry, so do them once a second.
+	static thread_local time_t s_lastTime = -1;
+	static thread_local char buf[24];
+	if (rawTime != s_lastTime)
+	{
+		s_lastTime = rawTime;
+		if (strftime(buf, 24, "%X", localtime(&rawTime)) == 0)
+			buf[0] = '\0'; // empty if case strftime fails
+	}
+	static char const* c_begin = "  " EthViolet;
+	static char const* c_sep1 = EthReset EthBlack "|" EthNavy;
+	static char const* c_end = EthReset "  ";
+	_out << _id << c_begin << buf << "." << setw(3) << setfill('0') << ms;
+	_out << c_sep1 << _thread << _context << c_end;
+}
+
 LogOutputStreamBase::LogOutputStreamBase(char const* _id, std::type_info const* _info, unsigned _v, bool _autospacing):
 	m_autospacing(_autospacing),
 	m_verbosity(_v)
 {
-	Guard l(x_logOverride);
-	auto it = s_logOverride.find(_info);
-	if ((it != s_logOverride.end() && it->second == true) || (it == s_logOverride.end() && (int)_v <= g_logVerbosity))
+	if (isChannelVisible(_info, (int)_v <= g_logVerbosity))
 	{
-		time_t rawTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-		unsigned ms = chrono::duration_cast<chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() % 1000;
-		char buf[24];
-		if (strftime(buf, 24, "%X", localtime(&rawTime)) == 0)
-			buf[0] = '\0'; // empty if case strftime fails
-		static char const* c_begin = "  " EthViolet;
-		static char const* c_sep1 = EthReset EthBlack "|" EthNavy;
 		static char const* c_sep2 = EthReset EthBlack "|" EthTeal;
-		static char const* c_end = EthReset "  ";
-		m_sstr << _id << c_begin << buf << "." << setw(3) << setfill('0') << ms;
-		m_sstr << c_sep1 << getThreadName() << ThreadContext::join(c_sep2) << c_end;
+		streamLogPrefix(m_sstr, _id, chrono::system_clock::now(), getThreadName(), ThreadContext::join(c_sep2));
 	}
 }
 
@@ -30,6 +30,9 @@ extern int g_logVerbosity;
 /// The current method that the logging system uses to output the log messages. Defaults to simpleDebugOut().
 extern std::function<void(std::string const&, char const*)> g_logPost;
 
+/// Hands a finished log entry on: to g_logPost, or to the background writer when async logging is on (see AsyncLog.h).
+void postLog(std::string&& _entry, char const* _channel);
+
 class LogOverrideAux
 {
 protected:
@@ -226,9 +229,20 @@ public:
 	}
 
 protected:
+	/// A stringbuf whose length and last character can be read without copying the entry out.
+	struct EntryBuf: std::stringbuf
+	{
+		bool empty() const { return pptr() == pbase(); }
+		char back() const { return pptr()[-1]; }
+	};
+
+	/// Whether autospacing should put a space before the next item.
+	bool needsSpace() const { return !m_buf.empty() && m_buf.back() != ' '; }
+
 	bool m_autospacing = false;
 	unsigned m_verbosity = 0;
-	std::stringstream m_sstr;	///< The accrued log entry.
+	EntryBuf m_buf;
+	std::ostream m_sstr{&m_buf};	///< The accrued log entry.
 	LogTag m_logTag = LogTag::None;
 };
 
@@ -242,14 +256,14 @@ public:
 	LogOutputStream(): LogOutputStreamBase(Id::name(), &typeid(Id), Id::verbosity, _AutoSpacing) {}
 
 	/// Destructor. Posts the accrued log entry to the g_logPost function.
-	~LogOutputStream() { if (Id::verbosity <= g_logVerbosity) g_logPost(m_sstr.str(), Id::name()); }
+	~LogOutputStream() { if (Id::verbosity <= g_logVerbosity) postLog(m_buf.str(), Id::name()); }
 
-	LogOutputStream& operator<<(std::string const& _t) { if (Id::verbosity <= g_logVerbosity) { if (_AutoSpacing && m_sstr.str().size() && m_sstr.str().back() != ' ') m_sstr << " "; comment(_t); } return *this; }
+	LogOutputStream& operator<<(std::string const& _t) { if (Id::verbosity <= g_logVerbosity) { if (_AutoSpacing && needsSpace()) m_sstr << " "; comment(_t); } return *this; }
 
 	LogOutputStream& operator<<(LogTag _t) { m_logTag = _t; return *this; }
 
 	/// Shift arbitrary data to the log. Spaces will be added between items as required.
-	template <class T> LogOutputStream& operator<<(T const& _t) { if (Id::verbosity <= g_logVerbosity) { if (_AutoSpacing && m_sstr.str().size() && m_sstr.str().back() != ' ') m_sstr << " "; append(_t); } return *this; }
+	template <class T> LogOutputStream& operator<<(T const& _t) { if (Id::verbosity <= g_logVerbosity) { if (_AutoSpacing && needsSpace()) m_sstr << " "; append(_t); } return *this; }
 };
 
 /// A "hacky" way to execute the next statement on COND.
@@ -261,28 +275,31 @@ public:
 /// for the logging macros to end with the stream object and not a closing brace '}'
 #define DEV_STATEMENT_SKIP() while (/*CONSTCOND*/ false) /*NOTREACHED*/
 // Kill all logs when when NLOG is defined.
+// Otherwise the channel is checked before the statement runs, so a hidden channel costs no formatting at all.
 #if NLOG
 #define clog(X) nlog(X)
 #define cslog(X) nslog(X)
 #else
 #if NDEBUG
-#define clog(X) DEV_STATEMENT_IF(!(X::debug)) dev::LogOutputStream<X, true>()
-#define cslog(X) DEV_STATEMENT_IF(!(X::debug)) dev::LogOutputStream<X, false>()
+#define DEV_LOG_VISIBLE(X) (!(X::debug) && dev::isChannelVisible<X>())
 #else
-#define clog(X) dev::LogOutputStream<X, true>()
-#define cslog(X) dev::LogOutputStream<X, false>()
+#define DEV_LOG_VISIBLE(X) dev::isChannelVisible<X>()
 #endif
+#define clog(X) DEV_STATEMENT_IF(DEV_LOG_VISIBLE(X)) dev::LogOutputStream<X, true>()
+#define cslog(X) DEV_STATEMENT_IF(DEV_LOG_VISIBLE(X)) dev::LogOutputStream<X, false>()
 #endif
 
 std::string logFileName(const char *file, int line, const char *fun, const char *t);
+/// Writes the start of a log entry (channel, time, thread and its context) to @a _out.
+void streamLogPrefix(std::ostream& _out, char const* _id, std::chrono::system_clock::time_point _time, std::string const& _thread, std::string const& _context);
 #define LOG_INFO logFileName((const char*)__FILE__, __LINE__, (const char*)__FUNCTION__, (const char*)__TIMESTAMP__)
 
 // Simple cout-like stream objects for accessing common log channels.
 // Dirties the global namespace, but oh so convenient...
-#define cdebug (clog(dev::DebugChannel)<<LOG_INFO)
-#define cnote (clog(dev::NoteChannel)<<LOG_INFO)
-#define cwarn (clog(dev::WarnChannel)<<LOG_INFO)
-#define ctrace (clog(dev::TraceChannel)<<LOG_INFO)
+#define cdebug clog(dev::DebugChannel)<<LOG_INFO
+#define cnote clog(dev::NoteChannel)<<LOG_INFO
+#define cwarn clog(dev::WarnChannel)<<LOG_INFO
+#define ctrace clog(dev::TraceChannel)<<LOG_INFO
 
 // Null stream-like objects.
 #define ndebug DEV_STATEMENT_SKIP() dev::NullOutputStream()
@@ -0,0 +1,276 @@
+#include "MMapDatabase.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DEV_HAVE_MMAP 1
+#endif
+#include <cstring>
+#include "CommonData.h"
+#include "Log.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+static char const c_magic[8] = {'X', 'C', 'M', 'M', 'D', 'B', '0', '1'};
+static const uint64_t c_headerSize = 64;
+static const uint64_t c_endOffset = 8;			///< Where the committed length lives in the header.
+static const uint32_t c_tombstone = 0xffffffff;
+static const uint64_t c_recordHeader = 8;		///< u32 key size, u32 value size (or c_tombstone).
+
+class MMapSnapshot: public DatabaseSnapshotFace
+{
+public:
+	MMapSnapshot(std::shared_ptr<MMapDatabase::Index const> const& _index): m_index(_index) {}
+
+	bool get(bytesConstRef _key, std::string& o_value) const override
+	{
+		auto it = m_index->find(_key);
+		if (it == m_index->end())
+			return false;
+		o_value = it->second.toString();
+		return true;
+	}
+	void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const override
+	{
+		for (auto const& i: *m_index)
+			if (!_f(i.first, i.second))
+				break;
+	}
+
+private:
+	std::shared_ptr<MMapDatabase::Index const> m_index;
+};
+
+}
+
+MMapDatabase::MMapDatabase(std::string const& _path, uint64_t _reserve, bool _sync):
+	m_path(_path),
+	m_reserve(_reserve),
+	m_sync(_sync),
+	m_index(make_shared<Index>())
+{
+#if DEV_HAVE_MMAP
+	m_fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (m_fd < 0)
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot open " + _path + ": " + strerror(errno)));
+	struct stat st;
+	if (fstat(m_fd, &st) != 0)
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot stat " + _path));
+	m_fileSize = st.st_size;
+	if (m_fileSize > m_reserve)
+		BOOST_THROW_EXCEPTION(DatabaseError(_path + " is larger than the reserved mapping"));
+
+	// Map the whole reserve up front so that nothing ever moves; only the part backed by the file is touched.
+	void* m = mmap(nullptr, m_reserve, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, m_fd, 0);
+	if (m == MAP_FAILED)
+	{
+		::close(m_fd);
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot map " + _path + ": " + strerror(errno)));
+	}
+	m_map = (byte*)m;
+
+	if (m_fileSize == 0)
+	{
+		ensureFileSize(c_headerSize);
+		memcpy(m_map, c_magic, sizeof(c_magic));
+		m_end = c_headerSize;
+		memcpy(m_map + c_endOffset, &m_end, sizeof(m_end));
+	}
+	else
+		load();
+#else
+	BOOST_THROW_EXCEPTION(DatabaseError("MMapDatabase is not supported on this platform"));
+#endif
+}
+
+MMapDatabase::~MMapDatabase()
+{
+#if DEV_HAVE_MMAP
+	if (m_map)
+	{
+		msync(m_map, m_end, MS_SYNC);
+		munmap(m_map, m_reserve);
+	}
+	if (m_fd >= 0)
+		::close(m_fd);
+#endif
+}
+
+void MMapDatabase::load()
+{
+	if (m_fileSize < c_headerSize || memcmp(m_map, c_magic, sizeof(c_magic)))
+		BOOST_THROW_EXCEPTION(DatabaseError(m_path + " is not a database file"));
+	memcpy(&m_end, m_map + c_endOffset, sizeof(m_end));
+	if (m_end < c_headerSize || m_end > m_fileSize)
+		BOOST_THROW_EXCEPTION(DatabaseError(m_path + " has a corrupt header"));
+
+	// Replay the log; later records win.
+	Index& index = *m_index;
+	for (uint64_t p = c_headerSize; p < m_end;)
+	{
+		uint32_t keySize;
+		uint32_t valueSize;
+		memcpy(&keySize, m_map + p, 4);
+		memcpy(&valueSize, m_map + p + 4, 4);
+		uint64_t size = c_recordHeader + keySize + (valueSize == c_tombstone ? 0 : valueSize);
+		if (p + size > m_end)
+			BOOST_THROW_EXCEPTION(DatabaseError(m_path + " has a corrupt record at offset " + toString(p)));
+		bytesConstRef key(m_map + p + c_recordHeader, keySize);
+		if (valueSize == c_tombstone)
+			index.erase(key);
+		else
+			index[key] = bytesConstRef(key.data() + keySize, valueSize);
+		p += size;
+	}
+	ctrace << "Loaded" << index.size() << "keys from" << m_path << "(" << m_end << "bytes of log)";
+}
+
+void MMapDatabase::ensureFileSize(uint64_t _size)
+{
+#if DEV_HAVE_MMAP
+	if (_size <= m_fileSize)
+		return;
+	if (_size > m_reserve)
+		BOOST_THROW_EXCEPTION(DatabaseError(m_path + " is full (reserve of " + toString(m_reserve) + " bytes)"));
+	uint64_t s = min(m_reserve, (_size + c_growStep - 1) / c_growStep * c_growStep);
+	if (ftruncate(m_fd, s) != 0)
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot grow " + m_path + ": " + strerror(errno)));
+	m_fileSize = s;
+#else
+	(void)_size;
+#endif
+}
+
+MMapDatabase::Index& MMapDatabase::writableIndex()
+{
+	if (m_index.use_count() > 1)
+		m_index = make_shared<Index>(*m_index);
+	return *m_index;
+}
+
+bool MMapDatabase::get(bytesConstRef _key, std::string& o_value) const
+{
+	bytesConstRef v;
+	if (!getRef(_key, v))
+		return false;
+	o_value = v.toString();
+	return true;
+}
+
+bool MMapDatabase::exists(bytesConstRef _key) const
+{
+	ReadGuard l(x_index);
+	return m_index->count(_key);
+}
+
+bool MMapDatabase::getRef(bytesConstRef _key, bytesConstRef& o_value) const
+{
+	ReadGuard l(x_index);
+	auto it = m_index->find(_key);
+	if (it == m_index->end())
+		return false;
+	o_value = it->second;
+	return true;
+}
+
+void MMapDatabase::put(bytesConstRef _key, bytesConstRef _value)
+{
+	BufferedWriteBatch b;
+	b.insert(_key, _value);
+	commit(b);
+}
+
+void MMapDatabase::kill(bytesConstRef _key)
+{
+	BufferedWriteBatch b;
+	b.kill(_key);
+	commit(b);
+}
+
+std::unique_ptr<WriteBatchFace> MMapDatabase::createWriteBatch() const
+{
+	return unique_ptr<WriteBatchFace>(new BufferedWriteBatch);
+}
+
+void MMapDatabase::commit(WriteBatchFace& _batch)
+{
+	BufferedWriteBatch* b = dynamic_cast<BufferedWriteBatch*>(&_batch);
+	if (!b)
+		BOOST_THROW_EXCEPTION(DatabaseError("Foreign write batch"));
+
+	// Readers never look past m_end, so appending only excludes other writers; the index lock is
+	// taken just to publish.
+	Guard w(x_write);
+	uint64_t size = 0;
+	for (auto const& o: b->ops())
+		size += c_recordHeader + o.key.size() + (o.kill ? 0 : o.value.size());
+	ensureFileSize(m_end + size);
+
+	uint64_t p = m_end;
+	std::vector<std::pair<bytesConstRef, bytesConstRef>> written;
+	written.reserve(b->ops().size());
+	for (auto const& o: b->ops())
+	{
+		uint32_t keySize = (uint32_t)o.key.size();
+		uint32_t valueSize = o.kill ? c_tombstone : (uint32_t)o.value.size();
+		memcpy(m_map + p, &keySize, 4);
+		memcpy(m_map + p + 4, &valueSize, 4);
+		memcpy(m_map + p + c_recordHeader, o.key.data(), keySize);
+		bytesConstRef key(m_map + p + c_recordHeader, keySize);
+		p += c_recordHeader + keySize;
+		if (o.kill)
+			written.push_back(make_pair(key, bytesConstRef()));
+		else
+		{
+			memcpy(m_map + p, o.value.data(), o.value.size());
+			written.push_back(make_pair(key, bytesConstRef(m_map + p, o.value.size())));
+			p += o.value.size();
+		}
+	}
+
+#if DEV_HAVE_MMAP
+	// The kernel writes dirty pages back in any order; the records must not trail the header past them.
+	if (msync(m_map + (m_end & ~uint64_t(4095)), p - (m_end & ~uint64_t(4095)), MS_SYNC) != 0)
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot sync " + m_path + ": " + strerror(errno)));
+#endif
+	// Publish: only now does the new data become part of the database.
+	WriteGuard l(x_index);
+	m_end = p;
+	memcpy(m_map + c_endOffset, &m_end, sizeof(m_end));
+#if DEV_HAVE_MMAP
+	if (m_sync)
+		msync(m_map, c_headerSize, MS_SYNC);
+#endif
+
+	Index& index = writableIndex();
+	for (auto const& i: written)
+		if (i.second.data())
+			index[i.first] = i.second;
+		else
+			index.erase(i.first);
+}
+
+void MMapDatabase::forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const
+{
+	shared_ptr<Index const> index;
+	DEV_READ_GUARDED(x_index)
+		index = m_index;
+	for (auto const& i: *index)
+		if (!_f(i.first, i.second))
+			break;
+}
+
+std::unique_ptr<DatabaseSnapshotFace> MMapDatabase::snapshot() const
+{
+	ReadGuard l(x_index);
+	return unique_ptr<DatabaseSnapshotFace>(new MMapSnapshot(m_index));
+}
+
+}
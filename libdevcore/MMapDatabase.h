@@ -0,0 +1,86 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include "Guards.h"
+#include "DatabaseFace.h"
+
+namespace dev
+{
+
+/**
+ * @brief Single-file, memory-mapped DatabaseFace with zero-copy reads.
+ *
+ * Records are appended to a log that is mapped once into a large reserved address range, so a record never
+ * moves and getRef() can hand out views straight into the map that stay valid until the database is closed.
+ * The file header holds the committed length: a commit appends its records, msyncs them, and only then
+ * publishes them by bumping that length, so the header never gets to disk ahead of the records it covers
+ * and a torn write is simply ignored on the next open. Lookups go through an ordered in-memory
+ * index of the live keys, rebuilt by scanning the log on open; the index is copy-on-write with respect to
+ * snapshots and iterations.
+ *
+ * Overwritten and deleted records are not reclaimed: this suits write-once data such as blocks, receipts
+ * and trie nodes rather than hot mutable keys.
+ */
+class MMapDatabase: public DatabaseFace
+{
+public:
+	/// Address space reserved for the mapping, i.e. the maximum database size.
+	static const uint64_t c_defaultReserve = uint64_t(1) << 36;
+	/// The file grows in steps of this much.
+	static const uint64_t c_growStep = 64 * 1024 * 1024;
+
+	/// Opens, creating if missing, the database file at @a _path. Records always reach the disk before the
+	/// header that covers them; with @a _sync, the header is msync'd too, so a commit is durable on return.
+	explicit MMapDatabase(std::string const& _path, uint64_t _reserve = c_defaultReserve, bool _sync = false);
+	~MMapDatabase();
+
+	bool get(bytesConstRef _key, std::string& o_value) const override;
+	bool exists(bytesConstRef _key) const override;
+	bool zeroCopy() const override { return true; }
+	bool getRef(bytesConstRef _key, bytesConstRef& o_value) const override;
+
+	void put(bytesConstRef _key, bytesConstRef _value) override;
+	void kill(bytesConstRef _key) override;
+
+	std::unique_ptr<WriteBatchFace> createWriteBatch() const override;
+	void commit(WriteBatchFace& _batch) override;
+
+	void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const override;
+	std::unique_ptr<DatabaseSnapshotFace> snapshot() const override;
+
+	/// @returns bytes of log in use, live or dead.
+	uint64_t logSize() const { ReadGuard l(x_index); return m_end; }
+	size_t size() const { ReadGuard l(x_index); return m_index->size(); }
+
+	struct RefLess
+	{
+		bool operator()(bytesConstRef _a, bytesConstRef _b) const
+		{
+			int c = memcmp(_a.data(), _b.data(), std::min(_a.size(), _b.size()));
+			return c < 0 || (c == 0 && _a.size() < _b.size());
+		}
+	};
+	/// Key and value both point into the map.
+	using Index = std::map<bytesConstRef, bytesConstRef, RefLess>;
+
+private:
+	void load();
+	void ensureFileSize(uint64_t _size);
+	/// Must be called under the write lock.
+	Index& writableIndex();
+
+	std::string m_path;
+	int m_fd = -1;
+	byte* m_map = nullptr;
+	uint64_t m_reserve;
+	uint64_t m_fileSize = 0;
+	uint64_t m_end = 0;			///< Committed end of the log.
+	bool m_sync;
+
+	Mutex x_write;					///< Serialises commits.
+	mutable SharedMutex x_index;	///< Guards m_index and m_end.
+	std::shared_ptr<Index> m_index;
+};
+
+}
@@ -0,0 +1,62 @@
+#include "MemoryAccounting.h"
+#include <ostream>
+
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+struct alignas(64) TagCounters
+{
+	atomic<int64_t> live{0};
+	atomic<int64_t> peak{0};
+	atomic<uint64_t> charges{0};
+};
+
+TagCounters s_counters[(unsigned)MemoryTag::Count];
+
+char const* const c_tagNames[] = { "other", "txqueue", "blockqueue", "trie", "p2p", "consensus" };
+static_assert(sizeof(c_tagNames) / sizeof(*c_tagNames) == (unsigned)MemoryTag::Count, "every tag needs a name");
+
+}
+
+char const* memoryTagName(MemoryTag _tag)
+{
+	return _tag < MemoryTag::Count ? c_tagNames[(unsigned)_tag] : "unknown";
+}
+
+void chargeMemory(MemoryTag _tag, size_t _bytes)
+{
+	TagCounters& c = s_counters[(unsigned)_tag];
+	int64_t live = c.live.fetch_add((int64_t)_bytes, memory_order_relaxed) + (int64_t)_bytes;
+	c.charges.fetch_add(1, memory_order_relaxed);
+	int64_t peak = c.peak.load(memory_order_relaxed);
+	while (live > peak && !c.peak.compare_exchange_weak(peak, live, memory_order_relaxed)) {}
+}
+
+void releaseMemory(MemoryTag _tag, size_t _bytes)
+{
+	s_counters[(unsigned)_tag].live.fetch_sub((int64_t)_bytes, memory_order_relaxed);
+}
+
+vector<MemoryUsage> memoryUsage()
+{
+	vector<MemoryUsage> ret;
+	for (unsigned i = 0; i < (unsigned)MemoryTag::Count; ++i)
+	{
+		TagCounters const& c = s_counters[i];
+		ret.push_back(MemoryUsage{(MemoryTag)i, c.live.load(memory_order_relaxed), c.peak.load(memory_order_relaxed), c.charges.load(memory_order_relaxed)});
+	}
+	return ret;
+}
+
+ostream& operator<<(ostream& _out, MemoryUsage const& _u)
+{
+	return _out << memoryTagName(_u.tag) << ": " << _u.liveBytes << " bytes live, " << _u.peakBytes << " peak, " << _u.charges << " charges";
+}
+
+}
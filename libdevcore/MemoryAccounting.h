@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <new>
+#include <vector>
+#include "Common.h"
+
+namespace dev
+{
+
+/**
+ * Memory accounting by subsystem.
+ *
+ * Containers that hold a subsystem's data charge what they allocate to its tag and release it when they
+ * free it, either through a TaggedAllocator or by calling chargeMemory()/releaseMemory() where they
+ * already track their size. Each tag keeps its live bytes, their high-water mark and the number of
+ * charges, readable at any time with memoryUsage() without stopping anything; Client logs them once a
+ * minute. The counters are relaxed atomics on cache lines of their own, so charging costs about what
+ * one uncontended atomic add does.
+ */
+enum class MemoryTag: unsigned
+{
+	Other,
+	TxQueue,		///< Transactions waiting for verification.
+	BlockQueue,		///< Blocks waiting for verification and import.
+	Trie,			///< Trie nodes and the scratch of trie commits.
+	P2P,			///< Network read and write buffers.
+	Consensus,		///< PBFT messages waiting to be handled.
+	Count
+};
+
+/// @returns the name the tag is reported under, e.g. "txqueue".
+char const* memoryTagName(MemoryTag _tag);
+
+void chargeMemory(MemoryTag _tag, size_t _bytes);
+void releaseMemory(MemoryTag _tag, size_t _bytes);
+
+struct MemoryUsage
+{
+	MemoryTag tag;
+	int64_t liveBytes;		///< May be briefly negative when a release is seen before its charge.
+	int64_t peakBytes;
+	uint64_t charges;
+};
+
+/// @returns a snapshot of the counters of every tag, in the order of MemoryTag.
+std::vector<MemoryUsage> memoryUsage();
+std::ostream& operator<<(std::ostream& _out, MemoryUsage const& _u);
+
+/**
+ * @brief std::allocator that charges what it hands out to @a Tag.
+ *
+ * Stateless, so containers using it are as big as with std::allocator and all instances are equal.
+ */
+template <class T, MemoryTag Tag>
+class TaggedAllocator
+{
+public:
+	using value_type = T;
+	template <class U> struct rebind { using other = TaggedAllocator<U, Tag>; };
+
+	TaggedAllocator() = default;
+	template <class U> TaggedAllocator(TaggedAllocator<U, Tag> const&) {}
+
+	T* allocate(size_t _n)
+	{
+		if (_n > std::numeric_limits<size_t>::max() / sizeof(T))
+			throw std::bad_alloc();
+		T* ret = static_cast<T*>(::operator new(_n * sizeof(T)));
+		chargeMemory(Tag, _n * sizeof(T));
+		return ret;
+	}
+	void deallocate(T* _p, size_t _n)
+	{
+		releaseMemory(Tag, _n * sizeof(T));
+		::operator delete(_p);
+	}
+
+	template <class U> bool operator==(TaggedAllocator<U, Tag> const&) const { return true; }
+	template <class U> bool operator!=(TaggedAllocator<U, Tag> const&) const { return false; }
+};
+
+/// A byte vector whose buffer is charged to @a Tag.
+template <MemoryTag Tag> using TaggedBytes = std::vector<byte, TaggedAllocator<byte, Tag>>;
+
+}
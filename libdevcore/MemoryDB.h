@@ -7,6 +7,7 @@
 #include "Log.h"
 #include "RLP.h"
 #include "SHA3.h"
+#include "NodeRef.h"
 
 namespace dev
 {
@@ -31,6 +32,9 @@ public:
 	std::unordered_map<h256, std::string> get() const;
 
         std::string lookup(h256 const& _h) const;
+	/// lookup() without the copy. The view is borrowed: it is valid until @a _h is next inserted or the
+	/// nodes are purged or cleared.
+	NodeRef lookupRef(h256 const& _h) const;
 	bool exists(h256 const& _h) const;
 	void insert(h256 const& _h, bytesConstRef _v);
 	bool kill(h256 const& _h);
@@ -42,7 +46,37 @@ public:
 
 	h256Hash keys() const;
 
+	/// Calls @a _f(h256 const&, bytesConstRef) for every node with a positive reference count.
+	template <class F> void forEach(F const& _f) const
+	{
+#if DEV_GUARDED_DB
+		ReadGuard l(x_this);
+#endif
+		for (auto const& i: m_main)
+			if (i.second.second)
+				_f(i.first, bytesConstRef(&i.second.first));
+	}
+	/// Calls @a _f(h256 const&, bytesConstRef) for every live aux entry.
+	template <class F> void forEachAux(F const& _f) const
+	{
+#if DEV_GUARDED_DB
+		ReadGuard l(x_this);
+#endif
+		for (auto const& i: m_aux)
+			if (i.second.second)
+				_f(i.first, bytesConstRef(&i.second.first));
+	}
+
 protected:
+	/// Drops all nodes but keeps the aux entries.
+	void clearNodes()
+	{
+#if DEV_GUARDED_DB
+		WriteGuard l(x_this);
+#endif
+		m_main.clear();
+	}
+
 #if DEV_GUARDED_DB
 	mutable SharedMutex x_this;
 #endif
@@ -54,11 +88,12 @@ protected:
 class EnforceRefs
 {
 public:
-	EnforceRefs(MemoryDB const& _o, bool _r): m_o(_o), m_r(_o.m_enforceRefs) { _o.m_enforceRefs = _r; }
-	~EnforceRefs() { m_o.m_enforceRefs = m_r; }
+	/// Works with any node store that befriends us (MemoryDB, ShardedMemoryDB).
+	template <class DB> EnforceRefs(DB const& _o, bool _r): m_flag(_o.m_enforceRefs), m_r(_o.m_enforceRefs) { m_flag = _r; }
+	~EnforceRefs() { m_flag = m_r; }
 
 private:
-	MemoryDB const& m_o;
+	bool& m_flag;
 	bool m_r;
 };
 
@@ -0,0 +1,104 @@
+#include "MemoryDatabase.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+using Map = std::map<std::string, std::string>;
+
+void forEachIn(Map const& _m, std::function<bool(bytesConstRef, bytesConstRef)> const& _f)
+{
+	for (auto const& i: _m)
+		if (!_f(bytesConstRef(&i.first), bytesConstRef(&i.second)))
+			break;
+}
+
+class MemorySnapshot: public DatabaseSnapshotFace
+{
+public:
+	MemorySnapshot(std::shared_ptr<Map const> const& _data): m_data(_data) {}
+
+	bool get(bytesConstRef _key, std::string& o_value) const override
+	{
+		auto it = m_data->find(_key.toString());
+		if (it == m_data->end())
+			return false;
+		o_value = it->second;
+		return true;
+	}
+	void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const override { forEachIn(*m_data, _f); }
+
+private:
+	std::shared_ptr<Map const> m_data;
+};
+
+}
+
+MemoryDatabase::Map& MemoryDatabase::writable()
+{
+	// Someone (a snapshot or an iteration) still looks at the current map; leave it to them.
+	if (m_data.use_count() > 1)
+		m_data = make_shared<Map>(*m_data);
+	return *m_data;
+}
+
+bool MemoryDatabase::get(bytesConstRef _key, std::string& o_value) const
+{
+	ReadGuard l(x_data);
+	auto it = m_data->find(_key.toString());
+	if (it == m_data->end())
+		return false;
+	o_value = it->second;
+	return true;
+}
+
+void MemoryDatabase::put(bytesConstRef _key, bytesConstRef _value)
+{
+	WriteGuard l(x_data);
+	writable()[_key.toString()] = _value.toString();
+}
+
+void MemoryDatabase::kill(bytesConstRef _key)
+{
+	WriteGuard l(x_data);
+	writable().erase(_key.toString());
+}
+
+std::unique_ptr<WriteBatchFace> MemoryDatabase::createWriteBatch() const
+{
+	return unique_ptr<WriteBatchFace>(new BufferedWriteBatch);
+}
+
+void MemoryDatabase::commit(WriteBatchFace& _batch)
+{
+	BufferedWriteBatch* b = dynamic_cast<BufferedWriteBatch*>(&_batch);
+	if (!b)
+		BOOST_THROW_EXCEPTION(DatabaseError("Foreign write batch"));
+	WriteGuard l(x_data);
+	Map& m = writable();
+	for (auto const& o: b->ops())
+		if (o.kill)
+			m.erase(o.key);
+		else
+			m[o.key] = o.value;
+}
+
+void MemoryDatabase::forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const
+{
+	shared_ptr<Map const> data;
+	DEV_READ_GUARDED(x_data)
+		data = m_data;
+	forEachIn(*data, _f);
+}
+
+std::unique_ptr<DatabaseSnapshotFace> MemoryDatabase::snapshot() const
+{
+	ReadGuard l(x_data);
+	return unique_ptr<DatabaseSnapshotFace>(new MemorySnapshot(m_data));
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include "Guards.h"
+#include "DatabaseFace.h"
+
+namespace dev
+{
+
+/**
+ * @brief Volatile, ordered DatabaseFace; for benchmarks and tests.
+ *
+ * The map is shared copy-on-write with snapshots, so taking one is cheap until the next write.
+ */
+class MemoryDatabase: public DatabaseFace
+{
+public:
+	MemoryDatabase(): m_data(std::make_shared<Map>()) {}
+
+	bool get(bytesConstRef _key, std::string& o_value) const override;
+	void put(bytesConstRef _key, bytesConstRef _value) override;
+	void kill(bytesConstRef _key) override;
+
+	std::unique_ptr<WriteBatchFace> createWriteBatch() const override;
+	void commit(WriteBatchFace& _batch) override;
+
+	void forEach(std::function<bool(bytesConstRef, bytesConstRef)> const& _f) const override;
+	std::unique_ptr<DatabaseSnapshotFace> snapshot() const override;
+
+	size_t size() const { ReadGuard l(x_data); return m_data->size(); }
+
+private:
+	using Map = std::map<std::string, std::string>;
+
+	/// Must be called under a write lock.
+	Map& writable();
+
+	mutable SharedMutex x_data;
+	std::shared_ptr<Map> m_data;
+};
+
+}
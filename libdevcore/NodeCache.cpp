@@ -0,0 +1,209 @@
+#include "NodeCache.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+std::ostream& operator<<(std::ostream& _out, NodeCacheStats const& _s)
+{
+	uint64_t lookups = _s.hits + _s.misses;
+	_out << _s.entries << " nodes, " << (_s.bytes / 1024) << "/" << (_s.budget / 1024) << " KB, "
+		<< _s.hits << " hits, " << _s.misses << " misses";
+	if (lookups)
+		_out << " (" << (_s.hits * 100 / lookups) << "% hit)";
+	_out << ", " << _s.insertions << " insertions, " << _s.evictions << " evictions";
+	return _out;
+}
+
+NodeCache::NodeCache(size_t _budget): m_shardBudget(_budget / c_shards)
+{
+	for (unsigned i = 0; i < c_shards; ++i)
+		m_shards.emplace_back(new Shard);
+}
+
+bool NodeCache::lookup(h256 const& _h, std::string& o_value)
+{
+	Shard& s = shardFor(_h);
+	{
+		Guard l(s.x_shard);
+		auto it = s.index.find(_h);
+		if (it != s.index.end())
+		{
+			s.lru.splice(s.lru.begin(), s.lru, it->second);
+			o_value = *it->second->second;
+			++m_hits;
+			return true;
+		}
+	}
+	++m_misses;
+	return false;
+}
+
+bool NodeCache::lookupRef(h256 const& _h, NodeRef& o_value)
+{
+	Shard& s = shardFor(_h);
+	{
+		Guard l(s.x_shard);
+		auto it = s.index.find(_h);
+		if (it != s.index.end())
+		{
+			s.lru.splice(s.lru.begin(), s.lru, it->second);
+			Value const& v = it->second->second;
+			o_value = NodeRef(bytesConstRef(v.get()), v);
+			++m_hits;
+			return true;
+		}
+	}
+	++m_misses;
+	return false;
+}
+
+bool NodeCache::contains(h256 const& _h) const
+{
+	Shard& s = shardFor(_h);
+	Guard l(s.x_shard);
+	return s.index.count(_h);
+}
+
+void NodeCache::insert(h256 const& _h, bytesConstRef _v)
+{
+	insertWith(_h, [&]() { return make_shared<string const>(_v.toString()); });
+}
+
+void NodeCache::insert(h256 const& _h, Value const& _v)
+{
+	insertWith(_h, [&]() { return _v; });
+}
+
+template <class F> void NodeCache::insertWith(h256 const& _h, F const& _make)
+{
+	if (!m_shardBudget)
+		return;
+	Shard& s = shardFor(_h);
+	Guard l(s.x_shard);
+	auto it = s.index.find(_h);
+	if (it != s.index.end())
+	{
+		// Same hash, same content: just refresh it.
+		s.lru.splice(s.lru.begin(), s.lru, it->second);
+		return;
+	}
+	s.lru.emplace_front(_h, _make());
+	s.index[_h] = s.lru.begin();
+	s.bytes += entrySize(s.lru.front().second->size());
+	++m_insertions;
+	evict(s);
+}
+
+void NodeCache::evict(Shard& _s)
+{
+	size_t budget = m_shardBudget;
+	// Always keep the most recent entry, even if it alone is over budget.
+	while (_s.bytes > budget && _s.lru.size() > 1)
+	{
+		Entry const& e = _s.lru.back();
+		_s.bytes -= entrySize(e.second->size());
+		_s.index.erase(e.first);
+		_s.lru.pop_back();
+		++m_evictions;
+	}
+}
+
+void NodeCache::erase(h256 const& _h)
+{
+	Shard& s = shardFor(_h);
+	Guard l(s.x_shard);
+	auto it = s.index.find(_h);
+	if (it != s.index.end())
+	{
+		s.bytes -= entrySize(it->second->second->size());
+		s.lru.erase(it->second);
+		s.index.erase(it);
+	}
+}
+
+void NodeCache::clear()
+{
+	for (auto const& s: m_shards)
+	{
+		Guard l(s->x_shard);
+		s->lru.clear();
+		s->index.clear();
+		s->bytes = 0;
+	}
+}
+
+void NodeCache::setBudget(size_t _budget)
+{
+	m_shardBudget = _budget / c_shards;
+	for (auto const& s: m_shards)
+	{
+		Guard l(s->x_shard);
+		if (m_shardBudget)
+			evict(*s);
+		else
+		{
+			s->lru.clear();
+			s->index.clear();
+			s->bytes = 0;
+		}
+	}
+}
+
+NodeCacheStats NodeCache::stats() const
+{
+	NodeCacheStats ret;
+	ret.hits = m_hits;
+	ret.misses = m_misses;
+	ret.insertions = m_insertions;
+	ret.evictions = m_evictions;
+	ret.budget = m_shardBudget * c_shards;
+	for (auto const& s: m_shards)
+	{
+		Guard l(s->x_shard);
+		ret.entries += s->index.size();
+		ret.bytes += s->bytes;
+	}
+	return ret;
+}
+
+NodeExistenceFilter::NodeExistenceFilter(size_t _bits)
+{
+	size_t words = 1;
+	while (words * 64 < _bits)
+		words *= 2;
+	m_words = vector<atomic<uint64_t>>(words);
+	for (auto& w: m_words)
+		w = 0;
+	m_mask = words * 64 - 1;
+}
+
+void NodeExistenceFilter::insert(h256 const& _h)
+{
+	for (unsigned i = 0; i < c_probes; ++i)
+	{
+		uint32_t p;
+		memcpy(&p, _h.data() + 16 + i * 4, 4);
+		size_t bit = p & m_mask;
+		m_words[bit / 64].fetch_or(uint64_t(1) << (bit % 64), memory_order_relaxed);
+	}
+	++m_count;
+}
+
+bool NodeExistenceFilter::mayContain(h256 const& _h) const
+{
+	if (!m_authoritative)
+		return true;
+	for (unsigned i = 0; i < c_probes; ++i)
+	{
+		uint32_t p;
+		memcpy(&p, _h.data() + 16 + i * 4, 4);
+		size_t bit = p & m_mask;
+		if (!(m_words[bit / 64].load(memory_order_relaxed) & (uint64_t(1) << (bit % 64))))
+			return false;
+	}
+	return true;
+}
+
+}
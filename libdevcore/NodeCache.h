@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Common.h"
+#include "Guards.h"
+#include "FixedHash.h"
+#include "NodeRef.h"
+
+namespace dev
+{
+
+struct NodeCacheStats
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t insertions = 0;
+	uint64_t evictions = 0;
+	size_t entries = 0;
+	size_t bytes = 0;
+	size_t budget = 0;
+};
+
+std::ostream& operator<<(std::ostream& _out, NodeCacheStats const& _s);
+
+/**
+ * @brief Bounded, sharded LRU cache of trie nodes keyed by their hash.
+ *
+ * Sits between OverlayDB and the disk database so that hot nodes survive a commit(). The byte budget
+ * is split evenly over the shards; each shard evicts its least recently used nodes once over budget.
+ * Nodes are content-addressed, so there is no invalidation beyond erase() for deleted nodes.
+ */
+class NodeCache
+{
+public:
+	static const unsigned c_shards = 16;
+
+	explicit NodeCache(size_t _budget);
+
+	/// @returns true and sets @a o_value if @a _h is cached. Counts a hit or a miss.
+	bool lookup(h256 const& _h, std::string& o_value);
+	/// lookup() without the copy; @a o_value pins the entry, so it outlives an eviction.
+	bool lookupRef(h256 const& _h, NodeRef& o_value);
+	/// @returns true if @a _h is cached, without touching the LRU order or the counters.
+	bool contains(h256 const& _h) const;
+	void insert(h256 const& _h, bytesConstRef _v);
+	/// Shares @a _v rather than copying it.
+	void insert(h256 const& _h, std::shared_ptr<std::string const> const& _v);
+	void erase(h256 const& _h);
+	void clear();
+
+	void setBudget(size_t _budget);
+	NodeCacheStats stats() const;
+
+private:
+	using Value = std::shared_ptr<std::string const>;
+	using Entry = std::pair<h256, Value>;
+
+	struct Shard
+	{
+		mutable Mutex x_shard;
+		std::list<Entry> lru;										///< Most recently used at the front.
+		std::unordered_map<h256, std::list<Entry>::iterator> index;
+		size_t bytes = 0;
+	};
+
+	Shard& shardFor(h256 const& _h) const { return *m_shards[_h[0] % c_shards]; }
+	void evict(Shard& _s);
+	/// Inserts the value made by @a _make() unless @a _h is already cached.
+	template <class F> void insertWith(h256 const& _h, F const& _make);
+
+	/// Rough heap cost of an entry, so that the budget tracks real memory rather than payload bytes.
+	static size_t entrySize(size_t _payload) { return _payload + sizeof(Entry) + sizeof(std::string) + 96; }
+
+	std::vector<std::unique_ptr<Shard>> m_shards;
+	std::atomic<size_t> m_shardBudget;
+
+	std::atomic<uint64_t> m_hits{0};
+	std::atomic<uint64_t> m_misses{0};
+	std::atomic<uint64_t> m_insertions{0};
+	std::atomic<uint64_t> m_evictions{0};
+};
+
+/**
+ * @brief Bloom filter over the node hashes present in the disk database.
+ *
+ * A negative answer is only trustworthy once the filter has seen every key in the database, i.e.
+ * after prime() or when it was created over an empty database. Keys are never removed, so deleting
+ * nodes merely costs false positives. Keys are already hashes, so the probe positions are taken
+ * straight from the key bytes.
+ */
+class NodeExistenceFilter
+{
+public:
+	static const unsigned c_probes = 4;
+
+	explicit NodeExistenceFilter(size_t _bits);
+
+	void insert(h256 const& _h);
+	/// @returns false only if @a _h is certainly absent (requires authoritative()).
+	bool mayContain(h256 const& _h) const;
+
+	bool authoritative() const { return m_authoritative; }
+	void setAuthoritative() { m_authoritative = true; }
+
+	size_t count() const { return m_count; }
+	size_t bits() const { return m_words.size() * 64; }
+
+private:
+	std::vector<std::atomic<uint64_t>> m_words;
+	size_t m_mask;
+	std::atomic<size_t> m_count{0};
+	std::atomic<bool> m_authoritative{false};
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include "Common.h"
+
+namespace dev
+{
+
+/**
+ * @brief Read-only view of a trie node's RLP that keeps the memory it points into alive.
+ *
+ * The pin is whatever owns the bytes: a ShardedMemoryDB arena, a node cache entry, an in-flight commit
+ * batch or the storage engine itself. Copying a NodeRef costs a reference count, never an allocation.
+ * A null pin means the view is borrowed from its source, which then documents how long it stays valid.
+ */
+class NodeRef
+{
+public:
+	NodeRef() {}
+	NodeRef(bytesConstRef _data, std::shared_ptr<void const> _pin): m_data(_data), m_pin(std::move(_pin)) {}
+	/// Borrowed view.
+	explicit NodeRef(bytesConstRef _data): m_data(_data) {}
+	/// Takes ownership of @a _s; for data that had to be materialised anyway.
+	explicit NodeRef(std::string&& _s)
+	{
+		auto s = std::make_shared<std::string const>(std::move(_s));
+		m_data = bytesConstRef(s.get());
+		m_pin = std::move(s);
+	}
+
+	bytesConstRef data() const { return m_data; }
+	size_t size() const { return m_data.size(); }
+	bool empty() const { return m_data.empty(); }
+	bool pinned() const { return !!m_pin; }
+
+	/// @returns a view of @a _part, which must lie within this node, sharing this node's pin.
+	NodeRef sub(bytesConstRef _part) const { return NodeRef(_part, m_pin); }
+
+	std::string toString() const { return m_data.toString(); }
+
+	/// @returns this if pinned, otherwise a copy that owns its bytes; for holders, such as trie
+	/// iterators, that may outlive how long the source keeps a borrowed view valid.
+	NodeRef owned() const { return pinned() || empty() ? *this : NodeRef(toString()); }
+
+	/// Compares contents.
+	bool operator==(NodeRef const& _c) const { return size() == _c.size() && (empty() || !memcmp(m_data.data(), _c.m_data.data(), size())); }
+	bool operator!=(NodeRef const& _c) const { return !operator==(_c); }
+
+private:
+	bytesConstRef m_data;
+	std::shared_ptr<void const> m_pin;
+};
+
+}
@@ -4,6 +4,7 @@
 #include <libdevcore/db.h>
 #include <libdevcore/Common.h>
 #include "OverlayDB.h"
+#include "TaskScheduler.h"
 using namespace std;
 using namespace dev;
 
@@ -12,6 +13,32 @@ namespace dev
 
 h256 const EmptyTrie = sha3(rlp(""));
 
+OverlayDB::OverlayDB(ldb::DB* _db, size_t _cacheBytes): m_db(_db ? make_shared<LDBDatabase>(_db) : nullptr)
+{
+	init(_cacheBytes);
+}
+
+OverlayDB::OverlayDB(std::unique_ptr<DatabaseFace> _db, size_t _cacheBytes): m_db(move(_db))
+{
+	init(_cacheBytes);
+}
+
+void OverlayDB::init(size_t _cacheBytes)
+{
+	if (!m_db)
+		return;
+	if (_cacheBytes)
+		m_cache = make_shared<NodeCache>(_cacheBytes);
+	m_filter = make_shared<NodeExistenceFilter>(c_existenceFilterBits);
+	m_flusher = make_shared<DBFlusher>(m_db);
+
+	// Nothing on disk yet means every node will pass through commit(), so the filter is complete from the outset.
+	bool empty = true;
+	m_db->forEach([&](bytesConstRef, bytesConstRef) { empty = false; return false; });
+	if (empty)
+		m_filter->setAuthoritative();
+}
+
 OverlayDB::~OverlayDB()
 {
 	if (m_db.use_count() == 1 && m_db.get())
@@ -19,72 +46,243 @@ OverlayDB::~OverlayDB()
 }
 
 
-class WriteBatchNoter: public ldb::WriteBatch::Handler
+/// Writes @a _batch, retrying with back-off; gives up on the process after ten failures.
+static void writeBatchOrDie(DatabaseFace& _db, WriteBatchFace& _batch)
 {
-	virtual void Put(ldb::Slice const& _key, ldb::Slice const& _value) { cnote << "Put" << toHex(bytesConstRef(_key)) << "=>" << toHex(bytesConstRef(_value)); }
-	virtual void Delete(ldb::Slice const& _key) { cnote << "Delete" << toHex(bytesConstRef(_key)); }
-};
-
-void OverlayDB::commit()
-{
-	if (m_db)
+	for (unsigned i = 0; i < 10; ++i)
 	{
-		ldb::WriteBatch batch;
-//		cnote << "Committing nodes to disk DB:";
-#if DEV_GUARDED_DB
-		DEV_READ_GUARDED(x_this)
-#endif
+		try
 		{
-			for (auto const& i: m_main)
-			{
-				if (i.second.second)
-					batch.Put(ldb::Slice((char const*)i.first.data(), i.first.size), ldb::Slice(i.second.first.data(), i.second.first.size()));
-//				cnote << i.first << "#" << m_main[i.first].second;
-			}
-			for (auto const& i: m_aux)
-				if (i.second.second)
-				{
-					bytes b = i.first.asBytes();
-					b.push_back(255);	// for aux
-					batch.Put(bytesConstRef(&b), bytesConstRef(&i.second.first));
-				}
+			_db.commit(_batch);
+			break;
 		}
-
-		for (unsigned i = 0; i < 10; ++i)
+		catch (DatabaseError const& _e)
 		{
-			ldb::Status o = m_db->Write(m_writeOptions, &batch);
-			if (o.ok())
-				break;
 			if (i == 9)
 			{
 				cwarn << "Fail writing to state database. Bombing out.";
 				exit(-1);
 			}
-			cwarn << "Error writing to state database: " << o.ToString();
-			WriteBatchNoter n;
-			batch.Iterate(&n);
+			cwarn << "Error writing to state database: " << _e.what();
 			cwarn << "Sleeping for" << (i + 1) << "seconds, then retrying.";
 			this_thread::sleep_for(chrono::seconds(i + 1));
 		}
-#if DEV_GUARDED_DB
-		DEV_WRITE_GUARDED(x_this)
-#endif
+	}
+}
+
+std::ostream& operator<<(std::ostream& _out, DBFlushStats const& _s)
+{
+	_out << _s.queued << " queued (max " << _s.maxQueued << "), " << _s.batches << " batches, " << (_s.bytes / 1024) << " KB, "
+		<< "latency last " << _s.lastMs << "ms avg " << _s.avgMs << "ms max " << _s.maxMs << "ms";
+	return _out;
+}
+
+DBFlusher::~DBFlusher()
+{
+	{
+		UniqueGuard l(x_queue);
+		m_stop = true;
+	}
+	m_queueChanged.notify_all();
+	// The loop drains the queue before honouring m_stop.
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void DBFlusher::submit(h256 const& _fence, std::unordered_map<h256, std::string>&& _nodes, std::unordered_map<h256, bytes>&& _aux)
+{
+	auto b = make_shared<Batch>();
+	b->fence = _fence;
+	b->nodes = move(_nodes);
+	b->aux = move(_aux);
+	b->submitted = chrono::steady_clock::now();
+	{
+		UniqueGuard l(x_queue);
+		if (!m_thread.joinable())
+			m_thread = std::thread([this]() { setThreadName("flusher"); flushLoop(); });
+		m_queue.push_back(b);
+		m_pending = m_queue.size();
+		m_stats.maxQueued = max(m_stats.maxQueued, m_queue.size());
+	}
+	m_queueChanged.notify_all();
+}
+
+void DBFlusher::flushLoop()
+{
+	while (true)
+	{
+		shared_ptr<Batch> b;
+		{
+			UniqueGuard l(x_queue);
+			m_queueChanged.wait(l, [&]() { return m_stop || !m_queue.empty(); });
+			if (m_queue.empty())
+				return;
+			b = m_queue.front();
+		}
+
+		auto batch = m_db->createWriteBatch();
+		size_t size = 0;
+		for (auto const& i: b->nodes)
+		{
+			batch->insert(i.first.ref(), bytesConstRef(&i.second));
+			size += i.second.size() + i.first.size;
+		}
+		for (auto const& i: b->aux)
+		{
+			bytes k = i.first.asBytes();
+			k.push_back(255);	// for aux
+			batch->insert(bytesConstRef(&k), bytesConstRef(&i.second));
+			size += i.second.size() + k.size();
+		}
+		writeBatchOrDie(*m_db, *batch);
+
+		double ms = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - b->submitted).count() / 1000.0;
+		{
+			UniqueGuard l(x_queue);
+			m_queue.pop_front();
+			m_pending = m_queue.size();
+			m_stats.batches++;
+			m_stats.bytes += size;
+			m_stats.lastMs = ms;
+			m_stats.maxMs = max(m_stats.maxMs, ms);
+			m_stats.avgMs += (ms - m_stats.avgMs) / m_stats.batches;
+		}
+		m_queueChanged.notify_all();
+	}
+}
+
+bool DBFlusher::lookup(h256 const& _h, std::string& o_value) const
+{
+	if (!m_pending)
+		return false;
+	UniqueGuard l(x_queue);
+	// Newest first.
+	for (auto it = m_queue.rbegin(); it != m_queue.rend(); ++it)
+	{
+		auto f = (*it)->nodes.find(_h);
+		if (f != (*it)->nodes.end())
+		{
+			o_value = f->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool DBFlusher::lookupRef(h256 const& _h, NodeRef& o_value) const
+{
+	if (!m_pending)
+		return false;
+	UniqueGuard l(x_queue);
+	for (auto it = m_queue.rbegin(); it != m_queue.rend(); ++it)
+	{
+		auto f = (*it)->nodes.find(_h);
+		if (f != (*it)->nodes.end())
+		{
+			o_value = NodeRef(bytesConstRef(&f->second), *it);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool DBFlusher::lookupAux(h256 const& _h, bytes& o_value) const
+{
+	if (!m_pending)
+		return false;
+	UniqueGuard l(x_queue);
+	for (auto it = m_queue.rbegin(); it != m_queue.rend(); ++it)
+	{
+		auto f = (*it)->aux.find(_h);
+		if (f != (*it)->aux.end())
+		{
+			o_value = f->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+void DBFlusher::waitFlushed(h256 const& _fence) const
+{
+	UniqueGuard l(x_queue);
+	m_queueChanged.wait(l, [&]()
+	{
+		if (!_fence)
+			return m_queue.empty();
+		for (auto const& b: m_queue)
+			if (b->fence == _fence)
+				return false;
+		return true;
+	});
+}
+
+DBFlushStats DBFlusher::stats() const
+{
+	UniqueGuard l(x_queue);
+	DBFlushStats ret = m_stats;
+	ret.queued = m_queue.size();
+	return ret;
+}
+
+void OverlayDB::commit(h256 const& _fence)
+{
+	if (m_db)
+	{
+		// Keep what we're writing hot; the next block will most likely touch it again.
+		auto noteCommitted = [&](h256 const& _h, bytesConstRef _v)
+		{
+			m_filter->insert(_h);
+			if (m_cache)
+				m_cache->insert(_h, _v);
+		};
+
+		if (m_flusher->enabled())
 		{
-			m_aux.clear();
-			m_main.clear();
+			// Freeze the overlay and hand it over; lookups see it through the flusher until it is on disk.
+			std::unordered_map<h256, std::string> nodes;
+			std::unordered_map<h256, bytes> aux;
+			forEach([&](h256 const& _h, bytesConstRef _v)
+			{
+				nodes.insert(make_pair(_h, _v.toString()));
+				noteCommitted(_h, _v);
+			});
+			forEachAux([&](h256 const& _h, bytesConstRef _v) { aux.insert(make_pair(_h, _v.toBytes())); });
+			m_flusher->submit(_fence, move(nodes), move(aux));
+			clear();
+			return;
 		}
+
+		auto batch = m_db->createWriteBatch();
+//		cnote << "Committing nodes to disk DB:";
+		forEach([&](h256 const& _h, bytesConstRef _v)
+		{
+			batch->insert(_h.ref(), _v);
+			noteCommitted(_h, _v);
+		});
+		forEachAux([&](h256 const& _h, bytesConstRef _v)
+		{
+			bytes b = _h.asBytes();
+			b.push_back(255);	// for aux
+			batch->insert(bytesConstRef(&b), _v);
+		});
+
+		// Don't overtake batches still queued from when async commits were on.
+		m_flusher->waitFlushed();
+		writeBatchOrDie(*m_db, *batch);
+		clear();
 	}
 }
 
 bytes OverlayDB::lookupAux(h256 const& _h) const
 {
-	bytes ret = MemoryDB::lookupAux(_h);
-	if (!ret.empty() || !m_db)
+	bytes ret = OverlayDBBase::lookupAux(_h);
+	if (!ret.empty() || !m_db || m_flusher->lookupAux(_h, ret))
 		return ret;
 	std::string v;
 	bytes b = _h.asBytes();
 	b.push_back(255);	// for aux
-	m_db->Get(m_readOptions, bytesConstRef(&b), &v);
+	m_db->get(bytesConstRef(&b), v);
 	if (v.empty())
 		cwarn << "Aux not found: " << _h;
 	return asBytes(v);
@@ -92,47 +290,174 @@ bytes OverlayDB::lookupAux(h256 const& _h) const
 
 void OverlayDB::rollback()
 {
-#if DEV_GUARDED_DB
-	WriteGuard l(x_this);
-#endif
-	m_main.clear();
+	clearNodes();
+}
+
+bool OverlayDB::prime(DatabaseFace const& _db, NodeExistenceFilter& _filter, atomic<bool> const& _stop)
+{
+	bool stopped = false;
+	_db.forEach([&](bytesConstRef _key, bytesConstRef)
+	{
+		if (_key.size() == h256::size)
+			_filter.insert(h256(_key.data(), h256::ConstructFromPointer));
+		stopped = _stop.load(memory_order_relaxed);
+		return !stopped;
+	});
+	if (stopped)
+		return false;
+	_filter.setAuthoritative();
+	ctrace << "Existence filter primed with" << _filter.count() << "nodes";
+	return true;
+}
+
+void OverlayDB::primeExistenceFilter()
+{
+	if (!m_db || m_filter->authoritative())
+		return;
+	atomic<bool> never{false};
+	prime(*m_db, *m_filter, never);
+}
+
+void OverlayDB::startPriming()
+{
+	if (!m_db || m_filter->authoritative() || m_priming)
+		return;
+	auto priming = make_shared<Priming>();
+	m_priming = priming;
+	shared_ptr<DatabaseFace> db = m_db;
+	shared_ptr<NodeExistenceFilter> filter = m_filter;
+	TaskScheduler::get().submit([db, filter, priming]() mutable
+	{
+		if (!priming->stop)
+			prime(*db, *filter, priming->stop);
+		// Let go of the database before saying so: the task object itself may outlive this.
+		db.reset();
+		filter.reset();
+		DEV_GUARDED(priming->x_done)
+			priming->finished = true;
+		priming->done.notify_all();
+	}, TaskPriority::Low);
+}
+
+void OverlayDB::stopPriming()
+{
+	if (!m_priming)
+		return;
+	m_priming->stop = true;
+	unique_lock<Mutex> l(m_priming->x_done);
+	m_priming->done.wait(l, [&]() { return m_priming->finished; });
+	l.unlock();
+	m_priming.reset();
+}
+
+bool OverlayDB::fetchCached(h256 const& _h, std::string& o_value) const
+{
+	return m_flusher->lookup(_h, o_value) || (m_cache && m_cache->lookup(_h, o_value));
+}
+
+bool OverlayDB::fetch(h256 const& _h, std::string* o_value) const
+{
+	if (!m_db)
+		return false;
+	std::string v;
+	if (fetchCached(_h, v))
+	{
+		if (o_value)
+			*o_value = move(v);
+		return true;
+	}
+	if (!m_filter->mayContain(_h))
+		return false;
+	m_db->get(_h.ref(), v);
+	if (v.empty())
+		return false;
+	if (m_cache)
+		m_cache->insert(_h, &v);
+	if (o_value)
+		*o_value = move(v);
+	return true;
 }
 
 std::string OverlayDB::lookup(h256 const& _h) const
 {
-	std::string ret = MemoryDB::lookup(_h);
-	if (ret.empty() && m_db)
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
+	std::string ret = OverlayDBBase::lookup(_h);
+	if (ret.empty())
+		fetch(_h, &ret);
+	return ret;
+}
+
+NodeRef OverlayDB::lookupRef(h256 const& _h) const
+{
+	NodeRef ret = OverlayDBBase::lookupRef(_h);
+	if (!ret.empty() || !m_db || m_flusher->lookupRef(_h, ret) || (m_cache && m_cache->lookupRef(_h, ret)) || !m_filter->mayContain(_h))
+		return ret;
+	if (m_db->zeroCopy())
+	{
+		// The map is as good as a cache; pin the engine itself.
+		bytesConstRef v;
+		if (m_db->getRef(_h.ref(), v))
+			ret = NodeRef(v, m_db);
+		return ret;
+	}
+	std::string v;
+	if (m_db->get(_h.ref(), v) && !v.empty())
+	{
+		auto s = make_shared<std::string const>(move(v));
+		if (m_cache)
+			m_cache->insert(_h, s);
+		ret = NodeRef(bytesConstRef(s.get()), s);
+	}
+	return ret;
+}
+
+std::vector<std::string> OverlayDB::lookupMany(h256s const& _hs) const
+{
+	std::vector<std::string> ret(_hs.size());
+	std::vector<size_t> misses;
+	for (size_t i = 0; i < _hs.size(); ++i)
+	{
+		ret[i] = OverlayDBBase::lookup(_hs[i]);
+		if (ret[i].empty() && m_db && !fetchCached(_hs[i], ret[i]) && m_filter->mayContain(_hs[i]))
+			misses.push_back(i);
+	}
+	if (misses.empty())
+		return ret;
+
+	std::vector<bytesConstRef> keys;
+	keys.reserve(misses.size());
+	for (size_t i: misses)
+		keys.push_back(_hs[i].ref());
+	std::vector<std::string> values;
+	m_db->getMany(keys, values);
+	for (size_t k = 0; k < misses.size(); ++k)
+		ret[misses[k]] = move(values[k]);
+
+	if (m_cache)
+		for (size_t i: misses)
+			if (!ret[i].empty())
+				m_cache->insert(_hs[i], &ret[i]);
 	return ret;
 }
 
 bool OverlayDB::exists(h256 const& _h) const
 {
-	if (MemoryDB::exists(_h))
-		return true;
-	std::string ret;
-	if (m_db)
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
-	return !ret.empty();
+	return OverlayDBBase::exists(_h) || fetch(_h, nullptr);
 }
 
 void OverlayDB::kill(h256 const& _h)
 {
 #if ETH_PARANOIA || 1
-	if (!MemoryDB::kill(_h))
+	if (!OverlayDBBase::kill(_h))
 	{
-		std::string ret;
-		if (m_db)
-			m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
 		// No point node ref decreasing for EmptyTrie since we never bother incrementing it in the first place for
 		// empty storage tries.
-		if (ret.empty() && _h != EmptyTrie)
+		if (_h != EmptyTrie && !fetch(_h, nullptr))
 			cnote << "Decreasing DB node ref count below zero with no DB node. Probably have a corrupt Trie." << _h;
 
 		// TODO: for 1.1: ref-counted triedb.
 	}
 #else
-	MemoryDB::kill(_h);
+	OverlayDBBase::kill(_h);
 #endif
 }
 
@@ -142,11 +467,18 @@ bool OverlayDB::deepkill(h256 const& _h)
 	kill(_h);
 
 	//kill in overlayDB
-	ldb::Status s = m_db->Delete(m_writeOptions, ldb::Slice((char const*)_h.data(), 32));
-	if (s.ok())
+	if (m_cache)
+		m_cache->erase(_h);
+	m_flusher->waitFlushed();
+	try
+	{
+		m_db->kill(_h.ref());
 		return true;
-	else
+	}
+	catch (DatabaseError const&)
+	{
 		return false;
+	}
 }
 }
 
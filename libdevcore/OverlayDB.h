@@ -1,26 +1,145 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <deque>
+#include <thread>
+#include <condition_variable>
 #include <libdevcore/db.h>
+#include <libdevcore/Guards.h>
+#include <libdevcore/DatabaseFace.h>
+#include <libdevcore/LDBDatabase.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/MemoryDB.h>
+#include <libdevcore/ShardedMemoryDB.h>
+#include <libdevcore/NodeCache.h>
 
 namespace dev
 {
 
-class OverlayDB: public MemoryDB
+/// The in-memory node store OverlayDB sits on; build with DEV_SHARDED_MEMORYDB to use the lock-striped one.
+#if DEV_SHARDED_MEMORYDB
+using OverlayDBBase = ShardedMemoryDB;
+#else
+using OverlayDBBase = MemoryDB;
+#endif
+
+struct DBFlushStats
+{
+	size_t queued = 0;			///< Batches waiting or being written.
+	size_t maxQueued = 0;
+	uint64_t batches = 0;		///< Batches written so far.
+	uint64_t bytes = 0;
+	double lastMs = 0;			///< Submit-to-durable latency.
+	double avgMs = 0;
+	double maxMs = 0;
+};
+
+std::ostream& operator<<(std::ostream& _out, DBFlushStats const& _s);
+
+/**
+ * @brief Writes frozen commit batches to the disk database on a background thread, in submission order.
+ *
+ * A batch stays visible through lookup() until its write has completed, so readers never fall into the
+ * gap between the overlay being cleared and the data reaching disk.
+ */
+class DBFlusher
+{
+public:
+	explicit DBFlusher(std::shared_ptr<DatabaseFace> const& _db): m_db(_db) {}
+	~DBFlusher();
+
+	bool enabled() const { return m_enabled; }
+	void setEnabled(bool _enabled) { m_enabled = _enabled; }
+
+	/// Queues the given nodes and aux entries for writing. @a _fence names the batch for waitFlushed().
+	void submit(h256 const& _fence, std::unordered_map<h256, std::string>&& _nodes, std::unordered_map<h256, bytes>&& _aux);
+
+	bool lookup(h256 const& _h, std::string& o_value) const;
+	/// lookup() without the copy; @a o_value pins the batch.
+	bool lookupRef(h256 const& _h, NodeRef& o_value) const;
+	bool lookupAux(h256 const& _h, bytes& o_value) const;
+
+	/// Blocks until no batch fenced with @a _fence is outstanding; a null fence waits for everything.
+	void waitFlushed(h256 const& _fence = h256()) const;
+
+	DBFlushStats stats() const;
+
+private:
+	struct Batch
+	{
+		h256 fence;
+		std::unordered_map<h256, std::string> nodes;
+		std::unordered_map<h256, bytes> aux;
+		std::chrono::steady_clock::time_point submitted;
+	};
+
+	void flushLoop();
+
+	std::shared_ptr<DatabaseFace> m_db;
+	std::atomic<bool> m_enabled{false};
+
+	mutable Mutex x_queue;
+	mutable std::condition_variable m_queueChanged;
+	std::deque<std::shared_ptr<Batch>> m_queue;		///< Front is the one being written.
+	std::atomic<size_t> m_pending{0};				///< m_queue.size(), readable without the lock.
+	std::thread m_thread;
+	bool m_stop = false;
+	DBFlushStats m_stats;
+};
+
+class OverlayDB: public OverlayDBBase
 {
 public:
-	OverlayDB(ldb::DB* _db = nullptr): m_db(_db) {}
+	static const size_t c_defaultCacheBytes = 64 * 1024 * 1024;
+	static const size_t c_existenceFilterBits = size_t(1) << 27;
+
+	/// @param _cacheBytes budget of the read cache of committed nodes; 0 disables it.
+	/// Adopts an open LevelDB/RocksDB database.
+	OverlayDB(ldb::DB* _db = nullptr, size_t _cacheBytes = c_defaultCacheBytes);
+	/// Sits on any storage engine; see openDatabase().
+	explicit OverlayDB(std::unique_ptr<DatabaseFace> _db, size_t _cacheBytes = c_defaultCacheBytes);
 	~OverlayDB();
 
-	ldb::DB* db() const { return m_db.get(); }
+	/// @returns the underlying LevelDB/RocksDB handle, or null when on another engine.
+	ldb::DB* db() const { auto l = dynamic_cast<LDBDatabase*>(m_db.get()); return l ? l->db() : nullptr; }
+	DatabaseFace* database() const { return m_db.get(); }
 
-	void commit();
+	/// Read cache, shared by all copies of this OverlayDB.
+	NodeCacheStats cacheStats() const { return m_cache ? m_cache->stats() : NodeCacheStats(); }
+	void setCacheSize(size_t _bytes) { if (m_cache) m_cache->setBudget(_bytes); }
+
+	/// Scans the disk database so that the existence filter can answer negative lookups; until then
+	/// (unless the database started out empty) every miss costs a disk read.
+	void primeExistenceFilter();
+	/// primeExistenceFilter() as a low-priority task on the TaskScheduler, filling the filter shared by all
+	/// copies. One at a time; stopPriming() cancels it.
+	void startPriming();
+	/// Cancels the priming task, if any, and waits until it has let go of the database.
+	void stopPriming();
+
+	/// Writes the overlay to disk and clears it. With async commits on, the write is handed to the
+	/// flusher thread and this returns at once; @a _fence (normally the state root the batch completes)
+	/// can then be passed to waitFlushed().
+	void commit(h256 const& _fence = h256());
 	void rollback();
 
+	/// Async commit mode is shared by all copies of this OverlayDB.
+	void setAsyncCommit(bool _async) { if (m_flusher) m_flusher->setEnabled(_async); }
+	bool asyncCommit() const { return m_flusher && m_flusher->enabled(); }
+	/// Durability fence: blocks until the batch committed with @a _fence is on disk (all batches if null).
+	void waitFlushed(h256 const& _fence = h256()) const { if (m_flusher) m_flusher->waitFlushed(_fence); }
+	DBFlushStats flushStats() const { return m_flusher ? m_flusher->stats() : DBFlushStats(); }
+
 	std::string lookup(h256 const& _h) const;
+	/// lookup() without the copy. Nodes from beneath the overlay are pinned: cache entries and in-flight
+	/// batches by reference count, zero-copy engines by the engine itself. Nodes still in the overlay are
+	/// pinned by ShardedMemoryDB but only borrowed from MemoryDB (valid until the next commit()).
+	NodeRef lookupRef(h256 const& _h) const;
+	/// Batched lookup(): everything not in memory is read from disk in one go (MultiGet on RocksDB,
+	/// concurrent Gets on LevelDB). @returns values in the order of @a _hs, empty where not found.
+	std::vector<std::string> lookupMany(h256s const& _hs) const;
 	bool exists(h256 const& _h) const;
 	void kill(h256 const& _h);
 	bool deepkill(h256 const& _h);
@@ -28,12 +147,32 @@ public:
 	bytes lookupAux(h256 const& _h) const;
 
 private:
-	using MemoryDB::clear;
+	using OverlayDBBase::clear;
+
+	/// Looks @a _h up beneath the overlay: in-flight batches, cache, existence filter, then disk.
+	bool fetch(h256 const& _h, std::string* o_value) const;
+	/// The in-memory part of fetch(): in-flight batches and cache.
+	bool fetchCached(h256 const& _h, std::string& o_value) const;
+
+	void init(size_t _cacheBytes);
+
+	/// The priming task's stop flag and completion.
+	struct Priming
+	{
+		std::atomic<bool> stop{false};
+		Mutex x_done;
+		std::condition_variable done;
+		bool finished = false;
+	};
 
-	std::shared_ptr<ldb::DB> m_db;
+	/// Scans @a _db into @a _filter until done or @a _stop is set. @returns true if it got to the end.
+	static bool prime(DatabaseFace const& _db, NodeExistenceFilter& _filter, std::atomic<bool> const& _stop);
 
-	ldb::ReadOptions m_readOptions;
-	ldb::WriteOptions m_writeOptions;
+	std::shared_ptr<DatabaseFace> m_db;
+	std::shared_ptr<NodeCache> m_cache;
+	std::shared_ptr<NodeExistenceFilter> m_filter;
+	std::shared_ptr<DBFlusher> m_flusher;
+	std::shared_ptr<Priming> m_priming;
 };
 
 }
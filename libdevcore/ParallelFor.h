@@ -0,0 +1,28 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include "TaskScheduler.h"
+
+namespace dev
+{
+
+/// @returns @a _threads, or the number of hardware threads if it is zero.
+inline unsigned resolveThreads(unsigned _threads)
+{
+	return _threads ? _threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Calls @a _f(i) for every i in [0, _n) on up to @a _threads threads (0: one per hardware thread), the
+ * calling thread included, and returns once all calls are done. Indices are handed out one at a time, so
+ * uneven work balances itself. The first exception thrown by @a _f is rethrown here. The other threads
+ * come from the process-wide TaskScheduler, so nothing is spawned per call.
+ */
+inline void parallelFor(size_t _n, std::function<void(size_t)> const& _f, unsigned _threads = 0)
+{
+	TaskScheduler::get().parallelFor(_n, _f, _threads);
+}
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Common.h"
+#include "CommonData.h"
+#include "FixedHash.h"
+#include "Uint256.h"
+
+namespace dev
+{
+
+/**
+ * @brief RLP encoder that writes straight into its destination, allocating nothing per item.
+ *
+ * RLPStream grows its output item by item and splices list headers in as lists complete. Here the
+ * caller's function is run twice with the same calls: once to measure (RLP puts a list's length before
+ * its items), then to write into a buffer sized exactly, once. Building works as with RLPStream
+ * (appendList(n), append(), appendRaw(), <<), so the same streaming code can serve both. The buffer behind
+ * encode() is kept from call to call and local() gives each thread its own encoder, so once warm,
+ * encoding allocates nothing at all.
+ */
+class RLPEncoder
+{
+public:
+	/// @returns this thread's encoder. Don't use it again from within one of its own encode() calls.
+	static RLPEncoder& local() { static thread_local RLPEncoder s_encoder; return s_encoder; }
+
+	/// Encodes what @a _f, called with this encoder, appends. @returns the encoding, valid until the next encode().
+	template <class F> bytesConstRef encode(F const& _f)
+	{
+		size_t size = measure(_f);
+		if (m_buffer.size() < size)
+			m_buffer.resize(size);
+		write(m_buffer.data(), _f);
+		return bytesConstRef(m_buffer.data(), size);
+	}
+
+	/// Appends the encoding of what @a _f appends to @a io_out, growing it once.
+	template <class F> void encodeInto(bytes& io_out, F const& _f)
+	{
+		size_t size = measure(_f);
+		size_t at = io_out.size();
+		io_out.resize(at + size);
+		write(io_out.data() + at, _f);
+	}
+
+	RLPEncoder& appendList(size_t _items)
+	{
+		if (m_measuring)
+		{
+			if (!_items)
+				return appendRaw(bytesConstRef(&c_emptyList, 1));
+			m_open.push_back(std::make_pair(_items, m_lists.size()));
+			m_lists.push_back(m_size);
+		}
+		else if (!_items)
+			*m_out++ = c_emptyList;
+		else
+			writeHeader(m_lists[m_nextList++], 0xc0);
+		return *this;
+	}
+
+	RLPEncoder& append(bytesConstRef _s)
+	{
+		bool single = _s.size() == 1 && _s[0] < 0x80;
+		if (m_measuring)
+		{
+			m_size += single ? 1 : headerSize(_s.size()) + _s.size();
+			noteAppended();
+		}
+		else
+		{
+			if (!single)
+				writeHeader(_s.size(), 0x80);
+			if (_s.size())
+				memcpy(m_out, _s.data(), _s.size());
+			m_out += _s.size();
+		}
+		return *this;
+	}
+	RLPEncoder& append(bytes const& _s) { return append(bytesConstRef(&_s)); }
+	RLPEncoder& append(std::string const& _s) { return append(bytesConstRef(_s)); }
+	RLPEncoder& append(char const* _s) { return append(bytesConstRef((byte const*)_s, strlen(_s))); }
+	template <unsigned N> RLPEncoder& append(FixedHash<N> const& _h) { return append(_h.ref()); }
+	template <class T> typename std::enable_if<std::is_integral<T>::value, RLPEncoder&>::type append(T _i) { return appendInt((uint64_t)_i); }
+	RLPEncoder& append(u256 const& _i) { return appendInt(_i); }
+	RLPEncoder& append(uint256 const& _i) { return appendInt(_i); }
+	RLPEncoder& append(bigint const& _i) { return appendInt(_i); }
+
+	/// Appends @a _rlp, which is already RLP and makes up @a _items items.
+	RLPEncoder& appendRaw(bytesConstRef _rlp, size_t _items = 1)
+	{
+		if (m_measuring)
+		{
+			m_size += _rlp.size();
+			if (_items)
+				noteAppended(_items);
+		}
+		else
+		{
+			if (_rlp.size())
+				memcpy(m_out, _rlp.data(), _rlp.size());
+			m_out += _rlp.size();
+		}
+		return *this;
+	}
+	RLPEncoder& appendRaw(bytes const& _rlp, size_t _items = 1) { return appendRaw(bytesConstRef(&_rlp), _items); }
+
+	template <class T> RLPEncoder& operator<<(T const& _t) { return append(_t); }
+
+private:
+	static const byte c_emptyList = 0xc0;
+
+	static size_t headerSize(size_t _length) { return _length < 56 ? 1 : 1 + bytesRequired(_length); }
+
+	template <class F> size_t measure(F const& _f)
+	{
+		m_measuring = true;
+		m_size = 0;
+		m_lists.clear();
+		m_open.clear();
+		_f(*this);
+		assert(m_open.empty());
+		return m_size;
+	}
+
+	template <class F> void write(byte* o_out, F const& _f)
+	{
+		m_measuring = false;
+		m_out = o_out;
+		m_nextList = 0;
+		_f(*this);
+	}
+
+	template <class T> RLPEncoder& appendInt(T const& _i)
+	{
+		if (!_i)
+			return append(bytesConstRef());
+		if (_i < 0x80)
+		{
+			byte b = (byte)_i;
+			return append(bytesConstRef(&b, 1));
+		}
+		unsigned n = bytesRequired(_i);
+		if (m_measuring)
+		{
+			m_size += 1 + n;
+			noteAppended();
+		}
+		else
+		{
+			*m_out++ = byte(0x80 + n);
+			for (unsigned i = n; i--;)
+				*m_out++ = (byte)(_i >> (i * 8));
+		}
+		return *this;
+	}
+
+	void writeHeader(size_t _length, byte _base)
+	{
+		if (_length < 56)
+			*m_out++ = byte(_base + _length);
+		else
+		{
+			unsigned n = bytesRequired(_length);
+			*m_out++ = byte(_base + 55 + n);
+			for (unsigned i = n; i--;)
+				*m_out++ = byte(_length >> (i * 8));
+		}
+	}
+
+	/// Measuring: counts @a _items items towards the innermost open list, closing the lists they complete.
+	void noteAppended(size_t _items = 1)
+	{
+		while (!m_open.empty())
+		{
+			auto& top = m_open.back();
+			assert(top.first >= _items);
+			top.first -= _items;
+			if (top.first)
+				return;
+			size_t& length = m_lists[top.second];
+			length = m_size - length;
+			m_size += headerSize(length);
+			m_open.pop_back();
+			_items = 1;
+		}
+	}
+
+	bool m_measuring = false;
+	size_t m_size = 0;									///< Measuring: bytes so far, headers of open lists excluded.
+	std::vector<size_t> m_lists;						///< Payload length of each list, in order of opening.
+	std::vector<std::pair<size_t, size_t>> m_open;		///< Measuring: items to come and index into m_lists, per open list.
+	byte* m_out = nullptr;								///< Writing: where the next byte goes.
+	size_t m_nextList = 0;								///< Writing: the next entry of m_lists.
+	bytes m_buffer;
+};
+
+}
@@ -0,0 +1,72 @@
+#include "RLPIndex.h"
+#include "Exceptions.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+/// Decodes the header of the item at @a _at. @returns the header's size; the payload's length goes in @a o_length.
+size_t decodeHeader(bytesConstRef _data, size_t _at, size_t& o_length, bool& o_isList)
+{
+	if (_at >= _data.size())
+		BOOST_THROW_EXCEPTION(BadRLP());
+	byte b = _data[_at];
+	o_isList = b >= 0xc0;
+	if (b < 0x80)
+	{
+		o_length = 1;
+		return 0;
+	}
+	byte base = o_isList ? 0xc0 : 0x80;
+	if (b < base + 56)
+	{
+		o_length = b - base;
+		return 1;
+	}
+	unsigned lengthSize = b - base - 55;
+	if (lengthSize > 4 || _at + 1 + lengthSize > _data.size())
+		BOOST_THROW_EXCEPTION(BadRLP());
+	o_length = 0;
+	for (unsigned i = 0; i < lengthSize; ++i)
+		o_length = (o_length << 8) | _data[_at + 1 + i];
+	return 1 + lengthSize;
+}
+
+}
+
+RLPIndex::RLPIndex(bytesConstRef _data, size_t _at)
+{
+	size_t length;
+	bool isList;
+	size_t pos = _at + decodeHeader(_data, _at, length, isList);
+	size_t end = pos + length;
+	if (!isList || end > _data.size() || end > 0xffffffff)
+		BOOST_THROW_EXCEPTION(BadRLP());
+
+	// Sizing the table first would take a walk of its own, so let it grow; short transactions run ~110 bytes.
+	m_offsets.reserve(length / 128 + 2);
+	while (pos < end)
+	{
+		m_offsets.push_back((uint32_t)pos);
+		size_t header = decodeHeader(_data, pos, length, isList);
+		pos += header + length;
+	}
+	if (pos != end)
+		BOOST_THROW_EXCEPTION(BadRLP());
+	m_offsets.push_back((uint32_t)end);
+}
+
+vector<bytesConstRef> RLPIndex::items(bytesConstRef _data) const
+{
+	vector<bytesConstRef> ret;
+	ret.reserve(size());
+	for (size_t i = 0; i < size(); ++i)
+		ret.push_back(item(_data, i));
+	return ret;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include "Common.h"
+
+namespace dev
+{
+
+/**
+ * @brief Offset table over the items of an RLP list.
+ *
+ * RLP::operator[] walks the list from its start on every call, so visiting all the items of a large
+ * list by index is quadratic. This walks the list once and notes where each item starts; after that an
+ * item is a lookup. The index holds offsets only, not the data, so it stays valid when the bytes it was
+ * built from are moved, and several indices can share one buffer (e.g. a block and its transaction list).
+ */
+class RLPIndex
+{
+public:
+	RLPIndex() = default;
+	/// Indexes the list that starts @a _at bytes into @a _data. @throws BadRLP if it is not a well-formed list.
+	explicit RLPIndex(bytesConstRef _data, size_t _at = 0);
+
+	/// @returns the number of items in the list.
+	size_t size() const { return m_offsets.empty() ? 0 : m_offsets.size() - 1; }
+	bool empty() const { return size() == 0; }
+
+	/// @returns where in the data item @a _i starts.
+	size_t offset(size_t _i) const { return m_offsets[_i]; }
+	/// @returns item @a _i, encoding included, out of @a _data, which must be what the index was built from.
+	bytesConstRef item(bytesConstRef _data, size_t _i) const { return _data.cropped(m_offsets[_i], m_offsets[_i + 1] - m_offsets[_i]); }
+	/// @returns all the items, in order, as item() gives them.
+	std::vector<bytesConstRef> items(bytesConstRef _data) const;
+
+private:
+	std::vector<uint32_t> m_offsets;	///< Where each item starts, then where the last one ends.
+};
+
+}
@@ -0,0 +1,364 @@
+#include "ShardedMemoryDB.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+static const size_t c_chunkSize = 64 * 1024;
+/// Payloads above this get a chunk of their own rather than wasting the tail of the current one.
+static const size_t c_largePayload = c_chunkSize / 4;
+static const size_t c_minCapacity = 64;
+
+/// Non-null marker for zero-length values, since a null data pointer denotes an empty slot.
+static const byte c_emptyValue = 0;
+
+/// The shard is picked by byte 0, so probe on bytes 8..15 which are independent of it.
+inline size_t slotHash(h256 const& _h)
+{
+	uint64_t ret;
+	memcpy(&ret, _h.data() + 8, sizeof(ret));
+	return (size_t)ret;
+}
+
+}
+
+ShardedMemoryDB::Slot* ShardedMemoryDB::Shard::find(h256 const& _h)
+{
+	if (table.empty())
+		return nullptr;
+	size_t mask = table.size() - 1;
+	for (size_t i = slotHash(_h) & mask;; i = (i + 1) & mask)
+	{
+		Slot& s = table[i];
+		if (!s.data)
+			return nullptr;
+		if (s.key == _h)
+			return &s;
+	}
+}
+
+ShardedMemoryDB::Slot& ShardedMemoryDB::Shard::findOrAdd(h256 const& _h)
+{
+	if ((used + 1) * 10 > table.size() * 7)
+		rehash(max(c_minCapacity, table.size() * 2));
+	size_t mask = table.size() - 1;
+	for (size_t i = slotHash(_h) & mask;; i = (i + 1) & mask)
+	{
+		Slot& s = table[i];
+		if (!s.data)
+		{
+			s.key = _h;
+			s.refs = 0;
+			s.size = 0;
+			++used;
+			return s;
+		}
+		if (s.key == _h)
+			return s;
+	}
+}
+
+byte const* ShardedMemoryDB::Shard::store(bytesConstRef _v)
+{
+	if (_v.empty())
+		return &c_emptyValue;
+	if (_v.size() > c_largePayload)
+	{
+		if (!arena)
+			arena = make_shared<Arena>();
+		unique_ptr<byte[]> c(new byte[_v.size()]);
+		memcpy(c.get(), _v.data(), _v.size());
+		byte const* ret = c.get();
+		// Keep the chunk being filled at the back.
+		arena->insert(arena->empty() ? arena->end() : prev(arena->end()), move(c));
+		arenaBytes += _v.size();
+		return ret;
+	}
+	if (_v.size() > left)
+	{
+		if (!arena)
+			arena = make_shared<Arena>();
+		arena->emplace_back(new byte[c_chunkSize]);
+		cursor = arena->back().get();
+		left = c_chunkSize;
+		arenaBytes += c_chunkSize;
+	}
+	byte* ret = cursor;
+	memcpy(ret, _v.data(), _v.size());
+	cursor += _v.size();
+	left -= _v.size();
+	return ret;
+}
+
+void ShardedMemoryDB::Shard::rehash(size_t _capacity)
+{
+	vector<Slot> old(_capacity, Slot{h256(), nullptr, 0, 0});
+	old.swap(table);
+	size_t mask = table.size() - 1;
+	for (Slot const& o: old)
+		if (o.data)
+		{
+			size_t i = slotHash(o.key) & mask;
+			while (table[i].data)
+				i = (i + 1) & mask;
+			table[i] = o;
+		}
+}
+
+void ShardedMemoryDB::Shard::compact()
+{
+	vector<Slot> live;
+	live.reserve(used);
+	for (Slot const& s: table)
+		if (s.data && s.refs)
+			live.push_back(s);
+
+	// Copy the surviving payloads into a fresh arena; the old one goes once everything is moved and
+	// no NodeRef pins it any more.
+	shared_ptr<Arena> old = move(arena);
+	arena.reset();
+	cursor = nullptr;
+	left = 0;
+	arenaBytes = 0;
+	for (Slot& s: live)
+		s.data = store(bytesConstRef(s.data, s.size));
+
+	size_t capacity = c_minCapacity;
+	while (live.size() * 10 > capacity * 7)
+		capacity *= 2;
+	table.assign(live.empty() ? 0 : capacity, Slot{h256(), nullptr, 0, 0});
+	used = 0;
+	if (!live.empty())
+	{
+		size_t mask = table.size() - 1;
+		for (Slot const& s: live)
+		{
+			size_t i = slotHash(s.key) & mask;
+			while (table[i].data)
+				i = (i + 1) & mask;
+			table[i] = s;
+		}
+		used = live.size();
+	}
+}
+
+void ShardedMemoryDB::Shard::reset()
+{
+	vector<Slot>().swap(table);
+	used = 0;
+	arena.reset();
+	cursor = nullptr;
+	left = 0;
+	arenaBytes = 0;
+}
+
+ShardedMemoryDB::ShardedMemoryDB(unsigned _shards)
+{
+	unsigned n = 1;
+	while (n < _shards && n < 256)
+		n *= 2;
+	m_mask = n - 1;
+	m_shards.reserve(n);
+	for (unsigned i = 0; i < n; ++i)
+		m_shards.emplace_back(new Shard);
+}
+
+ShardedMemoryDB& ShardedMemoryDB::operator=(ShardedMemoryDB const& _c)
+{
+	if (this == &_c)
+		return *this;
+	clear();
+	for (auto const& s: _c.m_shards)
+	{
+		ReadGuard l(s->x_shard);
+		for (Slot const& i: s->table)
+			if (i.data)
+			{
+				Shard& d = shardFor(i.key);
+				WriteGuard l2(d.x_shard);
+				Slot& n = d.findOrAdd(i.key);
+				n.data = d.store(bytesConstRef(i.data, i.size));
+				n.size = i.size;
+				n.refs = i.refs;
+			}
+		for (auto const& i: s->aux)
+		{
+			Shard& d = shardFor(i.first);
+			WriteGuard l2(d.x_shard);
+			d.aux[i.first] = i.second;
+		}
+	}
+	return *this;
+}
+
+void ShardedMemoryDB::clear()
+{
+	for (auto const& s: m_shards)
+	{
+		WriteGuard l(s->x_shard);
+		s->reset();
+		s->aux.clear();
+	}
+}
+
+void ShardedMemoryDB::clearNodes()
+{
+	for (auto const& s: m_shards)
+	{
+		WriteGuard l(s->x_shard);
+		s->reset();
+	}
+}
+
+std::unordered_map<h256, std::string> ShardedMemoryDB::get() const
+{
+	std::unordered_map<h256, std::string> ret;
+	for (auto const& s: m_shards)
+	{
+		ReadGuard l(s->x_shard);
+		for (Slot const& i: s->table)
+			if (i.data && (!m_enforceRefs || i.refs > 0))
+				ret.insert(make_pair(i.key, string((char const*)i.data, i.size)));
+	}
+	return ret;
+}
+
+std::string ShardedMemoryDB::lookup(h256 const& _h) const
+{
+	Shard const& s = shardFor(_h);
+	ReadGuard l(s.x_shard);
+	if (Slot const* i = s.find(_h))
+	{
+		if (!m_enforceRefs || i->refs > 0)
+			return string((char const*)i->data, i->size);
+		else
+			cwarn << "Lookup required for value with refcount == 0. This is probably a critical trie issue" << _h;
+	}
+	return std::string();
+}
+
+NodeRef ShardedMemoryDB::lookupRef(h256 const& _h) const
+{
+	Shard const& s = shardFor(_h);
+	ReadGuard l(s.x_shard);
+	Slot const* i = s.find(_h);
+	if (i && (!m_enforceRefs || i->refs > 0))
+		return NodeRef(bytesConstRef(i->data, i->size), s.arena);
+	return NodeRef();
+}
+
+bool ShardedMemoryDB::exists(h256 const& _h) const
+{
+	Shard const& s = shardFor(_h);
+	ReadGuard l(s.x_shard);
+	Slot const* i = s.find(_h);
+	return i && (!m_enforceRefs || i->refs > 0);
+}
+
+void ShardedMemoryDB::insert(h256 const& _h, bytesConstRef _v)
+{
+	Shard& s = shardFor(_h);
+	WriteGuard l(s.x_shard);
+	Slot& i = s.findOrAdd(_h);
+	// Content-addressed, so a re-insert almost always carries the same bytes; only copy when it doesn't.
+	if (!i.data || i.size != _v.size() || memcmp(i.data, _v.data(), _v.size()))
+	{
+		i.data = s.store(_v);
+		i.size = (uint32_t)_v.size();
+	}
+	i.refs++;
+#if ETH_PARANOIA
+	dbdebug << "INST" << _h << "=>" << i.refs;
+#endif
+}
+
+bool ShardedMemoryDB::kill(h256 const& _h)
+{
+	Shard& s = shardFor(_h);
+	WriteGuard l(s.x_shard);
+	if (Slot* i = s.find(_h))
+	{
+		if (i->refs > 0)
+		{
+			i->refs--;
+			return true;
+		}
+#if ETH_PARANOIA
+		dbdebug << "NOKILL-WAS" << _h;
+	}
+	else
+	{
+		dbdebug << "NOKILL" << _h;
+#endif
+	}
+	return false;
+}
+
+bytes ShardedMemoryDB::lookupAux(h256 const& _h) const
+{
+	Shard const& s = shardFor(_h);
+	ReadGuard l(s.x_shard);
+	auto it = s.aux.find(_h);
+	if (it != s.aux.end() && (!m_enforceRefs || it->second.second))
+		return it->second.first;
+	return bytes();
+}
+
+void ShardedMemoryDB::removeAux(h256 const& _h)
+{
+	Shard& s = shardFor(_h);
+	WriteGuard l(s.x_shard);
+	s.aux[_h].second = false;
+}
+
+void ShardedMemoryDB::insertAux(h256 const& _h, bytesConstRef _v)
+{
+	Shard& s = shardFor(_h);
+	WriteGuard l(s.x_shard);
+	s.aux[_h] = make_pair(_v.toBytes(), true);
+}
+
+void ShardedMemoryDB::purge()
+{
+	for (auto const& s: m_shards)
+	{
+		WriteGuard l(s->x_shard);
+		s->compact();
+		for (auto it = s->aux.begin(); it != s->aux.end(); )
+			if (it->second.second)
+				++it;
+			else
+				it = s->aux.erase(it);
+	}
+}
+
+h256Hash ShardedMemoryDB::keys() const
+{
+	h256Hash ret;
+	forEach([&](h256 const& _h, bytesConstRef) { ret.insert(_h); });
+	return ret;
+}
+
+size_t ShardedMemoryDB::size() const
+{
+	size_t ret = 0;
+	forEach([&](h256 const&, bytesConstRef) { ++ret; });
+	return ret;
+}
+
+size_t ShardedMemoryDB::memoryUsed() const
+{
+	size_t ret = 0;
+	for (auto const& s: m_shards)
+	{
+		ReadGuard l(s->x_shard);
+		ret += sizeof(Shard) + s->table.capacity() * sizeof(Slot) + s->arenaBytes;
+	}
+	return ret;
+}
+
+}
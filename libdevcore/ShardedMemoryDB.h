@@ -0,0 +1,141 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Common.h"
+#include "Guards.h"
+#include "FixedHash.h"
+#include "MemoryDB.h"
+
+namespace dev
+{
+
+/**
+ * @brief Drop-in alternative to MemoryDB tuned for heavy node churn from several threads.
+ *
+ * Nodes are spread over a power-of-two number of shards by the leading byte of their hash, each
+ * shard having its own lock. Within a shard the keys live inline in a flat, linearly probed table
+ * and the payloads are carved out of a bump arena, so an insert costs no heap allocation in the
+ * common case. Dead (refcount zero) entries are kept until purge(), exactly as MemoryDB does; purge()
+ * also compacts the arena.
+ *
+ * Unlike MemoryDB the shard locks are always taken, irrespective of DEV_GUARDED_DB.
+ */
+class ShardedMemoryDB
+{
+	friend class EnforceRefs;
+
+public:
+	static const unsigned c_defaultShards = 16;
+
+	explicit ShardedMemoryDB(unsigned _shards = c_defaultShards);
+	ShardedMemoryDB(ShardedMemoryDB const& _c): ShardedMemoryDB((unsigned)_c.m_shards.size()) { operator=(_c); }
+
+	ShardedMemoryDB& operator=(ShardedMemoryDB const& _c);
+
+	void clear();
+	std::unordered_map<h256, std::string> get() const;
+
+	std::string lookup(h256 const& _h) const;
+	/// lookup() without the copy. The view pins the shard's arena, so it stays valid across purge() and clear().
+	NodeRef lookupRef(h256 const& _h) const;
+	bool exists(h256 const& _h) const;
+	void insert(h256 const& _h, bytesConstRef _v);
+	bool kill(h256 const& _h);
+	void purge();
+
+	bytes lookupAux(h256 const& _h) const;
+	void removeAux(h256 const& _h);
+	void insertAux(h256 const& _h, bytesConstRef _v);
+
+	h256Hash keys() const;
+
+	/// @returns the number of nodes with a positive reference count.
+	size_t size() const;
+	/// @returns bytes held by the node tables and arenas (aux data excluded).
+	size_t memoryUsed() const;
+
+	/// Calls @a _f(h256 const&, bytesConstRef) for every node with a positive reference count.
+	template <class F> void forEach(F const& _f) const
+	{
+		for (auto const& s: m_shards)
+		{
+			ReadGuard l(s->x_shard);
+			for (Slot const& i: s->table)
+				if (i.data && i.refs)
+					_f(i.key, bytesConstRef(i.data, i.size));
+		}
+	}
+	/// Calls @a _f(h256 const&, bytesConstRef) for every live aux entry.
+	template <class F> void forEachAux(F const& _f) const
+	{
+		for (auto const& s: m_shards)
+		{
+			ReadGuard l(s->x_shard);
+			for (auto const& i: s->aux)
+				if (i.second.second)
+					_f(i.first, bytesConstRef(&i.second.first));
+		}
+	}
+
+protected:
+	/// Drops all nodes but keeps the aux entries.
+	void clearNodes();
+
+private:
+	/// A table entry; empty iff data is null.
+	struct Slot
+	{
+		h256 key;
+		byte const* data;
+		uint32_t size;
+		uint32_t refs;
+	};
+
+	using Arena = std::vector<std::unique_ptr<byte[]>>;
+
+	/// One lock stripe. Allocated separately so that neighbouring stripes don't share cache lines.
+	struct Shard
+	{
+		Slot* find(h256 const& _h);
+		Slot const* find(h256 const& _h) const { return const_cast<Shard*>(this)->find(_h); }
+		Slot& findOrAdd(h256 const& _h);
+		byte const* store(bytesConstRef _v);
+		void rehash(size_t _capacity);
+		void compact();
+		void reset();
+
+		mutable SharedMutex x_shard;
+		std::vector<Slot> table;						///< Power-of-two sized, linearly probed.
+		size_t used = 0;								///< Occupied slots, live or dead.
+		/// Arena storage; the last chunk is the one being filled. Shared with the NodeRefs handed out, so
+		/// compact() and reset() start a new one rather than freeing it.
+		std::shared_ptr<Arena> arena;
+		byte* cursor = nullptr;
+		size_t left = 0;
+		size_t arenaBytes = 0;
+		std::unordered_map<h256, std::pair<bytes, bool>> aux;	///< Aux data is rare; a plain map is fine.
+	};
+
+	Shard& shardFor(h256 const& _h) const { return *m_shards[_h[0] & m_mask]; }
+
+	std::vector<std::unique_ptr<Shard>> m_shards;
+	unsigned m_mask = 0;
+
+	mutable bool m_enforceRefs = false;
+};
+
+inline std::ostream& operator<<(std::ostream& _out, ShardedMemoryDB const& _m)
+{
+	for (auto const& i: _m.get())
+	{
+		_out << i.first << ": ";
+		_out << RLP(i.second);
+		_out << " " << toHex(i.second);
+		_out << std::endl;
+	}
+	return _out;
+}
+
+}
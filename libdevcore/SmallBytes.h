@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include "Common.h"
+#include "MemoryAccounting.h"
+
+namespace dev
+{
+
+/**
+ * @brief Byte string that keeps up to @a N bytes in place and only goes to the heap beyond that.
+ *
+ * Transaction payloads, consensus messages and RLP fragments are mostly a few hundred bytes, and as
+ * `bytes` each costs a heap allocation and a pointer chase. This has the parts of the vector interface
+ * that such code uses (and converts to bytesConstRef, which the RLP, hashing and signing functions take),
+ * so a `bytes` member can be swapped for it. Heap buffers are charged to @a Tag; the inline bytes are
+ * part of whatever holds the object.
+ *
+ * Moving a short string copies its N bytes of storage and moving a long one takes over its buffer, so N
+ * should be about the typical size and not much more.
+ */
+template <unsigned N, MemoryTag Tag = MemoryTag::Other>
+class SmallBytes
+{
+public:
+	using value_type = byte;
+	using size_type = size_t;
+	using iterator = byte*;
+	using const_iterator = byte const*;
+
+	SmallBytes() {}
+	explicit SmallBytes(size_t _n, byte _v = 0) { resize(_n, _v); }
+	SmallBytes(bytesConstRef _b) { assign(_b.data(), _b.size()); }
+	SmallBytes(bytes const& _b) { assign(_b.data(), _b.size()); }
+	SmallBytes(std::initializer_list<byte> _l) { assign(_l.begin(), _l.size()); }
+	SmallBytes(SmallBytes const& _s) { assign(_s.data(), _s.size()); }
+	SmallBytes(SmallBytes&& _s) { take(_s); }
+	~SmallBytes() { freeHeap(); }
+
+	SmallBytes& operator=(SmallBytes const& _s) { if (this != &_s) assign(_s.data(), _s.size()); return *this; }
+	SmallBytes& operator=(SmallBytes&& _s) { if (this != &_s) { freeHeap(); take(_s); } return *this; }
+	SmallBytes& operator=(bytesConstRef _b) { assign(_b.data(), _b.size()); return *this; }
+	SmallBytes& operator=(bytes const& _b) { assign(_b.data(), _b.size()); return *this; }
+
+	size_t size() const { return m_size; }
+	bool empty() const { return !m_size; }
+	size_t capacity() const { return m_capacity; }
+	/// True while the bytes are held in place.
+	bool isInline() const { return m_data == m_inline; }
+
+	byte* data() { return m_data; }
+	byte const* data() const { return m_data; }
+	byte* begin() { return m_data; }
+	byte* end() { return m_data + m_size; }
+	byte const* begin() const { return m_data; }
+	byte const* end() const { return m_data + m_size; }
+	byte& operator[](size_t _i) { return m_data[_i]; }
+	byte operator[](size_t _i) const { return m_data[_i]; }
+	byte& front() { return m_data[0]; }
+	byte& back() { return m_data[m_size - 1]; }
+
+	bytesRef ref() { return bytesRef(m_data, m_size); }
+	bytesConstRef ref() const { return bytesConstRef(m_data, m_size); }
+	operator bytesConstRef() const { return ref(); }
+	bytes toBytes() const { return bytes(begin(), end()); }
+
+	void reserve(size_t _n) { if (_n > m_capacity) grow(_n); }
+	void resize(size_t _n, byte _v = 0)
+	{
+		reserve(_n);
+		if (_n > m_size)
+			memset(m_data + m_size, _v, _n - m_size);
+		m_size = _n;
+	}
+	void clear() { m_size = 0; }
+	void push_back(byte _b) { if (m_size == m_capacity) grow(m_size + 1); m_data[m_size++] = _b; }
+	void append(bytesConstRef _b)
+	{
+		reserve(m_size + _b.size());
+		if (_b.size())
+			memcpy(m_data + m_size, _b.data(), _b.size());
+		m_size += _b.size();
+	}
+	void assign(byte const* _p, size_t _n)
+	{
+		m_size = 0;
+		reserve(_n);
+		if (_n)
+			memmove(m_data, _p, _n);
+		m_size = _n;
+	}
+
+	void swap(SmallBytes& _s) { SmallBytes t(std::move(_s)); _s = std::move(*this); *this = std::move(t); }
+
+	bool operator==(SmallBytes const& _s) const { return equals(_s.data(), _s.size()); }
+	bool operator!=(SmallBytes const& _s) const { return !operator==(_s); }
+	bool operator==(bytes const& _b) const { return equals(_b.data(), _b.size()); }
+	bool operator!=(bytes const& _b) const { return !operator==(_b); }
+
+private:
+	bool equals(byte const* _p, size_t _n) const { return m_size == _n && (!_n || !memcmp(m_data, _p, _n)); }
+
+	/// Moves to a heap buffer of at least @a _n bytes, growing geometrically.
+	void grow(size_t _n)
+	{
+		size_t cap = std::max(_n, m_capacity * 2);
+		byte* p = static_cast<byte*>(::operator new(cap));
+		chargeMemory(Tag, cap);
+		if (m_size)
+			memcpy(p, m_data, m_size);
+		freeHeap();
+		m_data = p;
+		m_capacity = cap;
+	}
+	void freeHeap()
+	{
+		if (!isInline())
+		{
+			releaseMemory(Tag, m_capacity);
+			::operator delete(m_data);
+			m_data = m_inline;
+			m_capacity = N;
+		}
+	}
+	/// Takes the contents of @a _s, leaving it empty. Any heap buffer of ours must be freed already.
+	void take(SmallBytes& _s)
+	{
+		if (_s.isInline())
+		{
+			m_data = m_inline;
+			m_capacity = N;
+			if (_s.m_size)
+				memcpy(m_inline, _s.m_inline, _s.m_size);
+		}
+		else
+		{
+			m_data = _s.m_data;
+			m_capacity = _s.m_capacity;
+			_s.m_data = _s.m_inline;
+			_s.m_capacity = N;
+		}
+		m_size = _s.m_size;
+		_s.m_size = 0;
+	}
+
+	byte* m_data = m_inline;
+	size_t m_size = 0;
+	size_t m_capacity = N;
+	byte m_inline[N];
+};
+
+}
@@ -0,0 +1,309 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include "Log.h"
+#include "ParallelFor.h"
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+/// The scheduler the current thread belongs to, and its index there.
+thread_local TaskScheduler const* t_scheduler = nullptr;
+thread_local unsigned t_index = 0;
+
+}
+
+TaskScheduler& TaskScheduler::get()
+{
+	static TaskScheduler s_scheduler;
+	return s_scheduler;
+}
+
+TaskScheduler::TaskScheduler(unsigned _threads):
+	m_started(Clock::now())
+{
+	unsigned threads = resolveThreads(_threads);
+	for (unsigned i = 0; i < threads; ++i)
+		m_queues.emplace_back(new Queue);
+	for (unsigned i = 0; i < threads; ++i)
+		m_threads.emplace_back([=]() { threadBody(i); });
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	m_stopping = true;
+	DEV_GUARDED(x_sleep)
+		m_wake.notify_all();
+	for (auto& t: m_threads)
+		t.join();
+}
+
+void TaskScheduler::push(Task&& _t, TaskPriority _p)
+{
+	// Pool threads keep their own work; everyone else's is dealt round-robin.
+	unsigned q = t_scheduler == this ? t_index : m_nextQueue++ % m_queues.size();
+	DEV_GUARDED(m_queues[q]->x_tasks)
+		m_queues[q]->tasks[(unsigned)_p].push_back(move(_t));
+	++m_pending;
+}
+
+void TaskScheduler::submit(Task _t, TaskPriority _p)
+{
+	push(move(_t), _p);
+	Guard l(x_sleep);
+	if (m_sleeping)
+		m_wake.notify_one();
+}
+
+void TaskScheduler::submitAfter(chrono::milliseconds _delay, Task _t, TaskPriority _p)
+{
+	Guard l(x_sleep);
+	m_delayed.push(Delayed{Clock::now() + _delay, m_delayedCount++, _p, move(_t)});
+	// A sleeper may be waiting for a later timer than this one.
+	if (m_sleeping)
+		m_wake.notify_one();
+}
+
+TaskScheduler::Clock::time_point TaskScheduler::releaseDue()
+{
+	auto now = Clock::now();
+	unsigned released = 0;
+	while (!m_delayed.empty() && m_delayed.top().due <= now)
+	{
+		Delayed d = move(const_cast<Delayed&>(m_delayed.top()));
+		m_delayed.pop();
+		push(move(d.task), d.priority);
+		++released;
+	}
+	for (unsigned i = 1; i < released && i <= m_sleeping; ++i)
+		m_wake.notify_one();
+	return m_delayed.empty() ? Clock::time_point::max() : m_delayed.top().due;
+}
+
+bool TaskScheduler::take(unsigned _own, Task& o_task, bool& o_stolen)
+{
+	if (!m_pending)
+		return false;
+	size_t n = m_queues.size();
+	for (unsigned p = 0; p < c_priorities; ++p)
+	{
+		{
+			Queue& q = *m_queues[_own];
+			Guard l(q.x_tasks);
+			if (!q.tasks[p].empty())
+			{
+				o_task = move(q.tasks[p].back());
+				q.tasks[p].pop_back();
+				--m_pending;
+				o_stolen = false;
+				return true;
+			}
+		}
+		for (size_t k = 1; k < n; ++k)
+		{
+			Queue& q = *m_queues[(_own + k) % n];
+			Guard l(q.x_tasks);
+			if (!q.tasks[p].empty())
+			{
+				o_task = move(q.tasks[p].front());
+				q.tasks[p].pop_front();
+				--m_pending;
+				o_stolen = true;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void TaskScheduler::run(Task& _t, bool _poolThread)
+{
+	auto start = Clock::now();
+	try
+	{
+		_t();
+	}
+	catch (std::exception const& _e)
+	{
+		clog(WarnChannel) << "Exception thrown in scheduled task: " << _e.what();
+	}
+	_t = nullptr;
+	++m_tasks;
+	if (_poolThread)
+		m_busyNs += chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+void TaskScheduler::threadBody(unsigned _index)
+{
+	setThreadName("pool" + toString(_index));
+	t_scheduler = this;
+	t_index = _index;
+	Task t;
+	bool stolen;
+	while (true)
+	{
+		if (take(_index, t, stolen))
+		{
+			if (stolen)
+				++m_steals;
+			run(t, true);
+			continue;
+		}
+
+		UniqueGuard l(x_sleep);
+		auto next = releaseDue();
+		if (m_pending)
+			continue;
+		if (m_stopping)
+			break;
+		++m_sleeping;
+		if (next == Clock::time_point::max())
+			m_wake.wait(l);
+		else
+			m_wake.wait_until(l, next);
+		--m_sleeping;
+	}
+}
+
+bool TaskScheduler::runPending()
+{
+	unsigned own = t_scheduler == this ? t_index : m_nextQueue % m_queues.size();
+	Task t;
+	bool stolen;
+	if (!take(own, t, stolen))
+	{
+		DEV_GUARDED(x_sleep)
+			releaseDue();
+		if (!take(own, t, stolen))
+			return false;
+	}
+	run(t, false);
+	return true;
+}
+
+void TaskScheduler::parallelFor(size_t _n, function<void(size_t)> const& _f, unsigned _threads)
+{
+	size_t threads = min<size_t>(_threads ? _threads : m_threads.size(), _n);
+	if (threads <= 1)
+	{
+		for (size_t i = 0; i < _n; ++i)
+			_f(i);
+		return;
+	}
+
+	// Helpers may start after we have returned, so what they touch lives as long as they do.
+	struct Loop
+	{
+		function<void(size_t)> const* f;
+		size_t n;
+		atomic<size_t> next{0};
+		atomic<size_t> running{0};		///< Threads between claiming their first index and leaving.
+		vector<exception_ptr> errors;
+	};
+	auto loop = make_shared<Loop>();
+	loop->f = &_f;
+	loop->n = _n;
+	loop->errors.resize(threads);
+	auto body = [](Loop& _l, size_t _t)
+	{
+		++_l.running;
+		try
+		{
+			// Once next has passed n, which it does before the caller stops waiting, no index is
+			// claimed; so a latecomer never calls f.
+			for (size_t i = _l.next++; i < _l.n; i = _l.next++)
+				(*_l.f)(i);
+		}
+		catch (...)
+		{
+			_l.errors[_t] = current_exception();
+			_l.next = _l.n;
+		}
+		--_l.running;
+	};
+	for (size_t t = 1; t < threads; ++t)
+		submit([loop, body, t]() { body(*loop, t); }, TaskPriority::High);
+	body(*loop, 0);
+	// All indices are taken; wait for those still being run, and for nothing else.
+	while (loop->running)
+		this_thread::yield();
+	for (auto const& e: loop->errors)
+		if (e)
+			rethrow_exception(e);
+}
+
+TaskScheduler::Stats TaskScheduler::stats() const
+{
+	Stats ret;
+	ret.threads = threads();
+	ret.tasks = m_tasks;
+	ret.steals = m_steals;
+	double lifetime = chrono::duration<double, nano>(Clock::now() - m_started).count() * ret.threads;
+	ret.utilisation = lifetime > 0 ? m_busyNs / lifetime : 0;
+	return ret;
+}
+
+void PooledWorker::startWorking()
+{
+	DEV_GUARDED(x_work)
+	{
+		if (m_state != State::Stopped)
+			return;
+		m_state = State::Started;
+	}
+	TaskScheduler::get().submit([this]() { tick(true); });
+}
+
+void PooledWorker::stopWorking()
+{
+	DEV_GUARDED(x_work)
+	{
+		if (m_state == State::Stopped)
+			return;
+		m_state = State::Stopping;
+	}
+	// The last run may be waiting for this very thread, so help out until it is done.
+	while (true)
+	{
+		DEV_GUARDED(x_work)
+			if (m_state == State::Stopped)
+				return;
+		if (!TaskScheduler::get().runPending())
+			this_thread::sleep_for(chrono::milliseconds(1));
+	}
+}
+
+void PooledWorker::tick(bool _first)
+{
+	bool stopping;
+	DEV_GUARDED(x_work)
+		stopping = m_state != State::Started;
+	if (stopping)
+	{
+		if (!_first)
+			doneWorking();
+		DEV_GUARDED(x_work)
+			m_state = State::Stopped;
+		return;
+	}
+
+	try
+	{
+		if (_first)
+			startedWorking();
+		doWork();
+	}
+	catch (std::exception const& _e)
+	{
+		clog(WarnChannel) << "Exception thrown in" << m_name << ":" << _e.what();
+	}
+	TaskScheduler::get().submitAfter(chrono::milliseconds(m_idleWaitMs), [this]() { tick(false); });
+}
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Guards.h"
+
+namespace dev
+{
+
+enum class TaskPriority
+{
+	High,		///< Latency-critical: parallel loops others are waiting on.
+	Normal,
+	Low			///< Background upkeep.
+};
+
+/**
+ * @brief Work-stealing thread pool.
+ *
+ * Each pool thread has a deque of tasks per priority. A task submitted from a pool thread goes to the
+ * back of that thread's own deque and is taken back from there (last in, first out, while its data is
+ * still in cache); tasks from other threads are dealt round-robin. A thread with nothing left of a
+ * priority steals from the front of the others' deques before looking at a lower priority. Delayed
+ * tasks wait in a timer heap that idle threads watch, so recurring work needs no thread of its own.
+ *
+ * get() is the process-wide pool, with a thread per hardware thread.
+ */
+class TaskScheduler
+{
+public:
+	using Task = std::function<void()>;
+	using Clock = std::chrono::steady_clock;
+
+	struct Stats
+	{
+		unsigned threads = 0;
+		uint64_t tasks = 0;			///< Tasks run, by pool threads or by helping callers.
+		uint64_t steals = 0;		///< Tasks a pool thread took from another's deque.
+		double utilisation = 0;		///< Time the pool threads spent running tasks, as a fraction of their lifetime.
+	};
+
+	/// The process-wide scheduler.
+	static TaskScheduler& get();
+
+	/// Starts @a _threads threads (0: one per hardware thread).
+	explicit TaskScheduler(unsigned _threads = 0);
+	/// Runs what is already queued, then joins the threads. Delayed tasks not yet due are dropped.
+	~TaskScheduler();
+
+	void submit(Task _t, TaskPriority _p = TaskPriority::Normal);
+	/// Submits @a _t once @a _delay has passed.
+	void submitAfter(std::chrono::milliseconds _delay, Task _t, TaskPriority _p = TaskPriority::Normal);
+
+	/// Calls @a _f(i) for every i in [0, _n) on up to @a _threads threads (0: all of the pool), the
+	/// calling thread included, and returns once all calls are done. Indices are handed out one at a time,
+	/// so uneven work balances itself. The first exception thrown by @a _f is rethrown here. The caller
+	/// only ever runs indices of this loop, and waits only for helpers that are mid-call: one that starts
+	/// after the last index was taken does nothing, so this can be nested in pool tasks without deadlock.
+	void parallelFor(size_t _n, std::function<void(size_t)> const& _f, unsigned _threads = 0);
+
+	/// Runs one queued task on the calling thread. @returns false if there was none.
+	bool runPending();
+
+	unsigned threads() const { return (unsigned)m_threads.size(); }
+	Stats stats() const;
+
+private:
+	static const unsigned c_priorities = 3;
+
+	struct Queue
+	{
+		Mutex x_tasks;
+		std::deque<Task> tasks[c_priorities];
+	};
+
+	struct Delayed
+	{
+		Clock::time_point due;
+		uint64_t order;
+		TaskPriority priority;
+		Task task;
+		bool operator<(Delayed const& _d) const { return due != _d.due ? due > _d.due : order > _d.order; }
+	};
+
+	/// Queues @a _t, without waking anyone.
+	void push(Task&& _t, TaskPriority _p);
+	/// Takes the most urgent task, from queue @a _own first, then from the others. @returns false if there is none.
+	bool take(unsigned _own, Task& o_task, bool& o_stolen);
+	/// Runs @a _t, keeping the counts; exceptions are logged, not propagated.
+	void run(Task& _t, bool _poolThread);
+	void threadBody(unsigned _index);
+	/// Queues the delayed tasks that are due. @returns when the next one will be. Call with x_sleep held.
+	Clock::time_point releaseDue();
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_threads;
+	std::atomic<unsigned> m_nextQueue{0};
+	std::atomic<size_t> m_pending{0};
+	std::atomic<bool> m_stopping{false};
+
+	Mutex x_sleep;
+	std::condition_variable m_wake;
+	unsigned m_sleeping = 0;							///< Guarded by x_sleep.
+	std::priority_queue<Delayed> m_delayed;				///< Guarded by x_sleep.
+	uint64_t m_delayedCount = 0;						///< Guarded by x_sleep.
+
+	Clock::time_point m_started;
+	std::atomic<uint64_t> m_tasks{0};
+	std::atomic<uint64_t> m_steals{0};
+	std::atomic<uint64_t> m_busyNs{0};
+};
+
+/**
+ * @brief Worker whose doWork() runs as a recurring task on the TaskScheduler instead of on a thread of its own.
+ *
+ * Interface and call order are those of Worker: startedWorking(), then doWork() every m_idleWaitMs
+ * until stopWorking(), then doneWorking(). doWork() never runs concurrently with itself, but not
+ * always on the same thread, and it should not block: anything that loops or waits belongs on a Worker.
+ */
+class PooledWorker
+{
+protected:
+	PooledWorker(std::string const& _name = "anon", unsigned _idleWaitMs = 30): m_name(_name), m_idleWaitMs(_idleWaitMs) {}
+	virtual ~PooledWorker() { stopWorking(); }
+
+	/// Schedules the first run; causes startedWorking() to be called.
+	void startWorking();
+	/// Stops scheduling runs and waits for one in flight; causes doneWorking() to be called. Not to be called from doWork().
+	void stopWorking();
+	bool isWorking() const { Guard l(x_work); return m_state == State::Started; }
+
+	virtual void startedWorking() {}
+	virtual void doWork() {}
+	virtual void doneWorking() {}
+
+private:
+	enum class State { Stopped, Started, Stopping };
+
+	/// One scheduled run.
+	void tick(bool _first);
+
+	std::string m_name;
+	unsigned m_idleWaitMs;
+	mutable Mutex x_work;
+	State m_state = State::Stopped;				///< Guarded by x_work.
+};
+
+}
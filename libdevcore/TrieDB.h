@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <memory>
 #include "db.h"
 #include "Common.h"
@@ -7,6 +9,9 @@
 #include "Exceptions.h"
 #include "SHA3.h"
 #include "MemoryDB.h"
+#include "NodeRef.h"
+#include "ParallelFor.h"
+#include "TrieJournalDB.h"
 #include "TrieCommon.h"
 
 namespace dev
@@ -19,6 +24,9 @@ struct InvalidTrie: virtual dev::Exception {};
 extern const h256 c_shaNull;
 extern const h256 EmptyTrie;
 
+/// Changes to apply to a trie in one go: key and new value, an empty value meaning removal.
+using TrieChanges = std::vector<std::pair<bytes, bytes>>;
+
 enum class Verification {
 	Skip,
 	Normal
@@ -42,9 +50,14 @@ enum class Verification {
 template <class _DB>
 class GenericTrieDB
 {
+	template <class> friend class GenericTrieDB;
+
 public:
 	using DB = _DB;
 
+	/// Batches smaller than this are applied one change at a time.
+	static const size_t c_minParallelBatch = 256;
+
 	explicit GenericTrieDB(DB* _db = nullptr): m_db(_db) {}
 	GenericTrieDB(DB* _db, h256 const& _root, Verification _v = Verification::Normal) { open(_db, _root, _v); }
 	~GenericTrieDB() {}
@@ -52,7 +65,7 @@ public:
 	void open(DB* _db) { m_db = _db; }
 	void open(DB* _db, h256 const& _root, Verification _v = Verification::Normal) { m_db = _db; setRoot(_root, _v); }
 
-	void init() { setRoot(forceInsertNode(&RLPNull)); assert(node(m_root).size()); }
+	void init() { setRoot(forceInsertNode(&RLPNull)); assert(nodeRef(m_root).size()); }
 
 	void setRoot(h256 const& _root, Verification _v = Verification::Normal)
 	{
@@ -66,27 +79,36 @@ public:
 #if ETH_DEBUG
 		if (_v == Verification::Normal)
 #endif
-			if (!node(m_root).size())
+			if (!nodeRef(m_root).size())
 				BOOST_THROW_EXCEPTION(RootNotFound());
 	}
 
 	/// True if the trie is uninitialised (i.e. that the DB doesn't contain the root node).
-	bool isNull() const { return !node(m_root).size(); }
+	bool isNull() const { return !nodeRef(m_root).size(); }
 	/// True if the trie is initialised but empty (i.e. that the DB contains the root node which is empty).
-	bool isEmpty() const { return m_root == c_shaNull && node(m_root).size(); }
+	bool isEmpty() const { return m_root == c_shaNull && nodeRef(m_root).size(); }
 
-	h256 const& root() const { if (node(m_root).empty()) BOOST_THROW_EXCEPTION(BadRoot(m_root)); /*std::cout << "Returning root as " << ret << " (really " << m_root << ")" << std::endl;*/ return m_root; }	// patch the root in the case of the empty trie. TODO: handle this properly.
+	h256 const& root() const { if (nodeRef(m_root).empty()) BOOST_THROW_EXCEPTION(BadRoot(m_root)); /*std::cout << "Returning root as " << ret << " (really " << m_root << ")" << std::endl;*/ return m_root; }	// patch the root in the case of the empty trie. TODO: handle this properly.
 
 	std::string at(bytes const& _key) const { return at(&_key); }
 	std::string at(bytesConstRef _key) const;
+	/// at() without the copy: a view of the value that pins the node it lives in. Empty if not found.
+	NodeRef atRef(bytesConstRef _key) const;
 	void insert(bytes const& _key, bytes const& _value) { insert(&_key, &_value); }
 	void insert(bytesConstRef _key, bytes const& _value) { insert(_key, &_value); }
 	void insert(bytes const& _key, bytesConstRef _value) { insert(&_key, _value); }
 	void insert(bytesConstRef _key, bytesConstRef _value);
 	void remove(bytes const& _key) { remove(&_key); }
 	void remove(bytesConstRef _key);
-	bool contains(bytes const& _key) { return contains(&_key); }
-	bool contains(bytesConstRef _key) { return !at(_key).empty(); }
+
+	/// Applies @a _changes as if by insert() and remove() in key order, the last change to a key winning.
+	/// When the root is a branch, the changes are split by leading nibble and the subtries beneath the
+	/// root are updated on up to @a _threads threads (0: one per hardware thread), each in a journal;
+	/// the journals are then written to the database in order and the root assembled. The resulting
+	/// root is the same as the sequential one.
+	void insertBatch(TrieChanges _changes, unsigned _threads = 0);
+	bool contains(bytes const& _key) const { return contains(&_key); }
+	bool contains(bytesConstRef _key) const { return !atRef(_key).empty(); }
 
 	class iterator
 	{
@@ -111,9 +133,11 @@ public:
 		void next();
 		void next(NibbleSlice _key);
 
+		/// A node on the path to the current entry. Its rlp is pinned or owned (NodeRef::owned()), never
+		/// borrowed, since the iterator may outlive what a borrowed view was valid for.
 		struct Node
 		{
-			std::string rlp;
+			NodeRef rlp;
 			std::string key;		// as hexPrefixEncoding.
 			byte child;				// 255 -> entering, 16 -> actually at the node, 17 -> exiting, 0-15 -> actual children.
 
@@ -217,7 +241,12 @@ public:
 private:
 	RLPStream& streamNode(RLPStream& _s, bytes const& _b);
 
-	std::string atAux(RLP const& _here, NibbleSlice _key) const;
+	/// insertBatch() beneath the root branch @a _root; @a _changes are sorted and unique. @returns false,
+	/// having written nothing, if the root would no longer be a branch afterwards.
+	bool insertBranches(RLP const& _root, TrieChanges const& _changes, unsigned _threads);
+	/// Applies @a _changes[_begin, _end) (keys less their leading nibble) to the branch slot @a io_child,
+	/// exactly as mergeAt()/deleteAt() on the root would, through @a _trie's database.
+	template <class T> static void updateChild(T& _trie, bytes& io_child, TrieChanges const& _changes, size_t _begin, size_t _end);
 
 	void mergeAtAux(RLPStream& _out, RLP const& _replace, NibbleSlice _key, bytesConstRef _value);
 	bytes mergeAt(RLP const& _replace, NibbleSlice _k, bytesConstRef _v, bool _inLine = false);
@@ -265,8 +294,12 @@ private:
 
 	bool isTwoItemNode(RLP const& _n) const;
 	std::string deref(RLP const& _n) const;
+	/// deref() without the copy; an inline node shares the pin of @a _parent, the node it was found in.
+	NodeRef deref(RLP const& _n, NodeRef const& _parent) const;
 
 	std::string node(h256 const& _h) const { return m_db->lookup(_h); }
+	/// Read path: a pinned view instead of a copy (see the DB's lookupRef()).
+	NodeRef nodeRef(h256 const& _h) const { return m_db->lookupRef(_h); }
 
 	// These are low-level node insertion functions that just go straight through into the DB.
 	h256 forceInsertNode(bytesConstRef _v) { auto h = sha3(_v); forceInsertNode(h, _v); return h; }
@@ -309,6 +342,7 @@ public:
 
 	bool contains(KeyType _k) const { return Generic::contains(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
 	std::string at(KeyType _k) const { return Generic::at(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
+	NodeRef atRef(KeyType _k) const { return Generic::atRef(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
 	void insert(KeyType _k, bytesConstRef _value) { Generic::insert(bytesConstRef((byte const*)&_k, sizeof(KeyType)), _value); }
 	void insert(KeyType _k, bytes const& _value) { insert(_k, bytesConstRef(&_value)); }
 	void remove(KeyType _k) { Generic::remove(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
@@ -370,9 +404,17 @@ public:
 	using Super::debugStructure;
 
 	std::string at(bytesConstRef _key) const { return Super::at(sha3(_key)); }
-	bool contains(bytesConstRef _key) { return Super::contains(sha3(_key)); }
+	NodeRef atRef(bytesConstRef _key) const { return Super::atRef(sha3(_key)); }
+	bool contains(bytesConstRef _key) const { return Super::contains(sha3(_key)); }
 	void insert(bytesConstRef _key, bytesConstRef _value) { Super::insert(sha3(_key), _value); }
 	void remove(bytesConstRef _key) { Super::remove(sha3(_key)); }
+	/// Keys are hashed; see GenericTrieDB::insertBatch().
+	void insertBatch(TrieChanges _changes, unsigned _threads = 0)
+	{
+		for (auto& c: _changes)
+			c.first = sha3(c.first).asBytes();
+		Super::insertBatch(std::move(_changes), _threads);
+	}
 
 	// empty from the PoV of the iterator interface; still need a basic iterator impl though.
 	class iterator
@@ -421,7 +463,8 @@ public:
 	using Super::debugStructure;
 
 	std::string at(bytesConstRef _key) const { return Super::at(sha3(_key)); }
-	bool contains(bytesConstRef _key) { return Super::contains(sha3(_key)); }
+	NodeRef atRef(bytesConstRef _key) const { return Super::atRef(sha3(_key)); }
+	bool contains(bytesConstRef _key) const { return Super::contains(sha3(_key)); }
 	void insert(bytesConstRef _key, bytesConstRef _value)
 	{
 		h256 hash = sha3(_key);
@@ -430,6 +473,21 @@ public:
 	}
 
 	void remove(bytesConstRef _key) { Super::remove(sha3(_key)); }
+	/// Keys are hashed and recorded as aux entries, as with insert(); see GenericTrieDB::insertBatch().
+	void insertBatch(TrieChanges _changes, unsigned _threads = 0)
+	{
+		std::vector<std::pair<h256, bytes>> preimages;
+		for (auto& c: _changes)
+		{
+			h256 hash = sha3(c.first);
+			if (!c.second.empty())
+				preimages.push_back(std::make_pair(hash, c.first));
+			c.first = hash.asBytes();
+		}
+		Super::insertBatch(std::move(_changes), _threads);
+		for (auto const& p: preimages)
+			Super::db()->insertAux(p.first, &p.second);
+	}
 
 	// iterates over <key, value> pairs
 	class iterator: public GenericTrieDB<_DB>::iterator
@@ -476,6 +534,36 @@ public:
 
 template <class KeyType, class DB> using TrieDB = SpecificTrieDB<GenericTrieDB<DB>, KeyType>;
 
+/// Applies @a _changes[i] to the trie rooted at @a io_roots[i] for every i at once, updating the roots in
+/// place; for committing the storage tries of many accounts. Keys are as stored, i.e. already hashed for
+/// secure tries. Each trie is updated in its own journal on up to @a _threads threads (0: one per hardware
+/// thread) and the journals are then written to @a _db in order, so the result is as if the tries had
+/// been updated one after another.
+template <class DB> void insertBatches(DB& _db, h256s& io_roots, std::vector<TrieChanges> const& _changes, unsigned _threads = 0)
+{
+	assert(io_roots.size() == _changes.size());
+	if (resolveThreads(_threads) == 1)
+	{
+		for (size_t i = 0; i < io_roots.size(); ++i)
+		{
+			GenericTrieDB<DB> t(&_db, io_roots[i]);
+			t.insertBatch(_changes[i], 1);
+			io_roots[i] = t.root();
+		}
+		return;
+	}
+	std::vector<std::unique_ptr<TrieJournalDB<DB>>> journals(io_roots.size());
+	parallelFor(io_roots.size(), [&](size_t _i)
+	{
+		journals[_i].reset(new TrieJournalDB<DB>(_db));
+		GenericTrieDB<TrieJournalDB<DB>> t(journals[_i].get(), io_roots[_i]);
+		t.insertBatch(_changes[_i], 1);
+		io_roots[_i] = t.root();
+	}, _threads);
+	for (auto const& j: journals)
+		j->replay(_db);
+}
+
 }
 
 // Template implementations...
@@ -485,14 +573,14 @@ namespace dev
 template <class DB> GenericTrieDB<DB>::iterator::iterator(GenericTrieDB const* _db)
 {
 	m_that = _db;
-	m_trail.push_back({_db->node(_db->m_root), std::string(1, '\0'), 255});	// one null byte is the HPE for the empty key.
+	m_trail.push_back({_db->nodeRef(_db->m_root).owned(), std::string(1, '\0'), 255});	// one null byte is the HPE for the empty key.
 	next();
 }
 
 template <class DB> GenericTrieDB<DB>::iterator::iterator(GenericTrieDB const* _db, bytesConstRef _fullKey)
 {
 	m_that = _db;
-	m_trail.push_back({_db->node(_db->m_root), std::string(1, '\0'), 255});	// one null byte is the HPE for the empty key.
+	m_trail.push_back({_db->nodeRef(_db->m_root).owned(), std::string(1, '\0'), 255});	// one null byte is the HPE for the empty key.
 	next(_fullKey);
 }
 
@@ -503,7 +591,7 @@ template <class DB> typename GenericTrieDB<DB>::iterator::value_type GenericTrie
 	assert(b.key.size());
 	assert(!(b.key[0] & 0x10));	// should be an integer number of bytes (i.e. not an odd number of nibbles).
 
-	RLP rlp(b.rlp);
+	RLP rlp(b.rlp.data());
 	return std::make_pair(bytesConstRef(b.key).cropped(1), rlp[rlp.itemCount() == 2 ? 1 : 16].payload());
 }
 
@@ -519,7 +607,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next(NibbleSlice _key)
 		}
 
 		Node const& b = m_trail.back();
-		RLP rlp(b.rlp);
+		RLP rlp(b.rlp.data());
 
 		if (m_trail.back().child == 255)
 		{
@@ -535,7 +623,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next(NibbleSlice _key)
 			{
 #if ETH_PARANOIA
 				cwarn << "BIG FAT ERROR. STATE TRIE CORRUPTED!!!!!";
-				cwarn << b.rlp.size() << toHex(b.rlp);
+				cwarn << b.rlp.size() << toHex(b.rlp.data());
 				cwarn << rlp;
 				auto c = rlp.itemCount();
 				cwarn << c;
@@ -583,7 +671,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next(NibbleSlice _key)
 				}
 
 				// enter child.
-				m_trail.back().rlp = m_that->deref(rlp[1]);
+				m_trail.back().rlp = m_that->deref(rlp[1], b.rlp).owned();
 				// no need to set .child as 255 - it's already done.
 				continue;
 			}
@@ -633,7 +721,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next(NibbleSlice _key)
 					// fixed so that Node passed into push_back is constructed *before* m_trail is potentially resized (which invalidates back and rlp)
 					Node const& back = m_trail.back();
 					m_trail.push_back(Node{
-						m_that->deref(rlp[back.child]),
+						m_that->deref(rlp[back.child], back.rlp).owned(),
 						 hexPrefixEncode(keyOf(back.key), NibbleSlice(bytesConstRef(&back.child, 1), 1), false),
 						 255
 						});
@@ -656,7 +744,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next()
 		}
 
 		Node const& b = m_trail.back();
-		RLP rlp(b.rlp);
+		RLP rlp(b.rlp.data());
 
 		if (m_trail.back().child == 255)
 		{
@@ -670,7 +758,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next()
 			{
 #if ETH_PARANOIA
 				cwarn << "BIG FAT ERROR. STATE TRIE CORRUPTED!!!!!";
-				cwarn << b.rlp.size() << toHex(b.rlp);
+				cwarn << b.rlp.size() << toHex(b.rlp.data());
 				cwarn << rlp;
 				auto c = rlp.itemCount();
 				cwarn << c;
@@ -692,7 +780,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next()
 				}
 
 				// enter child.
-				m_trail.back().rlp = m_that->deref(rlp[1]);
+				m_trail.back().rlp = m_that->deref(rlp[1], b.rlp).owned();
 				// no need to set .child as 255 - it's already done.
 				continue;
 			}
@@ -734,7 +822,7 @@ template <class DB> void GenericTrieDB<DB>::iterator::next()
 					// fixed so that Node passed into push_back is constructed *before* m_trail is potentially resized (which invalidates back and rlp)
 					Node const& back = m_trail.back();
 					m_trail.push_back(Node{
-						m_that->deref(rlp[back.child]),
+						m_that->deref(rlp[back.child], back.rlp).owned(),
 						 hexPrefixEncode(keyOf(back.key), NibbleSlice(bytesConstRef(&back.child, 1), 1), false),
 						 255
 						});
@@ -774,38 +862,55 @@ template <class DB> void GenericTrieDB<DB>::insert(bytesConstRef _key, bytesCons
 
 template <class DB> std::string GenericTrieDB<DB>::at(bytesConstRef _key) const
 {
-	return atAux(RLP(node(m_root)), _key);
+	return atRef(_key).toString();
 }
 
-template <class DB> std::string GenericTrieDB<DB>::atAux(RLP const& _here, NibbleSlice _key) const
+template <class DB> NodeRef GenericTrieDB<DB>::atRef(bytesConstRef _key) const
 {
-	if (_here.isEmpty() || _here.isNull())
-		// not found.
-		return std::string();
-	unsigned itemCount = _here.itemCount();
-	assert(_here.isList() && (itemCount == 2 || itemCount == 17));
-	if (itemCount == 2)
+	// Only the node being looked at is held; each step swaps in the next one.
+	NodeRef n = nodeRef(m_root);
+	RLP here(n.data());
+	NibbleSlice key(_key);
+	while (true)
 	{
-		auto k = keyOf(_here);
-		if (_key == k && isLeaf(_here))
-			// reached leaf and it's us
-			return _here[1].toString();
-		else if (_key.contains(k) && !isLeaf(_here))
-			// not yet at leaf and it might yet be us. onwards...
-			return atAux(_here[1].isList() ? _here[1] : RLP(node(_here[1].toHash<h256>())), _key.mid(k.size()));
+		if (here.isEmpty() || here.isNull())
+			// not found.
+			return NodeRef();
+		unsigned itemCount = here.itemCount();
+		assert(here.isList() && (itemCount == 2 || itemCount == 17));
+		RLP next;
+		if (itemCount == 2)
+		{
+			auto k = keyOf(here);
+			if (key == k && isLeaf(here))
+				// reached leaf and it's us
+				return n.sub(here[1].payload());
+			else if (key.contains(k) && !isLeaf(here))
+			{
+				// not yet at leaf and it might yet be us. onwards...
+				next = here[1];
+				key = key.mid(k.size());
+			}
+			else
+				// not us.
+				return NodeRef();
+		}
 		else
-			// not us.
-			return std::string();
-	}
-	else
-	{
-		if (_key.size() == 0)
-			return _here[16].toString();
-		auto n = _here[_key[0]];
-		if (n.isEmpty())
-			return std::string();
+		{
+			if (key.size() == 0)
+				return n.sub(here[16].payload());
+			next = here[key[0]];
+			if (next.isEmpty())
+				return NodeRef();
+			key = key.mid(1);
+		}
+		if (next.isList())
+			here = next;
 		else
-			return atAux(n.isList() ? n : RLP(node(n.toHash<h256>())), _key.mid(1));
+		{
+			n = nodeRef(next.toHash<h256>());
+			here = RLP(n.data());
+		}
 	}
 }
 
@@ -925,9 +1030,132 @@ template <class DB> void GenericTrieDB<DB>::remove(bytesConstRef _key)
 	}
 }
 
+template <class DB> void GenericTrieDB<DB>::insertBatch(TrieChanges _changes, unsigned _threads)
+{
+	// Key order, and only the last change to each key.
+	std::stable_sort(_changes.begin(), _changes.end(), [](std::pair<bytes, bytes> const& _a, std::pair<bytes, bytes> const& _b) { return _a.first < _b.first; });
+	size_t n = 0;
+	for (size_t i = 0; i < _changes.size(); ++i)
+		if (i + 1 == _changes.size() || _changes[i].first != _changes[i + 1].first)
+		{
+			if (n != i)
+				_changes[n] = std::move(_changes[i]);
+			++n;
+		}
+	_changes.resize(n);
+
+	if (_changes.size() >= c_minParallelBatch && !_changes.front().first.empty())
+	{
+		NodeRef root = nodeRef(m_root);
+		RLP r(root.data());
+		if (r.isList() && r.itemCount() == 17 && insertBranches(r, _changes, _threads))
+			return;
+	}
+	for (auto const& c: _changes)
+		if (c.second.empty())
+			remove(&c.first);
+		else
+			insert(&c.first, &c.second);
+}
+
+template <class DB> bool GenericTrieDB<DB>::insertBranches(RLP const& _root, TrieChanges const& _changes, unsigned _threads)
+{
+	// _changes[begin[i]] .. _changes[begin[i + 1]] go beneath child i.
+	std::array<size_t, 17> begin;
+	size_t c = 0;
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		begin[i] = c;
+		while (c < _changes.size() && (_changes[c].first[0] >> 4) == i)
+			++c;
+	}
+	begin[16] = c;
+	std::vector<unsigned> touched;
+	for (unsigned i = 0; i < 16; ++i)
+		if (begin[i + 1] > begin[i])
+			touched.push_back(i);
+
+	// Copied out, since _root may point into the database.
+	std::vector<bytes> children(16);
+	for (unsigned i = 0; i < 16; ++i)
+		children[i] = _root[i].data().toBytes();
+	bytes value = _root[16].data().toBytes();
+	bytes old = _root.data().toBytes();
+
+	bool removals = false;
+	for (auto const& c: _changes)
+		removals = removals || c.second.empty();
+	if (resolveThreads(_threads) == 1 && !removals)
+	{
+		// Nothing to parallelise and, with no removals, no way for the root to collapse: go straight to the
+		// database and just save rehashing the root for every change.
+		for (unsigned i: touched)
+			updateChild(*this, children[i], _changes, begin[i], begin[i + 1]);
+		RLPStream r(17);
+		for (auto const& i: children)
+			r.appendRaw(i);
+		r.appendRaw(value);
+		bytes b = r.out();
+		forceKillNode(m_root);
+		m_root = forceInsertNode(&b);
+		return true;
+	}
+
+	// Each touched child is updated in a journal of its own.
+	std::vector<std::unique_ptr<TrieJournalDB<DB>>> journals(16);
+	parallelFor(touched.size(), [&](size_t _t)
+	{
+		unsigned i = touched[_t];
+		journals[i].reset(new TrieJournalDB<DB>(*m_db));
+		GenericTrieDB<TrieJournalDB<DB>> sub(journals[i].get());
+		updateChild(sub, children[i], _changes, begin[i], begin[i + 1]);
+	}, _threads);
+
+	unsigned used = RLP(value).isEmpty() ? 0 : 1;
+	for (auto const& i: children)
+		if (!RLP(i).isEmpty())
+			++used;
+	if (used < 2)
+		// The root would have to be merged into its only child.
+		return false;
+
+	RLPStream r(17);
+	for (auto const& i: children)
+		r.appendRaw(i);
+	r.appendRaw(value);
+	bytes b = r.out();
+	bool changed = b != old;
+
+	for (unsigned i: touched)
+		journals[i]->replay(*m_db);
+	if (changed)
+	{
+		forceKillNode(m_root);
+		m_root = forceInsertNode(&b);
+	}
+	return true;
+}
+
+template <class DB> template <class T> void GenericTrieDB<DB>::updateChild(T& _trie, bytes& io_child, TrieChanges const& _changes, size_t _begin, size_t _end)
+{
+	for (size_t j = _begin; j < _end; ++j)
+	{
+		NibbleSlice k = NibbleSlice(&_changes[j].first).mid(1);
+		RLPStream s;
+		if (_changes[j].second.empty())
+		{
+			if (!_trie.deleteAtAux(s, RLP(io_child), k))
+				continue;
+		}
+		else
+			_trie.mergeAtAux(s, RLP(io_child), k, &_changes[j].second);
+		io_child = s.out();
+	}
+}
+
 template <class DB> bool GenericTrieDB<DB>::isTwoItemNode(RLP const& _n) const
 {
-	return (_n.isData() && RLP(node(_n.toHash<h256>())).itemCount() == 2)
+	return (_n.isData() && RLP(nodeRef(_n.toHash<h256>()).data()).itemCount() == 2)
 			|| (_n.isList() && _n.itemCount() == 2);
 }
 
@@ -936,6 +1164,11 @@ template <class DB> std::string GenericTrieDB<DB>::deref(RLP const& _n) const
 	return _n.isList() ? _n.data().toString() : node(_n.toHash<h256>());
 }
 
+template <class DB> NodeRef GenericTrieDB<DB>::deref(RLP const& _n, NodeRef const& _parent) const
+{
+	return _n.isList() ? _parent.sub(_n.data()) : nodeRef(_n.toHash<h256>());
+}
+
 template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSlice _k)
 {
 #if ETH_PARANOIA
@@ -158,21 +158,254 @@ h256 hash256(BytesMap const& _s)
 
 h256 orderedTrieRoot(std::vector<bytes> const& _data)
 {
-	BytesMap m;
-	unsigned j = 0;
-	for (auto i: _data)
-		m[rlp(j++)] = i;
-	return hash256(m);
+	OrderedTrieBuilder b;
+	OrderedTrieBuilder::forEachIndexInKeyOrder(_data.size(), [&](unsigned i) { b.insert(i, &_data[i]); });
+	return b.root();
 }
 
 h256 orderedTrieRoot(std::vector<bytesConstRef> const& _data)
 {
-	BytesMap m;
-	unsigned j = 0;
-	for (auto i: _data)
-		m[rlp(j++)] = i.toBytes();
-	return hash256(m);
+	OrderedTrieBuilder b;
+	OrderedTrieBuilder::forEachIndexInKeyOrder(_data.size(), [&](unsigned i) { b.insert(i, _data[i]); });
+	return b.root();
 }
+
+namespace
+{
+
+void appendRLPHeader(bytes& o_out, size_t _length, byte _base)
+{
+	if (_length < 56)
+		o_out.push_back(byte(_base + _length));
+	else
+	{
+		unsigned n = bytesRequired(_length);
+		o_out.push_back(byte(_base + 55 + n));
+		while (n--)
+			o_out.push_back(byte(_length >> (n * 8)));
+	}
+}
+
+size_t rlpItemSize(bytesConstRef _s)
+{
+	if (_s.size() == 1 && _s[0] < 0x80)
+		return 1;
+	return _s.size() + (_s.size() < 56 ? 1 : 1 + bytesRequired(_s.size()));
+}
+
+void appendRLPItem(bytes& o_out, bytesConstRef _s)
+{
+	if (_s.size() != 1 || _s[0] >= 0x80)
+		appendRLPHeader(o_out, _s.size(), 0x80);
+	o_out.insert(o_out.end(), _s.begin(), _s.end());
+}
+
+/// What a parent holds for the node encoded as @a _node: the node itself if it is short, else its hash.
+size_t nodeRefSize(bytesConstRef _node)
+{
+	return _node.size() < 32 ? _node.size() : 33;
+}
+
+void appendNodeRef(bytes& o_out, bytesConstRef _node)
+{
+	if (_node.size() < 32)
+		o_out.insert(o_out.end(), _node.begin(), _node.end());
+	else
+	{
+		h256 h = sha3(_node);
+		o_out.push_back(0x80 + 32);
+		o_out.insert(o_out.end(), h.data(), h.data() + h.size);
+	}
+}
+
+void writeHexPrefix(bytes& o_out, bytes const& _nibbles, unsigned _begin, unsigned _end, bool _leaf)
+{
+	bool odd = (_end - _begin) & 1;
+	o_out.clear();
+	o_out.push_back(byte(((_leaf ? 2 : 0) + (odd ? 1 : 0)) << 4));
+	if (odd)
+		o_out.back() |= _nibbles[_begin++];
+	for (; _begin < _end; _begin += 2)
+		o_out.push_back(byte(_nibbles[_begin] << 4 | _nibbles[_begin + 1]));
+}
+
+}
+
+void OrderedTrieBuilder::insert(bytesConstRef _key, bytesConstRef _value)
+{
+	if (m_pending != Pending::None)
+	{
+		unsigned keyNibbles = _key.size() * 2;
+		unsigned shared = 0;
+		for (unsigned n = std::min<unsigned>(m_key.size(), keyNibbles); shared < n && m_key[shared] == nibble(_key, shared); ++shared) {}
+		assert(shared < m_key.size() && shared < keyNibbles && m_key[shared] < nibble(_key, shared));
+
+		// Whatever branches off below the shared part is complete.
+		while (m_open && m_stack[m_open - 1].depth > shared)
+		{
+			attachPending();
+			closeInnermost();
+		}
+		if (!m_open || m_stack[m_open - 1].depth < shared)
+		{
+			if (m_stack.size() == m_open)
+				m_stack.emplace_back();
+			m_stack[m_open++].depth = shared;
+		}
+		attachPending();
+	}
+
+	m_key.resize(_key.size() * 2);
+	for (unsigned i = 0; i < m_key.size(); ++i)
+		m_key[i] = nibble(_key, i);
+	m_value.assign(_value.begin(), _value.end());
+	m_pending = Pending::Leaf;
+}
+
+void OrderedTrieBuilder::insert(unsigned _index, bytesConstRef _value)
+{
+	byte key[1 + sizeof(unsigned)];
+	size_t size = 1;
+	if (!_index)
+		key[0] = 0x80;
+	else if (_index < 0x80)
+		key[0] = byte(_index);
+	else
+	{
+		unsigned n = bytesRequired(_index);
+		key[0] = byte(0x80 + n);
+		while (n--)
+			key[size++] = byte(_index >> (n * 8));
+	}
+	insert(bytesConstRef(key, size), _value);
+}
+
+h256 OrderedTrieBuilder::root()
+{
+	if (m_pending == Pending::None)
+		return EmptyTrie;
+	while (m_open)
+	{
+		attachPending();
+		closeInnermost();
+	}
+	h256 ret = sha3(encodePending(0));
+	clear();
+	return ret;
+}
+
+void OrderedTrieBuilder::clear()
+{
+	for (; m_open; --m_open)
+	{
+		for (auto& c: m_stack[m_open - 1].children)
+			c.clear();
+		m_stack[m_open - 1].unhashed = 0;
+	}
+	m_key.clear();
+	m_pending = Pending::None;
+}
+
+bytesConstRef OrderedTrieBuilder::encodePending(unsigned _depth)
+{
+	if (m_pending == Pending::Branch && m_branchDepth == _depth)
+		return &m_branch;
+
+	// A leaf, or an extension leading to the pending branch.
+	bool leaf = m_pending == Pending::Leaf;
+	writeHexPrefix(m_hexPrefix, m_key, _depth, leaf ? m_key.size() : m_branchDepth, leaf);
+	m_node.clear();
+	appendRLPHeader(m_node, rlpItemSize(&m_hexPrefix) + (leaf ? rlpItemSize(&m_value) : nodeRefSize(&m_branch)), 0xc0);
+	appendRLPItem(m_node, &m_hexPrefix);
+	if (leaf)
+		appendRLPItem(m_node, &m_value);
+	else
+		appendNodeRef(m_node, &m_branch);
+	return &m_node;
+}
+
+void OrderedTrieBuilder::attachPending()
+{
+	Open& b = m_stack[m_open - 1];
+	byte i = m_key[b.depth];
+	bytesConstRef node = encodePending(b.depth + 1);
+	b.children[i].assign(node.begin(), node.end());
+	if (node.size() >= 32)
+		b.unhashed |= 1 << i;
+	m_pending = Pending::None;
+}
+
+void OrderedTrieBuilder::closeInnermost()
+{
+	Open& b = m_stack[--m_open];
+	if (b.unhashed)
+	{
+		bytesConstRef nodes[16];
+		h256 hashes[16];
+		byte which[16];
+		unsigned n = 0;
+		for (byte i = 0; i < 16; ++i)
+			if (b.unhashed & (1 << i))
+			{
+				nodes[n] = &b.children[i];
+				which[n++] = i;
+			}
+		sha3Batch(nodes, n, hashes);
+		for (unsigned j = 0; j < n; ++j)
+		{
+			bytes& c = b.children[which[j]];
+			c.resize(33);
+			c[0] = 0x80 + 32;
+			memcpy(c.data() + 1, hashes[j].data(), 32);
+		}
+		b.unhashed = 0;
+	}
+
+	size_t size = 1;
+	for (auto const& c: b.children)
+		size += c.empty() ? 1 : c.size();
+
+	// Keys being prefix-free, branches never carry a value.
+	m_branch.clear();
+	appendRLPHeader(m_branch, size, 0xc0);
+	for (auto& c: b.children)
+	{
+		if (c.empty())
+			m_branch.push_back(0x80);
+		else
+			m_branch.insert(m_branch.end(), c.begin(), c.end());
+		c.clear();
+	}
+	m_branch.push_back(0x80);
+	m_branchDepth = b.depth;
+	m_pending = Pending::Branch;
+}
+
+void OrderedTrieAppender::append(bytesConstRef _value)
+{
+	if (!m_size)
+		m_first = _value.toBytes();
+	else
+	{
+		if (m_size == 128)
+		{
+			m_builder.insert(0, &m_first);
+			m_first = bytes();
+		}
+		m_builder.insert(m_size, _value);
+	}
+	++m_size;
+}
+
+h256 OrderedTrieAppender::root() const
+{
+	// The builder holds at most one open branch per key nibble, so finishing a copy is cheap.
+	OrderedTrieBuilder b = m_builder;
+	if (m_size && m_size <= 128)
+		b.insert(0, &m_first);
+	return b.root();
+}
+
 }
 
 #endif // ETH_EMSCRIPTEN
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include "Common.h"
 #include "FixedHash.h"
 
@@ -20,6 +22,83 @@ template <class T, class U> inline h256 trieRootOver(unsigned _itemCount, T cons
 }
 
 h256 orderedTrieRoot(std::vector<bytesConstRef> const& _data);
-h256 orderedTrieRoot(std::vector<bytes> const& _data);
+
+/**
+ * @brief Computes a trie root from entries given in ascending key order, without building the trie.
+ *
+ * A node is encoded and hashed as soon as no later key can fall below it, so at most one open branch per
+ * key nibble is held, and the encoding buffers are reused from node to node. Keys must be strictly
+ * ascending and none may be a prefix of another, as is the case for RLP-encoded indices.
+ */
+class OrderedTrieBuilder
+{
+public:
+	void insert(bytesConstRef _key, bytesConstRef _value);
+	/// Inserts the entry keyed by rlp(@a _index).
+	void insert(unsigned _index, bytesConstRef _value);
+
+	/// @returns the root of what was inserted and makes the builder ready for a new trie.
+	h256 root();
+	void clear();
+
+	/// Calls @a _f for each index in [0, _count) in the order of the RLP-encoded keys: 1...127, 0, 128...
+	template <class F> static void forEachIndexInKeyOrder(unsigned _count, F const& _f)
+	{
+		for (unsigned i = 1; i < std::min(_count, 128u); ++i)
+			_f(i);
+		if (_count)
+			_f(0);
+		for (unsigned i = 128; i < _count; ++i)
+			_f(i);
+	}
+
+private:
+	enum class Pending { None, Leaf, Branch };
+
+	/// A branch some of whose children are yet to come.
+	struct Open
+	{
+		unsigned depth;
+		std::array<bytes, 16> children;		///< Child references as RLP items, or nodes yet to be hashed; empty if none.
+		uint16_t unhashed = 0;				///< Children that are whole nodes, hashed together when the branch closes.
+	};
+
+	/// Encodes the pending node as it appears below the branch at nibble @a _depth - 1; @returns the encoding.
+	bytesConstRef encodePending(unsigned _depth);
+	/// Hangs the pending node off the innermost open branch.
+	void attachPending();
+	/// Encodes the innermost open branch, which becomes the pending node.
+	void closeInnermost();
+
+	std::vector<Open> m_stack;			///< Open branches, outermost first; only the first m_open are in use.
+	unsigned m_open = 0;
+	bytes m_key;						///< Nibbles of the last key inserted.
+	Pending m_pending = Pending::None;	///< What lies below the last key and is not yet attached.
+	bytes m_value;						///< Value of the pending leaf.
+	unsigned m_branchDepth = 0;			///< Depth of the pending branch.
+	bytes m_branch;						///< Encoding of the pending branch.
+	bytes m_node;						///< Scratch for the node being encoded.
+	bytes m_hexPrefix;					///< Scratch for its hex-prefix encoded key.
+};
+
+/**
+ * @brief Root of an index-keyed trie (rlp(i) -> value) kept up to date as values are appended in index order.
+ *
+ * Values are hashed as they arrive, except that of index 0, which sorts between 127 and 128 and so waits
+ * for 128. root() then only has to finish the path of the last key, and more may be appended afterwards.
+ */
+class OrderedTrieAppender
+{
+public:
+	void append(bytesConstRef _value);
+	unsigned size() const { return m_size; }
+	h256 root() const;
+	void clear() { m_builder.clear(); m_first.clear(); m_size = 0; }
+
+private:
+	OrderedTrieBuilder m_builder;
+	bytes m_first;						///< Value at index 0, until it is due.
+	unsigned m_size = 0;
+};
 
 }
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "Common.h"
+#include "FixedHash.h"
+#include "NodeRef.h"
+
+namespace dev
+{
+
+/**
+ * @brief Private write journal over a shared node store, for tries updated off the main thread.
+ *
+ * Reads fall through to the base store, which must not be written to while journals over it are in use;
+ * inserts and kills are recorded and later replayed, in order, with replay(). Several journals over the
+ * same base may thus be worked on concurrently as long as they are replayed one at a time.
+ */
+template <class DB>
+class TrieJournalDB
+{
+public:
+	explicit TrieJournalDB(DB const& _base): m_base(_base) {}
+
+	std::string lookup(h256 const& _h) const
+	{
+		auto it = m_nodes.find(_h);
+		return it != m_nodes.end() ? it->second : m_base.lookup(_h);
+	}
+	/// Nodes of this journal are borrowed; they live as long as the journal.
+	NodeRef lookupRef(h256 const& _h) const
+	{
+		auto it = m_nodes.find(_h);
+		return it != m_nodes.end() ? NodeRef(bytesConstRef(&it->second)) : m_base.lookupRef(_h);
+	}
+	bool exists(h256 const& _h) const { return m_nodes.count(_h) || m_base.exists(_h); }
+
+	void insert(h256 const& _h, bytesConstRef _v)
+	{
+		// Content-addressed: the first copy will do for every later insert of the same hash.
+		m_nodes.emplace(_h, _v.toString());
+		m_ops.push_back(std::make_pair(_h, true));
+	}
+	bool kill(h256 const& _h) { m_ops.push_back(std::make_pair(_h, false)); return true; }
+
+	/// Applies the recorded inserts and kills to @a _db.
+	template <class Target> void replay(Target& _db) const
+	{
+		for (auto const& o: m_ops)
+			if (o.second)
+				_db.insert(o.first, bytesConstRef(&m_nodes.at(o.first)));
+			else
+				_db.kill(o.first);
+	}
+
+	size_t size() const { return m_ops.size(); }
+
+private:
+	DB const& m_base;
+	std::unordered_map<h256, std::string> m_nodes;
+	std::vector<std::pair<h256, bool>> m_ops;		///< Hash and true for an insert, false for a kill.
+};
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "Common.h"
+#include "FixedHash.h"
+#include "TrieCommon.h"
+#include "TrieDB.h"
+
+namespace dev
+{
+
+/**
+ * @brief Walks the paths to a set of keys breadth-first, resolving each trie level with one batched read.
+ *
+ * GenericTrieDB fetches nodes one by one as it descends, so a cold trie costs one random read per node per
+ * key, strictly in sequence. Running the prefetcher over the keys a block is about to touch turns that into
+ * a handful of DB::lookupMany() calls (one per depth) and leaves the nodes in the DB's cache.
+ *
+ * DB must provide `std::vector<std::string> lookupMany(h256s const&) const` (e.g. OverlayDB).
+ * Keys are taken as is; hash them first for secure tries.
+ */
+template <class DB>
+class TriePrefetcher
+{
+public:
+	explicit TriePrefetcher(DB const* _db): m_db(_db) {}
+
+	/// Resolves every node on the way to each of @a _keys in the trie rooted at @a _root.
+	/// @returns the value stored under each key, or an empty string where there is none.
+	std::vector<std::string> prefetch(h256 const& _root, std::vector<bytes> const& _keys);
+
+	/// Number of batched reads and nodes requested by the last prefetch().
+	unsigned batches() const { return m_batches; }
+	unsigned nodes() const { return m_nodes; }
+
+private:
+	using Frontier = std::unordered_map<h256, std::vector<std::pair<size_t, NibbleSlice>>>;
+
+	void descend(RLP const& _node, size_t _key, NibbleSlice _rest, std::vector<std::string>& o_values, Frontier& o_next) const;
+	void follow(RLP const& _child, size_t _key, NibbleSlice _rest, std::vector<std::string>& o_values, Frontier& o_next) const;
+
+	DB const* m_db;
+	unsigned m_batches = 0;
+	unsigned m_nodes = 0;
+};
+
+template <class DB> std::vector<std::string> TriePrefetcher<DB>::prefetch(h256 const& _root, std::vector<bytes> const& _keys)
+{
+	std::vector<std::string> ret(_keys.size());
+	m_batches = m_nodes = 0;
+	if (_root == EmptyTrie || _keys.empty())
+		return ret;
+
+	Frontier frontier;
+	for (size_t i = 0; i < _keys.size(); ++i)
+		frontier[_root].push_back(std::make_pair(i, NibbleSlice(bytesConstRef(&_keys[i]))));
+
+	while (!frontier.empty())
+	{
+		h256s hashes;
+		hashes.reserve(frontier.size());
+		for (auto const& i: frontier)
+			hashes.push_back(i.first);
+		std::vector<std::string> nodes = m_db->lookupMany(hashes);
+		++m_batches;
+		m_nodes += hashes.size();
+
+		Frontier next;
+		for (size_t i = 0; i < hashes.size(); ++i)
+			if (!nodes[i].empty())
+			{
+				RLP n(nodes[i]);
+				for (auto const& k: frontier[hashes[i]])
+					descend(n, k.first, k.second, ret, next);
+			}
+		frontier.swap(next);
+	}
+	return ret;
+}
+
+template <class DB> void TriePrefetcher<DB>::descend(RLP const& _node, size_t _key, NibbleSlice _rest, std::vector<std::string>& o_values, Frontier& o_next) const
+{
+	if (_node.isEmpty() || _node.isNull())
+		return;
+	unsigned itemCount = _node.itemCount();
+	if (itemCount == 2)
+	{
+		auto k = keyOf(_node);
+		if (isLeaf(_node))
+		{
+			if (_rest == k)
+				o_values[_key] = _node[1].toString();
+		}
+		else if (_rest.contains(k))
+			follow(_node[1], _key, _rest.mid(k.size()), o_values, o_next);
+	}
+	else if (itemCount == 17)
+	{
+		if (_rest.empty())
+			o_values[_key] = _node[16].toString();
+		else
+			follow(_node[_rest[0]], _key, _rest.mid(1), o_values, o_next);
+	}
+}
+
+template <class DB> void TriePrefetcher<DB>::follow(RLP const& _child, size_t _key, NibbleSlice _rest, std::vector<std::string>& o_values, Frontier& o_next) const
+{
+	if (_child.isEmpty())
+		return;
+	if (_child.isList())
+		// Small nodes are inlined in their parent; nothing to fetch.
+		descend(_child, _key, _rest, o_values, o_next);
+	else
+		o_next[_child.toHash<h256>()].push_back(std::make_pair(_key, _rest));
+}
+
+}
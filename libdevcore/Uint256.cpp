@@ -0,0 +1,250 @@
+#include "Uint256.h"
+#include <ostream>
+
+using namespace std;
+using namespace dev;
+
+namespace dev
+{
+
+namespace
+{
+
+using Backend = u256::backend_type;
+static_assert(sizeof(uint256) % sizeof(boost::multiprecision::limb_type) == 0, "u256 limbs must tile uint256");
+unsigned const c_backendLimbs = sizeof(uint256) / sizeof(boost::multiprecision::limb_type);
+
+inline unsigned significantLimbs(uint64_t const* _l, unsigned _n)
+{
+	while (_n && !_l[_n - 1])
+		--_n;
+	return _n;
+}
+
+/// (_hi * 2^64 + _lo) / _d, for _hi < _d so that the quotient fits; the remainder goes to @a o_r.
+/// The compiler would divide the 128-bit number in a library call.
+inline uint64_t divide128(uint64_t _hi, uint64_t _lo, uint64_t _d, uint64_t& o_r)
+{
+#if defined(__x86_64__)
+	uint64_t q;
+	__asm__("divq %4" : "=a"(q), "=d"(o_r) : "a"(_lo), "d"(_hi), "rm"(_d));
+	return q;
+#else
+	unsigned __int128 n = ((unsigned __int128)_hi << 64) | _lo;
+	o_r = (uint64_t)(n % _d);
+	return (uint64_t)(n / _d);
+#endif
+}
+
+/// Knuth's algorithm D (TAOCP 4.3.1) on 64-bit limbs, least significant first: @a _u of @a _m limbs
+/// divided by @a _v of @a _n limbs, with _m >= _n >= 1 and _v[_n - 1] != 0. Writes the _m - _n + 1
+/// limbs of the quotient to @a o_q and the _n limbs of the remainder to @a o_r.
+void divideLimbs(uint64_t const* _u, unsigned _m, uint64_t const* _v, unsigned _n, uint64_t* o_q, uint64_t* o_r)
+{
+	using u128 = unsigned __int128;
+	using s128 = __int128;
+
+	if (_n == 1)
+	{
+		uint64_t rem = 0;
+		for (unsigned i = _m; i--;)
+			o_q[i] = divide128(rem, _u[i], _v[0], rem);
+		o_r[0] = rem;
+		return;
+	}
+
+	// Normalise so that the divisor's top bit is set; then each estimated quotient limb is at most two too big.
+	unsigned s = __builtin_clzll(_v[_n - 1]);
+	uint64_t vn[8];
+	uint64_t un[9];
+	for (unsigned i = _n - 1; i > 0; --i)
+		vn[i] = (_v[i] << s) | (s ? _v[i - 1] >> (64 - s) : 0);
+	vn[0] = _v[0] << s;
+	un[_m] = s ? _u[_m - 1] >> (64 - s) : 0;
+	for (unsigned i = _m - 1; i > 0; --i)
+		un[i] = (_u[i] << s) | (s ? _u[i - 1] >> (64 - s) : 0);
+	un[0] = _u[0] << s;
+
+	for (unsigned j = _m - _n + 1; j--;)
+	{
+		// The running remainder is below the divisor, so its top limb is at most the divisor's.
+		uint64_t qhat;
+		uint64_t rhat;
+		bool rhatFits = true;
+		if (un[j + _n] >= vn[_n - 1])
+		{
+			qhat = ~uint64_t(0);
+			u128 r = (((u128)un[j + _n] << 64) | un[j + _n - 1]) - (u128)qhat * vn[_n - 1];
+			rhat = (uint64_t)r;
+			rhatFits = !(r >> 64);
+		}
+		else
+			qhat = divide128(un[j + _n], un[j + _n - 1], vn[_n - 1], rhat);
+		while (rhatFits && (u128)qhat * vn[_n - 2] > (((u128)rhat << 64) | un[j + _n - 2]))
+		{
+			--qhat;
+			rhat += vn[_n - 1];
+			rhatFits = rhat >= vn[_n - 1];
+		}
+
+		// Multiply and subtract.
+		s128 borrow = 0;
+		s128 t;
+		for (unsigned i = 0; i < _n; ++i)
+		{
+			u128 p = (u128)qhat * vn[i];
+			t = (s128)un[i + j] - borrow - (s128)(uint64_t)p;
+			un[i + j] = (uint64_t)t;
+			borrow = (s128)(p >> 64) - (t >> 64);
+		}
+		t = (s128)un[j + _n] - borrow;
+		un[j + _n] = (uint64_t)t;
+
+		o_q[j] = (uint64_t)qhat;
+		if (t < 0)
+		{
+			// Estimate was one too big: add the divisor back.
+			--o_q[j];
+			u128 carry = 0;
+			for (unsigned i = 0; i < _n; ++i)
+			{
+				carry += (u128)un[i + j] + vn[i];
+				un[i + j] = (uint64_t)carry;
+				carry >>= 64;
+			}
+			un[j + _n] += (uint64_t)carry;
+		}
+	}
+
+	for (unsigned i = 0; i < _n; ++i)
+		o_r[i] = (un[i] >> s) | (s ? un[i + 1] << (64 - s) : 0);
+}
+
+/// @returns the @a _m limbs at @a _u modulo @a _mod, which must not be zero.
+uint256 modLimbs(uint64_t const* _u, unsigned _m, uint256 const& _mod)
+{
+	uint64_t v[4] = { _mod.limb(0), _mod.limb(1), _mod.limb(2), _mod.limb(3) };
+	unsigned n = significantLimbs(v, 4);
+	unsigned m = significantLimbs(_u, _m);
+	if (m < n)
+		return uint256::fromLimbs(_u, m);
+	uint64_t q[8];
+	uint64_t r[4] = {};
+	divideLimbs(_u, m, v, n, q, r);
+	return uint256::fromLimbs(r, n);
+}
+
+}
+
+uint256::uint256(u256 const& _v): m_limbs{0, 0, 0, 0}
+{
+	memcpy(m_limbs, _v.backend().limbs(), _v.backend().size() * sizeof(boost::multiprecision::limb_type));
+}
+
+uint256::operator u256() const
+{
+	u256 ret;
+	Backend& b = ret.backend();
+	b.resize(c_backendLimbs, c_backendLimbs);
+	memcpy(b.limbs(), m_limbs, sizeof(m_limbs));
+	b.normalize();
+	return ret;
+}
+
+uint256 uint256::fromLimbs(uint64_t const* _l, unsigned _n)
+{
+	uint256 ret;
+	memcpy(ret.m_limbs, _l, _n * sizeof(uint64_t));
+	return ret;
+}
+
+pair<uint256, uint256> divmod(uint256 const& _a, uint256 const& _b)
+{
+	unsigned n = significantLimbs(_b.m_limbs, 4);
+	unsigned m = significantLimbs(_a.m_limbs, 4);
+	if (!n)
+		return { uint256(), uint256() };
+	if (m < n || _a < _b)
+		return { uint256(), _a };
+	uint256 q;
+	uint256 r;
+	divideLimbs(_a.m_limbs, m, _b.m_limbs, n, q.m_limbs, r.m_limbs);
+	return { q, r };
+}
+
+uint256 addmod(uint256 const& _a, uint256 const& _b, uint256 const& _m)
+{
+	if (!_m)
+		return 0;
+	uint256 sum = _a + _b;
+	if (sum >= _a)
+		return sum % _m;
+	// The sum wrapped: divide the 257-bit one.
+	uint64_t u[5] = { sum.limb(0), sum.limb(1), sum.limb(2), sum.limb(3), 1 };
+	return modLimbs(u, 5, _m);
+}
+
+uint256 mulmod(uint256 const& _a, uint256 const& _b, uint256 const& _m)
+{
+	if (!_m)
+		return 0;
+	uint64_t p[8] = {};
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		if (!_a.limb(i))
+			continue;
+		uint64_t carry = 0;
+		for (unsigned j = 0; j < 4; ++j)
+		{
+			unsigned __int128 t = (unsigned __int128)_a.limb(i) * _b.limb(j) + p[i + j] + carry;
+			p[i + j] = (uint64_t)t;
+			carry = (uint64_t)(t >> 64);
+		}
+		p[i + 4] = carry;
+	}
+	return modLimbs(p, 8, _m);
+}
+
+uint256 exp(uint256 _base, uint256 _exponent)
+{
+	uint256 ret = 1;
+	for (unsigned bits = _exponent.bitLength(), i = 0; i < bits; ++i)
+	{
+		if ((_exponent.limb(i / 64) >> (i % 64)) & 1)
+			ret *= _base;
+		if (i + 1 < bits)
+			_base *= _base;
+	}
+	return ret;
+}
+
+uint256 sdiv(uint256 const& _a, uint256 const& _b)
+{
+	bool negA = _a.isNegative();
+	bool negB = _b.isNegative();
+	uint256 q = (negA ? -_a : _a) / (negB ? -_b : _b);
+	return negA != negB ? -q : q;
+}
+
+uint256 smod(uint256 const& _a, uint256 const& _b)
+{
+	bool negA = _a.isNegative();
+	uint256 r = (negA ? -_a : _a) % (_b.isNegative() ? -_b : _b);
+	return negA ? -r : r;
+}
+
+uint256 signextend(uint256 const& _byte, uint256 const& _v)
+{
+	if (_byte >= 31)
+		return _v;
+	unsigned bit = (unsigned)_byte * 8 + 7;
+	uint256 mask = (uint256(1) << bit) - 1;
+	return ((_v >> bit).limb(0) & 1) ? _v | ~mask : _v & mask;
+}
+
+ostream& operator<<(ostream& _out, uint256 const& _v)
+{
+	return _out << u256(_v);
+}
+
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iosfwd>
+#include <type_traits>
+#include <utility>
+#include "Common.h"
+#include "FixedHash.h"
+#include "FixedHashOps.h"
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace dev
+{
+
+/**
+ * @brief Unsigned 256-bit integer in four 64-bit limbs, arithmetic modulo 2^256 as u256.
+ *
+ * u256 is a Boost.Multiprecision number: it keeps a used-limb count, normalises after every operation
+ * and goes through generic loops for all of them. This is the EVM word as the hardware likes it: a
+ * trivially copyable 32-byte value, with addition and subtraction as carry chains, multiplication as
+ * ten 64x64->128 products and division as Knuth's algorithm D on whole limbs, with a shortcut for
+ * divisors of one limb.
+ *
+ * A u256 converts to it implicitly, so mixed expressions are done in uint256; the way back to u256 is
+ * explicit, as Boost would take anything that converts implicitly for a built-in arithmetic type. From
+ * and to the big-endian h256 it converts explicitly, as u256 does.
+ *
+ * As in the EVM, dividing by zero gives zero, quotient and remainder alike.
+ */
+class uint256
+{
+public:
+	constexpr uint256(): m_limbs{0, 0, 0, 0} {}
+	/// Negative values are taken modulo 2^256, as they are by u256.
+	template <class T, class = typename std::enable_if<std::is_integral<T>::value>::type>
+	constexpr uint256(T _v): m_limbs{(uint64_t)_v, signFill(_v), signFill(_v), signFill(_v)} {}
+	uint256(u256 const& _v);
+	explicit uint256(h256 const& _h) { fromBytes(_h.data()); }
+
+	explicit operator u256() const;
+	/// The low bits, as a cast of u256 gives them.
+	template <class T, class = typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+	explicit operator T() const { return (T)m_limbs[0]; }
+	explicit operator bool() const { return (m_limbs[0] | m_limbs[1] | m_limbs[2] | m_limbs[3]) != 0; }
+
+	/// @returns the value as a big-endian hash.
+	h256 asHash() const { h256 ret; toBigEndian(ret.data()); return ret; }
+	/// Writes the value big-endian into the 32 bytes at @a o_out.
+	void toBigEndian(byte* o_out) const { for (unsigned i = 0; i < 4; ++i) hashops::store64(o_out + 24 - 8 * i, __builtin_bswap64(m_limbs[i])); }
+	/// @returns the big-endian number in @a _b; only its last 32 bytes count.
+	static uint256 fromBigEndian(bytesConstRef _b)
+	{
+		byte buf[32] = {};
+		size_t n = std::min<size_t>(_b.size(), 32);
+		if (n)
+			memcpy(buf + 32 - n, _b.data() + _b.size() - n, n);
+		uint256 ret;
+		ret.fromBytes(buf);
+		return ret;
+	}
+
+	/// @returns the number in the @a _n (at most 4) limbs at @a _l, least significant first.
+	static uint256 fromLimbs(uint64_t const* _l, unsigned _n);
+	/// Limb @a _i, the least significant being 0.
+	uint64_t limb(unsigned _i) const { return m_limbs[_i]; }
+	/// @returns the number of significant bits, 0 for zero.
+	unsigned bitLength() const
+	{
+		for (unsigned i = 4; i--;)
+			if (m_limbs[i])
+				return i * 64 + 64 - __builtin_clzll(m_limbs[i]);
+		return 0;
+	}
+	/// @returns the number of significant bytes, 0 for zero.
+	unsigned byteLength() const { return (bitLength() + 7) / 8; }
+	/// @returns whether the value fits into 64 bits.
+	bool fits64() const { return !(m_limbs[1] | m_limbs[2] | m_limbs[3]); }
+	/// The sign bit, if read as two's complement.
+	bool isNegative() const { return m_limbs[3] >> 63; }
+
+	friend uint256 operator+(uint256 const& _a, uint256 const& _b)
+	{
+		uint256 ret;
+#if defined(__x86_64__)
+		unsigned char c = _addcarry_u64(0, _a.m_limbs[0], _b.m_limbs[0], (unsigned long long*)&ret.m_limbs[0]);
+		c = _addcarry_u64(c, _a.m_limbs[1], _b.m_limbs[1], (unsigned long long*)&ret.m_limbs[1]);
+		c = _addcarry_u64(c, _a.m_limbs[2], _b.m_limbs[2], (unsigned long long*)&ret.m_limbs[2]);
+		_addcarry_u64(c, _a.m_limbs[3], _b.m_limbs[3], (unsigned long long*)&ret.m_limbs[3]);
+#else
+		unsigned __int128 s = 0;
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			s += (unsigned __int128)_a.m_limbs[i] + _b.m_limbs[i];
+			ret.m_limbs[i] = (uint64_t)s;
+			s >>= 64;
+		}
+#endif
+		return ret;
+	}
+	friend uint256 operator-(uint256 const& _a, uint256 const& _b)
+	{
+		uint256 ret;
+#if defined(__x86_64__)
+		unsigned char c = _subborrow_u64(0, _a.m_limbs[0], _b.m_limbs[0], (unsigned long long*)&ret.m_limbs[0]);
+		c = _subborrow_u64(c, _a.m_limbs[1], _b.m_limbs[1], (unsigned long long*)&ret.m_limbs[1]);
+		c = _subborrow_u64(c, _a.m_limbs[2], _b.m_limbs[2], (unsigned long long*)&ret.m_limbs[2]);
+		_subborrow_u64(c, _a.m_limbs[3], _b.m_limbs[3], (unsigned long long*)&ret.m_limbs[3]);
+#else
+		uint64_t borrow = 0;
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			unsigned __int128 d = (unsigned __int128)_a.m_limbs[i] - _b.m_limbs[i] - borrow;
+			ret.m_limbs[i] = (uint64_t)d;
+			borrow = (uint64_t)(d >> 64) & 1;
+		}
+#endif
+		return ret;
+	}
+	friend uint256 operator*(uint256 const& _a, uint256 const& _b)
+	{
+		uint256 ret;
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			if (!_a.m_limbs[i])
+				continue;
+			uint64_t carry = 0;
+			for (unsigned j = 0; i + j < 4; ++j)
+			{
+				unsigned __int128 p = (unsigned __int128)_a.m_limbs[i] * _b.m_limbs[j] + ret.m_limbs[i + j] + carry;
+				ret.m_limbs[i + j] = (uint64_t)p;
+				carry = (uint64_t)(p >> 64);
+			}
+		}
+		return ret;
+	}
+	friend uint256 operator/(uint256 const& _a, uint256 const& _b)
+	{
+		if (_a.fits64() && _b.fits64())
+			return _b.m_limbs[0] ? _a.m_limbs[0] / _b.m_limbs[0] : 0;
+		return divmod(_a, _b).first;
+	}
+	friend uint256 operator%(uint256 const& _a, uint256 const& _b)
+	{
+		if (_a.fits64() && _b.fits64())
+			return _b.m_limbs[0] ? _a.m_limbs[0] % _b.m_limbs[0] : 0;
+		return divmod(_a, _b).second;
+	}
+	/// @returns the quotient and the remainder of @a _a / @a _b.
+	friend std::pair<uint256, uint256> divmod(uint256 const& _a, uint256 const& _b);
+
+	friend uint256 operator&(uint256 const& _a, uint256 const& _b) { return uint256(_a.m_limbs[0] & _b.m_limbs[0], _a.m_limbs[1] & _b.m_limbs[1], _a.m_limbs[2] & _b.m_limbs[2], _a.m_limbs[3] & _b.m_limbs[3]); }
+	friend uint256 operator|(uint256 const& _a, uint256 const& _b) { return uint256(_a.m_limbs[0] | _b.m_limbs[0], _a.m_limbs[1] | _b.m_limbs[1], _a.m_limbs[2] | _b.m_limbs[2], _a.m_limbs[3] | _b.m_limbs[3]); }
+	friend uint256 operator^(uint256 const& _a, uint256 const& _b) { return uint256(_a.m_limbs[0] ^ _b.m_limbs[0], _a.m_limbs[1] ^ _b.m_limbs[1], _a.m_limbs[2] ^ _b.m_limbs[2], _a.m_limbs[3] ^ _b.m_limbs[3]); }
+	friend uint256 operator~(uint256 const& _a) { return uint256(~_a.m_limbs[0], ~_a.m_limbs[1], ~_a.m_limbs[2], ~_a.m_limbs[3]); }
+	friend uint256 operator-(uint256 const& _a) { return uint256() - _a; }
+
+	friend uint256 operator<<(uint256 const& _a, unsigned _n)
+	{
+		if (_n >= 256)
+			return uint256();
+		uint256 ret;
+		unsigned limbs = _n / 64;
+		unsigned bits = _n % 64;
+		for (unsigned i = 4; i-- > limbs;)
+		{
+			ret.m_limbs[i] = _a.m_limbs[i - limbs] << bits;
+			if (bits && i > limbs)
+				ret.m_limbs[i] |= _a.m_limbs[i - limbs - 1] >> (64 - bits);
+		}
+		return ret;
+	}
+	friend uint256 operator>>(uint256 const& _a, unsigned _n)
+	{
+		if (_n >= 256)
+			return uint256();
+		uint256 ret;
+		unsigned limbs = _n / 64;
+		unsigned bits = _n % 64;
+		for (unsigned i = 0; i + limbs < 4; ++i)
+		{
+			ret.m_limbs[i] = _a.m_limbs[i + limbs] >> bits;
+			if (bits && i + limbs < 3)
+				ret.m_limbs[i] |= _a.m_limbs[i + limbs + 1] << (64 - bits);
+		}
+		return ret;
+	}
+
+	friend bool operator==(uint256 const& _a, uint256 const& _b) { return !((_a.m_limbs[0] ^ _b.m_limbs[0]) | (_a.m_limbs[1] ^ _b.m_limbs[1]) | (_a.m_limbs[2] ^ _b.m_limbs[2]) | (_a.m_limbs[3] ^ _b.m_limbs[3])); }
+	friend bool operator!=(uint256 const& _a, uint256 const& _b) { return !(_a == _b); }
+	/// The borrow out of _a - _b, without branches.
+	friend bool operator<(uint256 const& _a, uint256 const& _b)
+	{
+#if defined(__x86_64__)
+		unsigned long long d;
+		unsigned char c = _subborrow_u64(0, _a.m_limbs[0], _b.m_limbs[0], &d);
+		c = _subborrow_u64(c, _a.m_limbs[1], _b.m_limbs[1], &d);
+		c = _subborrow_u64(c, _a.m_limbs[2], _b.m_limbs[2], &d);
+		return _subborrow_u64(c, _a.m_limbs[3], _b.m_limbs[3], &d);
+#else
+		for (unsigned i = 4; i--;)
+			if (_a.m_limbs[i] != _b.m_limbs[i])
+				return _a.m_limbs[i] < _b.m_limbs[i];
+		return false;
+#endif
+	}
+	friend bool operator>(uint256 const& _a, uint256 const& _b) { return _b < _a; }
+	friend bool operator<=(uint256 const& _a, uint256 const& _b) { return !(_b < _a); }
+	friend bool operator>=(uint256 const& _a, uint256 const& _b) { return !(_a < _b); }
+
+	uint256& operator+=(uint256 const& _b) { return *this = *this + _b; }
+	uint256& operator-=(uint256 const& _b) { return *this = *this - _b; }
+	uint256& operator*=(uint256 const& _b) { return *this = *this * _b; }
+	uint256& operator/=(uint256 const& _b) { return *this = *this / _b; }
+	uint256& operator%=(uint256 const& _b) { return *this = *this % _b; }
+	uint256& operator&=(uint256 const& _b) { return *this = *this & _b; }
+	uint256& operator|=(uint256 const& _b) { return *this = *this | _b; }
+	uint256& operator^=(uint256 const& _b) { return *this = *this ^ _b; }
+	uint256& operator<<=(unsigned _n) { return *this = *this << _n; }
+	uint256& operator>>=(unsigned _n) { return *this = *this >> _n; }
+	uint256& operator++() { return *this += 1; }
+	uint256& operator--() { return *this -= 1; }
+
+	/// 64 bits of hash over the whole value.
+	size_t hash() const { return (size_t)hashops::hash<32>((byte const*)m_limbs); }
+
+private:
+	constexpr uint256(uint64_t _l0, uint64_t _l1, uint64_t _l2, uint64_t _l3): m_limbs{_l0, _l1, _l2, _l3} {}
+
+	template <class T> static constexpr uint64_t signFill(T _v) { return std::is_signed<T>::value ? (uint64_t)((int64_t)_v >> 63) : 0; }
+
+	/// Reads the 32 big-endian bytes at @a _p.
+	void fromBytes(byte const* _p) { for (unsigned i = 0; i < 4; ++i) m_limbs[i] = __builtin_bswap64(hashops::load64(_p + 24 - 8 * i)); }
+
+	uint64_t m_limbs[4];
+};
+
+static_assert(sizeof(uint256) == 32 && std::is_trivially_copyable<uint256>::value, "uint256 must be a plain 32-byte value");
+
+std::pair<uint256, uint256> divmod(uint256 const& _a, uint256 const& _b);
+
+/// EVM arithmetic. The signed operations read their operands as two's complement.
+
+/// (@a _a + @a _b) mod @a _m, without the sum wrapping at 2^256; 0 if @a _m is zero.
+uint256 addmod(uint256 const& _a, uint256 const& _b, uint256 const& _m);
+/// (@a _a * @a _b) mod @a _m over the full 512-bit product; 0 if @a _m is zero.
+uint256 mulmod(uint256 const& _a, uint256 const& _b, uint256 const& _m);
+/// @a _base to the power of @a _exponent, modulo 2^256.
+uint256 exp(uint256 _base, uint256 _exponent);
+/// Signed division, rounding toward zero; -2^255 / -1 gives -2^255.
+uint256 sdiv(uint256 const& _a, uint256 const& _b);
+/// Signed remainder, with the sign of @a _a.
+uint256 smod(uint256 const& _a, uint256 const& _b);
+inline bool slt(uint256 const& _a, uint256 const& _b) { return _a.isNegative() != _b.isNegative() ? _a.isNegative() : _a < _b; }
+inline bool sgt(uint256 const& _a, uint256 const& _b) { return slt(_b, _a); }
+/// Extends the sign bit of the low (@a _byte + 1) bytes of @a _v over the higher ones.
+uint256 signextend(uint256 const& _byte, uint256 const& _v);
+
+/// Decimal, as u256 streams.
+std::ostream& operator<<(std::ostream& _out, uint256 const& _v);
+
+}
+
+namespace std
+{
+
+template <> struct hash<dev::uint256>
+{
+	size_t operator()(dev::uint256 const& _v) const { return _v.hash(); }
+};
+
+}
@@ -42,7 +42,7 @@ public:
 		}
 		auto item = std::move(m_queue.front());
 		m_queue.pop();
-		return std::make_pair(ret, item);
+		return std::make_pair(ret, std::move(item));
 	}
 
 private:
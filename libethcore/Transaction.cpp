@@ -118,28 +118,6 @@ void TransactionBase::sign(Secret const& _priv)
 		m_vrs = sigStruct;
 }
 
-void TransactionBase::streamRLP(RLPStream& _s, IncludeSignature _sig, bool _forEip155hash) const
-{
-	if (m_type == NullTransaction)
-		return;
-
-	_s.appendList((_sig || _forEip155hash ? 3 : 0) + 6);
-	_s << m_nonce << m_gasPrice << m_gas;
-	if (m_type == MessageCall)
-		_s << m_receiveAddress;
-	else
-		_s << "";
-	_s << m_value << m_data;
-
-	if (_sig)
-	{
-		int vOffset = m_chainId*2 + 35;
-		_s << (m_vrs.v + vOffset) << (u256)m_vrs.r << (u256)m_vrs.s;
-	}
-	else if (_forEip155hash)
-		_s << m_chainId << 0 << 0;
-}
-
 static const u256 c_secp256k1n("115792089237316195423570985008687907852837564279074904382605163141518161494337");
 
 void TransactionBase::checkLowS() const
@@ -171,10 +149,7 @@ h256 TransactionBase::sha3(IncludeSignature _sig) const
 	if (_sig == WithSignature && m_hashWith)
 		return m_hashWith;
 
-	RLPStream s;
-	streamRLP(s, _sig, m_chainId > 0 && _sig == WithoutSignature);
-
-	auto ret = dev::sha3(s.out());
+	auto ret = dev::sha3(RLPEncoder::local().encode([&](RLPEncoder& _e) { streamRLP(_e, _sig, m_chainId > 0 && _sig == WithoutSignature); }));
 	if (_sig == WithSignature)
 		m_hashWith = ret;
 	return ret;
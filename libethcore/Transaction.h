@@ -1,6 +1,7 @@
 #pragma once
 
 #include <libdevcore/RLP.h>
+#include <libdevcore/RLPEncoder.h>
 #include <libdevcore/SHA3.h>
 #include <libethcore/Common.h>
 
@@ -80,7 +81,9 @@ public:
 	bool isCreation() const { return m_type == ContractCreation; }
 
 	/// Serialises this transaction to an RLPStream.
-	void streamRLP(RLPStream& _s, IncludeSignature _sig = WithSignature, bool _forEip155hash = false) const;
+	void streamRLP(RLPStream& _s, IncludeSignature _sig = WithSignature, bool _forEip155hash = false) const { streamRLPTo(_s, _sig, _forEip155hash); }
+	/// Serialises this transaction to an RLPEncoder.
+	void streamRLP(RLPEncoder& _s, IncludeSignature _sig = WithSignature, bool _forEip155hash = false) const { streamRLPTo(_s, _sig, _forEip155hash); }
 
 	/// @returns the RLP serialisation of this transaction.
 	bytes rlp(IncludeSignature _sig = WithSignature) const { RLPStream s; streamRLP(s, _sig); return s.out(); }
@@ -132,6 +135,28 @@ public:
 	static int64_t baseGasRequired(bool _contractCreation, bytesConstRef _data, EVMSchedule const& _es);
 
 protected:
+	template <class S> void streamRLPTo(S& _s, IncludeSignature _sig, bool _forEip155hash) const
+	{
+		if (m_type == NullTransaction)
+			return;
+
+		_s.appendList((_sig || _forEip155hash ? 3 : 0) + 6);
+		_s << m_nonce << m_gasPrice << m_gas;
+		if (m_type == MessageCall)
+			_s << m_receiveAddress;
+		else
+			_s << "";
+		_s << m_value << m_data;
+
+		if (_sig)
+		{
+			int vOffset = m_chainId*2 + 35;
+			_s << (m_vrs.v + vOffset) << (u256)m_vrs.r << (u256)m_vrs.s;
+		}
+		else if (_forEip155hash)
+			_s << m_chainId << 0 << 0;
+	}
+
 	/// Type of transaction.
 	enum Type
 	{
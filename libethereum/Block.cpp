@@ -5,7 +5,10 @@
 #include <boost/timer.hpp>
 #include <libdevcore/CommonIO.h>
 #include <libdevcore/Assertions.h>
+#include <libdevcore/AsyncLog.h>
+#include <libdevcore/RLPEncoder.h>
 #include <libdevcore/TrieHash.h>
+#include <libdevcore/TriePrefetcher.h>
 #include <libevmcore/Instruction.h>
 #include <libethcore/Exceptions.h>
 #include <libethcore/SealEngine.h>
@@ -58,6 +61,8 @@ Block::Block(Block const& _s):
 	m_state(_s.m_state),
 	m_transactions(_s.m_transactions),
 	m_receipts(_s.m_receipts),
+	m_receiptsTrie(_s.m_receiptsTrie),
+	m_receiptsBloom(_s.m_receiptsBloom),
 	m_transactionSet(_s.m_transactionSet),
 	m_precommit(_s.m_state),
 	m_previousBlock(_s.m_previousBlock),
@@ -77,6 +82,8 @@ Block& Block::operator=(Block const& _s)
 	m_state = _s.m_state;
 	m_transactions = _s.m_transactions;
 	m_receipts = _s.m_receipts;
+	m_receiptsTrie = _s.m_receiptsTrie;
+	m_receiptsBloom = _s.m_receiptsBloom;
 	m_transactionSet = _s.m_transactionSet;
 	m_previousBlock = _s.m_previousBlock;
 	m_currentBlock = _s.m_currentBlock;
@@ -93,6 +100,8 @@ void Block::resetCurrent(u256 const& _timestamp)
 {
 	m_transactions.clear();
 	m_receipts.clear();
+	m_receiptsTrie.clear();
+	m_receiptsBloom = LogBloom();
 	m_transactionSet.clear();
 	m_currentBlock = BlockHeader();
 	m_currentBlock.setAuthor(m_author);
@@ -420,7 +429,7 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
             {
                 try
                 {
-                    cdebug << "PACK-TX: Hash=" << (t.sha3()) << ",time=" << utcTime();
+                    crecord(DebugChannel, "PACK-TX: Hash={},time={}", t.sha3(), utcTime());
 
                     //u256 check = _bc.filterCheck(t, FilterCheckScene::PackTranscation);
                     //if ( (u256)SystemContractCode::Ok != check  )
@@ -457,7 +466,7 @@ pair<TransactionReceipts, bool> Block::sync(BlockChain const& _bc, TransactionQu
                         execute(lh, t, Permanence::Committed, OnOpFunc(), &_bc);
                         ret.first.push_back(m_receipts.back());
                     } else {
-                        cdebug << "Block::sync no need exec: t=" << toString(t.sha3());
+                        crecord(DebugChannel, "Block::sync no need exec: t={}", t.sha3());
                         m_transactions.push_back(t);
                         m_transactionSet.insert(t.sha3());
                     }
@@ -555,13 +564,16 @@ TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
     DEV_TIMED_ABOVE("lastHashes", 500)
     lh = _bc.lastHashes();
 
+    DEV_TIMED_ABOVE("prefetch", 500)
+    prefetchState(m_transactions);
+
     unsigned i = 0;
     DEV_TIMED_ABOVE("txExec,blk=" + toString(info().number()) + ",txs=" + toString(m_transactions.size()), 500)
     for (Transaction const& tr : m_transactions)
     {
         try
         {
-            cdebug << "Block::exec transaction: " << tr.from() /*<< state().transactionsFrom(tr.from()) */ << tr.value() << toString(tr.sha3());
+            crecord(DebugChannel, "Block::exec transaction: {} {} {}", tr.from(), tr.value(), tr.sha3());
             execute(lh, tr, Permanence::Committed, OnOpFunc(), &_bc);
         }
         catch (Exception& ex)
@@ -576,8 +588,8 @@ TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
             _tq.drop(tr.sha3());  
             throw;
         }
-        cdebug << "Block::exec: t=" << toString(tr.sha3());
-        cdebug << "Block::exec: stateRoot=" << toString(m_receipts.back().stateRoot()) << ",gasUsed=" << toString(m_receipts.back().gasUsed()) << ",sha3=" << toString(sha3(m_receipts.back().rlp()));
+        crecord(DebugChannel, "Block::exec: t={}", tr.sha3());
+        crecord(DebugChannel, "Block::exec: stateRoot={},gasUsed={},sha3={}", m_receipts.back().stateRoot(), m_receipts.back().gasUsed(), sha3(m_receipts.back().rlp()));
 
         RLPStream receiptRLP;
         m_receipts.back().streamRLP(receiptRLP);
@@ -588,6 +600,46 @@ TransactionReceipts Block::exec(BlockChain const& _bc, TransactionQueue& _tq)
     return ret;
 }
 
+void Block::prefetchState(Transactions const& _txs) const
+{
+	if (_txs.empty())
+		return;
+
+	std::unordered_set<Address> touched;
+	for (Transaction const& tr: _txs)
+	{
+		touched.insert(tr.safeSender());
+		if (!tr.isCreation())
+			touched.insert(tr.receiveAddress());
+	}
+	touched.erase(Address());
+	vector<bytes> keys;
+	for (Address const& a: touched)
+		keys.push_back(sha3(a).asBytes());
+
+	// Accounts first; their leaves then name the storage roots and code to pull in as a second batch.
+	TriePrefetcher<OverlayDB> prefetcher(&db());
+	h256s next;
+	for (string const& account: prefetcher.prefetch(rootHash(), keys))
+		if (!account.empty())
+		{
+			RLP r(account);
+			if (r.isList() && r.itemCount() == 4)
+			{
+				h256 storageRoot = r[2].toHash<h256>();
+				h256 codeHash = r[3].toHash<h256>();
+				if (storageRoot != EmptyTrie)
+					next.push_back(storageRoot);
+				if (codeHash != EmptySHA3)
+					next.push_back(codeHash);
+			}
+		}
+	if (!next.empty())
+		db().lookupMany(next);
+
+	clog(BlockTrace) << "Prefetched" << touched.size() << "accounts in" << prefetcher.batches() << "batches (" << prefetcher.nodes() << "nodes)," << next.size() << "storage roots/code";
+}
+
 u256 Block::enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc)
 {
 	noteChain(_bc);
@@ -604,6 +656,17 @@ u256 Block::enactOn(VerifiedBlockRef const& _block, BlockChain const& _bc)
 	BlockHeader biParent = _bc.info(_block.info.parentHash());
 	_block.info.verify(CheckNothingNew/*CheckParent*/, biParent);
 
+	// A block this node executed itself (the PBFT leader's proposal) is taken as it was executed, its
+	// changes still in its overlay, under the sealed header, once that has passed the family checks.
+	// Its uncles and transactions are what the executed block was built from, as the hash says.
+	u256 tdIncrease;
+	if (auto executed = _bc.takeExecutedBlock(_block.info, tdIncrease))
+	{
+		*this = *executed;
+		m_currentBlock = _block.info;
+		return tdIncrease;
+	}
+
 #if ETH_TIMED_ENACTMENTS
 	populateVerify = t.elapsed();
 	t.restart();
@@ -668,6 +731,9 @@ u256 Block::enact(VerifiedBlockRef const& _block, BlockChain const& _bc)
 
 	vector<bytes> receipts;
 
+	DEV_TIMED_ABOVE("prefetch", 500)
+		prefetchState(_block.transactions);
+
 	// All ok with the block generally. Play back the transactions now...
 	unsigned i = 0;
 	DEV_TIMED_ABOVE("txExec", 500)
@@ -863,7 +929,7 @@ ExecutionResult Block::execute(LastHashes const& _lh, Transaction const& _t, Per
 ExecutionResult Block::execute(LastHashes const& _lh, Transaction const& _t, Permanence _p, OnOpFunc const& _onOp, BlockChain const *_bcp)
 {
     (void)_bcp;
-    cdebug << "Block::execute " << _t.sha3();
+    crecord(DebugChannel, "Block::execute {}", _t.sha3());
     if (isSealed())
         BOOST_THROW_EXCEPTION(InvalidOperationOnSealedBlock());
 
@@ -887,9 +953,9 @@ ExecutionResult Block::execute(LastHashes const& _lh, Transaction const& _t, Per
     {
         // Add to the user-originated transactions that we've executed.
         m_transactions.push_back(_t);
-        cdebug << "Block::execute: t=" << toString(_t.sha3());
-        m_receipts.push_back(resultReceipt.second);
-        cdebug << "Block::execute: stateRoot=" << toString(resultReceipt.second.stateRoot()) << ",gasUsed=" << toString(resultReceipt.second.gasUsed()) << ",sha3=" << toString(sha3(resultReceipt.second.rlp()));
+        crecord(DebugChannel, "Block::execute: t={}", _t.sha3());
+        noteReceipt(resultReceipt.second);
+        crecord(DebugChannel, "Block::execute: stateRoot={},gasUsed={},sha3={}", resultReceipt.second.stateRoot(), resultReceipt.second.gasUsed(), sha3(resultReceipt.second.rlp()));
         m_transactionSet.insert(_t.sha3());
 
 
@@ -971,36 +1037,18 @@ void Block::commitToSeal(BlockChain const& _bc, bytes const& _extraData)
 		}
 	}
 
-	BytesMap transactionsMap;
-	BytesMap receiptsMap;
-
-	RLPStream txs;
-	txs.appendList(m_transactions.size());
-
-	for (unsigned i = 0; i < m_transactions.size(); ++i)
+	// The whole list in one allocation; the transactions trie takes each transaction as a view into it.
+	m_currentTxs.clear();
+	RLPEncoder::local().encodeInto(m_currentTxs, [&](RLPEncoder& _e)
 	{
-		RLPStream k;
-		k << i;
-
-		RLPStream receiptrlp;
-		m_receipts[i].streamRLP(receiptrlp);
-		receiptsMap.insert(std::make_pair(k.out(), receiptrlp.out()));
-
-		RLPStream txrlp;
-		m_transactions[i].streamRLP(txrlp);
-		transactionsMap.insert(std::make_pair(k.out(), txrlp.out()));
-
-		txs.appendRaw(txrlp.out());
-
-//#if ETH_PARANOIA
-/*		if (fromPending(i).transactionsFrom(m_transactions[i].from()) != m_transactions[i].nonce())
-		{
-			cwarn << "GAAA Something went wrong! " << fromPending(i).transactionsFrom(m_transactions[i].from()) << "!=" << m_transactions[i].nonce();
-		}*/
-//#endif
-	}
-
-	txs.swapOut(m_currentTxs);
+		_e.appendList(m_transactions.size());
+		for (auto const& t: m_transactions)
+			t.streamRLP(_e);
+	});
+	vector<bytesConstRef> transactionsRLP;
+	transactionsRLP.reserve(m_transactions.size());
+	for (auto const& t: RLP(m_currentTxs))
+		transactionsRLP.push_back(t.data());
 
 	RLPStream(unclesCount).appendRaw(unclesData.out(), unclesCount).swapOut(m_currentUncles);
 
@@ -1018,7 +1066,7 @@ void Block::commitToSeal(BlockChain const& _bc, bytes const& _extraData)
 
 	m_currentBlock.setLogBloom(logBloom());
 	m_currentBlock.setGasUsed(gasUsed());
-	m_currentBlock.setRoots(hash256(transactionsMap), hash256(receiptsMap), sha3(m_currentUncles), m_state.rootHash());
+	m_currentBlock.setRoots(orderedTrieRoot(transactionsRLP), m_receiptsTrie.root(), sha3(m_currentUncles), m_state.rootHash());
 
 	m_currentBlock.setParentHash(m_previousBlock.hash());
 	m_currentBlock.setExtraData(_extraData);
@@ -1033,15 +1081,7 @@ void Block::commitToSeal(BlockChain const& _bc, bytes const& _extraData)
 }
 
 void Block::commitToSealAfterExecTx(BlockChain const&) {
-    BytesMap receiptsMap;
-    for (unsigned i = 0; i < m_receipts.size(); ++i) {
-        RLPStream receiptrlp;
-        m_receipts[i].streamRLP(receiptrlp);
-        RLPStream k;
-        k << i;
-        receiptsMap.insert(std::make_pair(k.out(), receiptrlp.out()));
-    }
-
+    // Receipts were hashed into m_receiptsTrie as they came in; only the last path is left to do.
     //bool removeEmptyAccounts = m_currentBlock.number() >= _bc.chainParams().u256Param("EIP158ForkBlock");
     DEV_TIMED_ABOVE("commit", 500)
     m_state.commit(State::CommitBehaviour::KeepEmptyAccounts);
@@ -1052,7 +1092,7 @@ void Block::commitToSealAfterExecTx(BlockChain const&) {
 
     m_currentBlock.setLogBloom(logBloom());
     m_currentBlock.setGasUsed(gasUsed());
-    m_currentBlock.setRoots(m_currentBlock.transactionsRoot(), hash256(receiptsMap), m_currentBlock.sha3Uncles(), m_state.rootHash());
+    m_currentBlock.setRoots(m_currentBlock.transactionsRoot(), m_receiptsTrie.root(), m_currentBlock.sha3Uncles(), m_state.rootHash());
 
     m_committedToSeal = true;
 }
@@ -1140,10 +1180,15 @@ State Block::fromPending(unsigned _i) const
 
 LogBloom Block::logBloom() const
 {
-	LogBloom ret;
-	for (TransactionReceipt const& i: m_receipts)
-		ret |= i.bloom();
-	return ret;
+	return m_receiptsBloom;
+}
+
+void Block::noteReceipt(TransactionReceipt const& _r)
+{
+	m_receipts.push_back(_r);
+	bytes rlp = _r.rlp();
+	m_receiptsTrie.append(&rlp);
+	m_receiptsBloom |= _r.bloom();
 }
 
 void Block::cleanup(bool _fullCommit)
@@ -1165,7 +1210,8 @@ void Block::cleanup(bool _fullCommit)
 			throw;
 		}
 
-		m_state.db().commit();	// TODO: State API for this?
+		// Fenced with the root so that consensus can wait for this state to be durable (see OverlayDB::waitFlushed).
+		m_state.db().commit(rootHash());	// TODO: State API for this?
 
 		if (isChannelVisible<StateTrace>()) // Avoid calling toHex if not needed
 			clog(StateTrace) << "Committed: stateRoot" << m_currentBlock.stateRoot() << "=" << rootHash() << "=" << toHex(asBytes(db().lookup(rootHash())));
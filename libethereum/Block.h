@@ -6,6 +6,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/RLP.h>
 #include <libdevcore/TrieDB.h>
+#include <libdevcore/TrieHash.h>
 #include <libdevcore/OverlayDB.h>
 #include <libethcore/Exceptions.h>
 #include <libethcore/BlockHeader.h>
@@ -289,9 +290,15 @@ private:
 	/// Throws on failure.
 	u256 enact(VerifiedBlockRef const& _block, BlockChain const& _bc);
 
+	/// Warms the state DB with the accounts, storage roots and code that @a _txs are going to touch.
+	void prefetchState(Transactions const& _txs) const;
+
 	/// Finalise the block, applying the earned rewards.
 	void applyRewards(std::vector<BlockHeader> const& _uncleBlockHeaders, u256 const& _blockReward);
 
+	/// Adds @a _r to the receipts, the receipts root and the block's log bloom.
+	void noteReceipt(TransactionReceipt const& _r);
+
 	/// @returns gas used by transactions thus far executed.
 	u256 gasUsed() const { return m_receipts.size() ? m_receipts.back().gasUsed() : 0; }
 
@@ -304,6 +311,8 @@ private:
 	State m_state;								///< Our state tree, as an OverlayDB DB.
 	Transactions m_transactions;				///< The current list of transactions that we've included in the state.
 	TransactionReceipts m_receipts;				///< The corresponding list of transaction receipts.
+	OrderedTrieAppender m_receiptsTrie;			///< Root of m_receipts, kept up to date as they come in.
+	LogBloom m_receiptsBloom;					///< Union of the blooms of m_receipts.
 	h256Hash m_transactionSet;					///< The set of transaction hashes that we've included in the state.
 	State m_precommit;							///< State at the point immediately prior to rewards.
 
@@ -8,11 +8,14 @@
 #include <libdevcore/Log.h>
 #include <libdevcore/Exceptions.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/RLPIndex.h>
 #include <libethcore/Common.h>
 #include <libethcore/BlockHeader.h>
 #include <libethcore/SealEngine.h>
 #include <libevm/ExtVMFace.h>
 #include "BlockDetails.h"
+#include "CanonicalHashIndex.h"
+#include "ExecutedBlockCache.h"
 #include "Account.h"
 #include "Transaction.h"
 #include "BlockQueue.h"
@@ -73,6 +76,25 @@ enum {
 
 using ProgressCallback = std::function<void(unsigned, unsigned)>;
 
+/// A block's RLP together with offset tables over it and its transaction and uncle lists.
+struct IndexedBlock
+{
+	explicit IndexedBlock(bytes&& _block):
+		data(std::move(_block)),
+		parts(&data),
+		transactions(&data, parts.offset(1)),
+		uncles(&data, parts.offset(2))
+	{}
+
+	bytesConstRef transaction(size_t _i) const { return transactions.item(&data, _i); }
+	bytesConstRef uncle(size_t _i) const { return uncles.item(&data, _i); }
+
+	bytes data;
+	RLPIndex parts;				///< Header, transactions, uncles.
+	RLPIndex transactions;
+	RLPIndex uncles;
+};
+
 class VersionChecker
 {
 public:
@@ -130,39 +152,154 @@ public:
 	bytes block(h256 const& _hash) const;
 	bytes block() const { return block(currentHash()); }
 
+	/// Get a block with its transaction and uncle lists indexed; null if the block is unknown. Thread-safe.
+	/// The last few are cached, so repeated access to a block's transactions by index is cheap.
+	std::shared_ptr<IndexedBlock const> indexedBlock(h256 const& _hash) const
+	{
+		{
+			ReadGuard l(x_indexedBlocks);
+			auto it = m_indexedBlocks.find(_hash);
+			if (it != m_indexedBlocks.end())
+				return it->second;
+		}
+
+		bytes b = block(_hash);
+		if (b.empty())
+			return nullptr;
+		auto ret = std::make_shared<IndexedBlock const>(std::move(b));
+
+		// Blocks never change under their hash, so nothing here goes stale; just keep the cache bounded.
+		WriteGuard l(x_indexedBlocks);
+		if (m_indexedBlocks.insert(std::make_pair(_hash, ret)).second)
+		{
+			m_indexedOrder.push_back(_hash);
+			if (m_indexedOrder.size() > c_maxIndexedBlocks)
+			{
+				m_indexedBlocks.erase(m_indexedOrder.front());
+				m_indexedOrder.pop_front();
+			}
+		}
+		return ret;
+	}
+
 	/// Get a block (RLP format) for the given hash (or the most recent mined if none given). Thread-safe.
 	bytes headerData(h256 const& _hash) const;
 	bytes headerData() const { return headerData(currentHash()); }
 
 	/// Get the familial details concerning a block (or the most recent mined if none given). Thread-safe.
-	BlockDetails details(h256 const& _hash) const { return queryExtras<BlockDetails, ExtraDetails>(_hash, m_details, x_details, NullBlockDetails); }
+	BlockDetails details(h256 const& _hash) const { return queryExtras<BlockDetails, ExtraDetails>(_hash, m_details, NullBlockDetails); }
 	BlockDetails details() const { return details(currentHash()); }
 
 	/// Get the transactions' log blooms of a block (or the most recent mined if none given). Thread-safe.
-	BlockLogBlooms logBlooms(h256 const& _hash) const { return queryExtras<BlockLogBlooms, ExtraLogBlooms>(_hash, m_logBlooms, x_logBlooms, NullBlockLogBlooms); }
+	BlockLogBlooms logBlooms(h256 const& _hash) const { return queryExtras<BlockLogBlooms, ExtraLogBlooms>(_hash, m_logBlooms, NullBlockLogBlooms); }
 	BlockLogBlooms logBlooms() const { return logBlooms(currentHash()); }
 
 	/// Get the transactions' receipts of a block (or the most recent mined if none given). Thread-safe.
 	/// receipts are given in the same order are in the same order as the transactions
-	BlockReceipts receipts(h256 const& _hash) const { return queryExtras<BlockReceipts, ExtraReceipts>(_hash, m_receipts, x_receipts, NullBlockReceipts); }
+	BlockReceipts receipts(h256 const& _hash) const { return queryExtras<BlockReceipts, ExtraReceipts>(_hash, m_receipts, NullBlockReceipts); }
 	BlockReceipts receipts() const { return receipts(currentHash()); }
 
 	/// Get the transaction by block hash and index;
 	TransactionReceipt transactionReceipt(h256 const& _blockHash, unsigned _i) const { return receipts(_blockHash).receipts[_i]; }
 
 	/// Get the transaction receipt by transaction hash. Thread-safe.
-	TransactionReceipt transactionReceipt(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return bytesConstRef(); return transactionReceipt(ta.blockHash, ta.index); }
+	TransactionReceipt transactionReceipt(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, NullTransactionAddress); if (!ta) return bytesConstRef(); return transactionReceipt(ta.blockHash, ta.index); }
 
 	/// Get a list of transaction hashes for a given block. Thread-safe.
-	TransactionHashes transactionHashes(h256 const& _hash) const { auto b = block(_hash); RLP rlp(b); h256s ret; for (auto t: rlp[1]) ret.push_back(sha3(t.data())); return ret; }
+	TransactionHashes transactionHashes(h256 const& _hash) const { auto b = indexedBlock(_hash); if (!b) return TransactionHashes(); return sha3Batch(b->transactions.items(&b->data)); }
 	TransactionHashes transactionHashes() const { return transactionHashes(currentHash()); }
 
 	/// Get a list of uncle hashes for a given block. Thread-safe.
-	UncleHashes uncleHashes(h256 const& _hash) const { auto b = block(_hash); RLP rlp(b); h256s ret; for (auto t: rlp[2]) ret.push_back(sha3(t.data())); return ret; }
+	UncleHashes uncleHashes(h256 const& _hash) const { auto b = indexedBlock(_hash); if (!b) return UncleHashes(); return sha3Batch(b->uncles.items(&b->data)); }
 	UncleHashes uncleHashes() const { return uncleHashes(currentHash()); }
 	
-	/// Get the hash for a given block's number.
-	h256 numberHash(unsigned _i) const { if (!_i) return genesisHash(); return queryExtras<BlockHash, uint64_t, ExtraBlockHash>(_i, m_blockHashes, x_blockHashes, NullBlockHash).value; }
+	/// Get the hash for a given block's number: an array read in the number index, if it has the block and
+	/// agrees with the current head.
+	h256 numberHash(unsigned _i) const
+	{
+		if (!_i)
+			return genesisHash();
+		if (_i < trustedNumberIndexSize())
+		{
+			h256 ret = m_numberIndex->hash(_i);
+			if (ret)
+				return ret;
+		}
+		return queryExtras<BlockHash, uint64_t, ExtraBlockHash>(_i, m_blockHashes, NullBlockHash).value;
+	}
+
+	/// Get the hashes of the canonical blocks numbered [@a _from, @a _to), in order, walking the number index.
+	h256s numberHashes(unsigned _from, unsigned _to) const
+	{
+		h256s ret;
+		uint64_t trusted = trustedNumberIndexSize();
+		if (_from < _to && _from < trusted)
+			m_numberIndex->hashes(_from, std::min<uint64_t>(_to, trusted), ret);
+		for (unsigned n = _from + ret.size(); n < _to; ++n)
+			ret.push_back(numberHash(n));
+		return ret;
+	}
+
+	/// The most canonical hashes updateNumberIndex() appends in one call, besides those of the route.
+	static const unsigned c_numberIndexStep = 1 << 16;
+
+	/// Opens the number index beside the chain's databases and checks its tail against the extras, which
+	/// stay authoritative: what disagrees with them (a crash before flushing, or in the middle of a reorg)
+	/// is dropped. What is missing is left to updateNumberIndex(); numberHash() reads the extras for it.
+	void openNumberIndex()
+	{
+		Guard l(x_numberIndex);
+		try
+		{
+			m_numberIndex.reset(new CanonicalHashIndex(m_dbPath + "/" + toHex(genesisHash().ref().cropped(0, 4)) + "/numberIndex"));
+		}
+		catch (DatabaseError const& _e)
+		{
+			cwarn << "Block number index unavailable:" << _e.what();
+			m_numberIndex.reset();
+			return;
+		}
+		m_numberIndex->truncate(agreeingNumberIndexSize(m_numberIndex->size()));
+		m_numberIndexDirty = true;
+		forgetNumberIndexCheck();
+	}
+
+	/// Brings the number index up to date: drops the entries the canonical chain change @a _r made stale,
+	/// and any above the head or disagreeing with the extras (after rewind(), or a reorg it was not told
+	/// of), and appends the hashes it lacks, up to c_numberIndexStep besides @a _r's, from the extras.
+	/// Called with each import route and, with none, periodically, which also flushes it; a fresh index
+	/// thus fills in steps rather than stalling the first caller.
+	void updateNumberIndex(ImportRoute const& _r = ImportRoute())
+	{
+		Guard l(x_numberIndex);
+		if (!m_numberIndex)
+			return;
+		uint64_t size = m_numberIndex->size();
+		uint64_t firstStale = size;
+		// Zero is what an unknown block's details give; the genesis block is never on a route.
+		for (h256s const* route: {&_r.deadBlocks, &_r.liveBlocks})
+			for (h256 const& h: *route)
+				if (unsigned n = number(h))
+					firstStale = std::min<uint64_t>(firstStale, n);
+		firstStale = agreeingNumberIndexSize(firstStale);
+		if (firstStale < size)
+			m_numberIndex->truncate(firstStale);
+		uint64_t end = std::min<uint64_t>(uint64_t(number()) + 1, firstStale + c_numberIndexStep + _r.liveBlocks.size());
+		for (uint64_t n = m_numberIndex->size(); n < end; ++n)
+		{
+			h256 h = extrasNumberHash(n);
+			if (!h)
+				break;
+			m_numberIndex->set(n, h);
+		}
+		m_numberIndexDirty = m_numberIndexDirty || m_numberIndex->size() != size || firstStale < size;
+		if (_r.liveBlocks.empty() && _r.deadBlocks.empty() && m_numberIndexDirty)
+		{
+			m_numberIndex->flush();
+			m_numberIndexDirty = false;
+		}
+		forgetNumberIndexCheck();
+	}
 
 	/// Get the last N hashes for a given block. (N is determined by the LastHashes type.)
 	LastHashes lastHashes() const { return lastHashes(m_lastBlockHash); }
@@ -183,24 +320,24 @@ public:
 	 * i * (x ^ n) + o * x ^ (n - 1)
 	 */
 	BlocksBlooms blocksBlooms(unsigned _level, unsigned _index) const { return blocksBlooms(chunkId(_level, _index)); }
-	BlocksBlooms blocksBlooms(h256 const& _chunkId) const { return queryExtras<BlocksBlooms, ExtraBlocksBlooms>(_chunkId, m_blocksBlooms, x_blocksBlooms, NullBlocksBlooms); }
+	BlocksBlooms blocksBlooms(h256 const& _chunkId) const { return queryExtras<BlocksBlooms, ExtraBlocksBlooms>(_chunkId, m_blocksBlooms, NullBlocksBlooms); }
 	LogBloom blockBloom(unsigned _number) const { return blocksBlooms(chunkId(0, _number / c_bloomIndexSize)).blooms[_number % c_bloomIndexSize]; }
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest) const;
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest, unsigned _topLevel, unsigned _index) const;
 
 	/// Returns true if transaction is known. Thread-safe
-	bool isKnownTransaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); return !!ta; }
+	bool isKnownTransaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, NullTransactionAddress); return !!ta; }
 
 	/// Get a transaction from its hash. Thread-safe.
-	bytes transaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return bytes(); return transaction(ta.blockHash, ta.index); }
-	std::pair<h256, unsigned> transactionLocation(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return std::pair<h256, unsigned>(h256(), 0); return std::make_pair(ta.blockHash, ta.index); }
+	bytes transaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, NullTransactionAddress); if (!ta) return bytes(); return transaction(ta.blockHash, ta.index); }
+	std::pair<h256, unsigned> transactionLocation(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, NullTransactionAddress); if (!ta) return std::pair<h256, unsigned>(h256(), 0); return std::make_pair(ta.blockHash, ta.index); }
 
 	/// Get a block's transaction (RLP format) for the given block hash (or the most recent mined if none given) & index. Thread-safe.
-	bytes transaction(h256 const& _blockHash, unsigned _i) const { bytes b = block(_blockHash); return RLP(b)[1][_i].data().toBytes(); }
+	bytes transaction(h256 const& _blockHash, unsigned _i) const { auto b = indexedBlock(_blockHash); if (!b || _i >= b->transactions.size()) return bytes(); return b->transaction(_i).toBytes(); }
 	bytes transaction(unsigned _i) const { return transaction(currentHash(), _i); }
 
 	/// Get all transactions from a block.
-	std::vector<bytes> transactions(h256 const& _blockHash) const { bytes b = block(_blockHash); std::vector<bytes> ret; for (auto const& i: RLP(b)[1]) ret.push_back(i.data().toBytes()); return ret; }
+	std::vector<bytes> transactions(h256 const& _blockHash) const { auto b = indexedBlock(_blockHash); std::vector<bytes> ret; if (b) for (size_t i = 0; i < b->transactions.size(); ++i) ret.push_back(b->transaction(i).toBytes()); return ret; }
 	std::vector<bytes> transactions() const { return transactions(currentHash()); }
 
         /// Get a number for the given hash (or the most recent mined if none given). Thread-safe.
@@ -256,19 +393,65 @@ public:
 
 	struct Statistics
 	{
-		unsigned memBlocks;
-		unsigned memDetails;
-		unsigned memLogBlooms;
-		unsigned memReceipts;
-		unsigned memTransactionAddresses;
-		unsigned memBlockHashes;
-		unsigned memTotal() const { return memBlocks + memDetails + memLogBlooms + memReceipts + memTransactionAddresses + memBlockHashes; }
+		unsigned memBlocks = 0;
+		ClockCacheStats details;
+		ClockCacheStats logBlooms;
+		ClockCacheStats receipts;
+		ClockCacheStats transactionAddresses;
+		ClockCacheStats blockHashes;
+		ClockCacheStats blocksBlooms;
+		ExecutedBlockCacheStats executedBlocks;
+		/// As before the caches were bounded: what updateStats() counts of each, in bytes.
+		unsigned memDetails = 0;
+		unsigned memLogBlooms = 0;
+		unsigned memReceipts = 0;
+		unsigned memTransactionAddresses = 0;
+		unsigned memBlockHashes = 0;
+		size_t memTotal() const { return memBlocks + details.bytes + logBlooms.bytes + receipts.bytes + transactionAddresses.bytes + blockHashes.bytes + blocksBlooms.bytes; }
 	};
 
-        /// @returns statistics about memory usage.
-	Statistics usage(bool _freshen = false) const { if (_freshen) updateStats(); return m_lastStats; }
+	/// @returns statistics about memory usage and, for the extras caches, hit ratios. The extras figures
+	/// are always current; @a _freshen recounts the blocks too.
+	Statistics usage(bool _freshen = false) const
+	{
+		if (_freshen)
+			updateStats();
+		Statistics ret = m_lastStats;
+		ret.details = m_details.stats();
+		ret.logBlooms = m_logBlooms.stats();
+		ret.receipts = m_receipts.stats();
+		ret.transactionAddresses = m_transactionAddresses.stats();
+		ret.blockHashes = m_blockHashes.stats();
+		ret.blocksBlooms = m_blocksBlooms.stats();
+		ret.executedBlocks = m_executedBlocks.stats();
+		return ret;
+	}
+
+	/// Sets the byte budgets of the extras caches, evicting what no longer fits.
+	void setCacheBudgets(ChainParams::ExtrasCacheBudgets const& _b)
+	{
+		m_details.setBudget(_b.details);
+		m_blockHashes.setBudget(_b.blockHashes);
+		m_transactionAddresses.setBudget(_b.transactionAddresses);
+		m_logBlooms.setBudget(_b.logBlooms);
+		m_receipts.setBudget(_b.receipts);
+		m_blocksBlooms.setBudget(_b.blocksBlooms);
+	}
+
+	/// Hands the extras written by import() and the like over to the caches, to be evicted as any other.
+	/// To be called between imports, from the thread that imports: an evicted value is read back from
+	/// the database, so whatever was written must be there.
+	void settleExtras()
+	{
+		m_details.settle();
+		m_blockHashes.settle();
+		m_transactionAddresses.settle();
+		m_logBlooms.settle();
+		m_receipts.settle();
+		m_blocksBlooms.settle();
+	}
 
-	/// Deallocate unused data.
+	/// Deallocate unused blocks. The extras caches keep to their budgets by themselves.
 	void garbageCollect(bool _force = false);
 
 	/// Change the function that is called with a bad block.
@@ -297,6 +480,18 @@ public:
 
 	void addBlockCache(Block block, u256 td) const;
 
+	/// Keeps @a _block, executed by this node, so that importing it once sealed need not execute it again.
+	void addExecutedBlock(Block const& _block, u256 const& _tdIncrease) const { m_executedBlocks.insert(_block, _tdIncrease); }
+	/// @returns the block this node executed for @a _sealed, with @a o_tdIncrease, if its state root is
+	/// the sealed block's; null if it has to be enacted. Forgets the executed blocks it supersedes.
+	std::shared_ptr<Block> takeExecutedBlock(BlockHeader const& _sealed, u256& o_tdIncrease) const
+	{
+		auto ret = m_executedBlocks.take(_sealed, o_tdIncrease);
+		if (_sealed.number())
+			m_executedBlocks.prune((unsigned)_sealed.number() - 1);
+		return ret;
+	}
+
 	void checkBlockValid(h256 const& _head, bytes const& _block, Block & _outBlock) const;
 
 private:
@@ -311,30 +506,56 @@ private:
 	/// Finalise everything and close the database.
 	void close();
 
-	template<class T, class K, unsigned N> T queryExtras(K const& _h, std::unordered_map<K, T>& _m, boost::shared_mutex& _x, T const& _n, ldb::DB* _extrasDB = nullptr) const
+	/// Reads an extra: what has been written and not settled, else through its cache. On a miss the
+	/// database is read and the value decoded without holding any lock; only the fill locks, and only the
+	/// one shard of the cache.
+	template<class T, class K, unsigned N> T queryExtras(K const& _h, ExtrasCache<K, T>& _c, T const& _n, ldb::DB* _extrasDB = nullptr) const
 	{
-		{
-			ReadGuard l(_x);
-			auto it = _m.find(_h);
-			if (it != _m.end())
-				return it->second;
-		}
+		T ret;
+		if (!_extrasDB && _c.lookupWritten(_h, ret))
+			return ret;
+		return readExtra<T, K, N>(_h, _c, _n, _extrasDB);
+	}
+
+	/// queryExtras() past the written values; what operator[] loads with, as it runs under the x_* lock.
+	template<class T, class K, unsigned N> T readExtra(K const& _h, ExtrasCache<K, T>& _c, T const& _n, ldb::DB* _extrasDB = nullptr) const
+	{
+		T ret;
+		if (_c.lookup(_h, ret))
+			return ret;
 
 		std::string s;
+		uint64_t generation = _c.generation();
 		(_extrasDB ? _extrasDB : m_extrasDB)->Get(m_readOptions, toSlice(_h, N), &s);
 		if (s.empty())
 			return _n;
 
-		noteUsed(_h, N);
+		ret = T(RLP(s));
+		_c.fill(_h, ret, generation);
+		return ret;
+	}
 
-		WriteGuard l(_x);
-		auto ret = _m.insert(std::make_pair(_h, T(RLP(s))));
-		return ret.first->second;
+	template<class T, unsigned N> T queryExtras(h256 const& _h, ExtrasCache<h256, T>& _c, T const& _n, ldb::DB* _extrasDB = nullptr) const
+	{
+		return queryExtras<T, h256, N>(_h, _c, _n, _extrasDB);
 	}
 
-	template<class T, unsigned N> T queryExtras(h256 const& _h, std::unordered_map<h256, T>& _m, boost::shared_mutex& _x, T const& _n, ldb::DB* _extrasDB = nullptr) const
+	/// As above, for callers that still pass the cache's lock; the caches lock by themselves now.
+	template<class T, class K, unsigned N> T queryExtras(K const& _h, ExtrasCache<K, T>& _c, SharedMutex&, T const& _n, ldb::DB* _extrasDB = nullptr) const
 	{
-		return queryExtras<T, h256, N>(_h, _m, _x, _n, _extrasDB);
+		return queryExtras<T, K, N>(_h, _c, _n, _extrasDB);
+	}
+
+	template<class T, unsigned N> T queryExtras(h256 const& _h, ExtrasCache<h256, T>& _c, SharedMutex&, T const& _n, ldb::DB* _extrasDB = nullptr) const
+	{
+		return queryExtras<T, h256, N>(_h, _c, _n, _extrasDB);
+	}
+
+	/// What an extras cache's operator[] reads a value not yet written with: readExtra(), which does not
+	/// take the x_* lock its writer holds.
+	template<class T, class K, unsigned N> typename ExtrasCache<K, T>::Loader extrasLoader(ExtrasCache<K, T>& _c, T const& _n) const
+	{
+		return [this, &_c, &_n](K const& _k) { return readExtra<T, K, N>(_k, _c, _n); };
 	}
 
 	void checkConsistency();
@@ -342,24 +563,87 @@ private:
 	/// Clears all caches from the tip of the chain up to (including) _firstInvalid.
 	/// These include the blooms, the block hashes and the transaction lookup tables.
 	void clearCachesDuringChainReversion(unsigned _firstInvalid);
+
+	/// How many of the number index's first @a _size entries, at most, agree with the extras: walks back
+	/// from the head, or the end, to the first that does. The caller holds x_numberIndex.
+	uint64_t agreeingNumberIndexSize(uint64_t _size) const
+	{
+		uint64_t n = std::min<uint64_t>(_size, uint64_t(number()) + 1);
+		while (n && m_numberIndex->hash(n - 1) != extrasNumberHash(n - 1))
+			--n;
+		return n;
+	}
+
+	/// How many of the number index's entries numberHash() may use at the current head: those up to the
+	/// head if the last of them is the extras' hash for its number (the ones below being its ancestors),
+	/// otherwise none, until updateNumberIndex() has caught up with a reorg or rewind() the index was not
+	/// told of. One extras read each time the head changes.
+	uint64_t trustedNumberIndexSize() const
+	{
+		if (!m_numberIndex)
+			return 0;
+		h256 head = currentHash();
+		{
+			ReadGuard l(x_numberIndexCheck);
+			if (m_numberIndexCheckedHead == head)
+				return m_numberIndexTrusted;
+		}
+		uint64_t n = std::min<uint64_t>(m_numberIndex->size(), uint64_t(number()) + 1);
+		uint64_t trusted = n && m_numberIndex->hash(n - 1) == extrasNumberHash(n - 1) ? n : 0;
+		WriteGuard l(x_numberIndexCheck);
+		m_numberIndexCheckedHead = head;
+		m_numberIndexTrusted = trusted;
+		return trusted;
+	}
+	void forgetNumberIndexCheck() { WriteGuard l(x_numberIndexCheck); m_numberIndexCheckedHead = h256(); }
+
+	/// The canonical hash of block @a _n as the extras database has it, read directly rather than through
+	/// m_blockHashes, so that filling the number index does not flush the cache.
+	h256 extrasNumberHash(uint64_t _n) const
+	{
+		if (!_n)
+			return genesisHash();
+		std::string s;
+		m_extrasDB->Get(m_readOptions, toSlice(_n, ExtraBlockHash), &s);
+		return s.empty() ? h256() : BlockHash(RLP(s)).value;
+	}
 	void clearBlockBlooms(unsigned _begin, unsigned _end);
 
-	/// The caches of the disk DB and their locks.
+	/// The caches of the disk DB. Each extras cache keeps what writers set through operator[] (under its
+	/// x_* lock, as before) until settleExtras(), and a ClockCache of the rest that locks by shard and
+	/// evicts to stay within its budget (the default until setCacheBudgets()). Readers take the x_* lock
+	/// only while there are written values not yet settled.
 	mutable SharedMutex x_blocks;
 	mutable BlocksHash m_blocks;
 	mutable SharedMutex x_details;
-	mutable BlockDetailsHash m_details;
+	mutable BlockDetailsCache m_details{x_details, ChainParams::ExtrasCacheBudgets().details, extrasLoader<BlockDetails, h256, ExtraDetails>(m_details, NullBlockDetails)};
 	mutable SharedMutex x_logBlooms;
-	mutable BlockLogBloomsHash m_logBlooms;
+	mutable BlockLogBloomsCache m_logBlooms{x_logBlooms, ChainParams::ExtrasCacheBudgets().logBlooms, extrasLoader<BlockLogBlooms, h256, ExtraLogBlooms>(m_logBlooms, NullBlockLogBlooms)};
 	mutable SharedMutex x_receipts;
-	mutable BlockReceiptsHash m_receipts;
+	mutable BlockReceiptsCache m_receipts{x_receipts, ChainParams::ExtrasCacheBudgets().receipts, extrasLoader<BlockReceipts, h256, ExtraReceipts>(m_receipts, NullBlockReceipts)};
 	mutable SharedMutex x_transactionAddresses;
-	mutable TransactionAddressHash m_transactionAddresses;
+	mutable TransactionAddressCache m_transactionAddresses{x_transactionAddresses, ChainParams::ExtrasCacheBudgets().transactionAddresses, extrasLoader<TransactionAddress, h256, ExtraTransactionAddress>(m_transactionAddresses, NullTransactionAddress)};
 	mutable SharedMutex x_blockHashes;
-	mutable BlockHashHash m_blockHashes;
+	mutable BlockHashCache m_blockHashes{x_blockHashes, ChainParams::ExtrasCacheBudgets().blockHashes, extrasLoader<BlockHash, uint64_t, ExtraBlockHash>(m_blockHashes, NullBlockHash)};
 	mutable SharedMutex x_blocksBlooms;
-	mutable BlocksBloomsHash m_blocksBlooms;
-
+	mutable BlocksBloomsCache m_blocksBlooms{x_blocksBlooms, ChainParams::ExtrasCacheBudgets().blocksBlooms, extrasLoader<BlocksBlooms, h256, ExtraBlocksBlooms>(m_blocksBlooms, NullBlocksBlooms)};
+
+	/// Canonical hash by block number; null if it could not be opened. Writers hold x_numberIndex.
+	Mutex x_numberIndex;
+	std::unique_ptr<CanonicalHashIndex> m_numberIndex;
+	bool m_numberIndexDirty = false;		///< Changed since it was last flushed.
+	/// The head at which trustedNumberIndexSize() last checked the index, and what it found.
+	mutable SharedMutex x_numberIndexCheck;
+	mutable h256 m_numberIndexCheckedHead;
+	mutable uint64_t m_numberIndexTrusted = 0;
+
+	/// Recently indexed blocks, oldest first in m_indexedOrder.
+	static const size_t c_maxIndexedBlocks = 64;
+	mutable SharedMutex x_indexedBlocks;
+	mutable std::unordered_map<h256, std::shared_ptr<IndexedBlock const>> m_indexedBlocks;
+	mutable std::deque<h256> m_indexedOrder;
+
+	/// What garbageCollect() used to age the unbounded caches by; the extras caches evict by themselves.
 	using CacheID = std::pair<h256, unsigned>;
 	mutable Mutex x_cacheUsage;
 	mutable std::deque<std::unordered_set<CacheID>> m_cacheUsage;
@@ -380,7 +664,7 @@ private:
 	ldb::DB* m_extrasDB;
 
 	/// Hash of the last (valid) block on the longest chain.
-	mutable boost::shared_mutex x_lastBlockHash;
+	mutable SharedMutex x_lastBlockHash;
 	h256 m_lastBlockHash;
 	unsigned m_lastBlockNumber = 0;
 
@@ -403,6 +687,9 @@ private:
 	mutable SharedMutex  x_blockcache;
 	mutable std::map<h256, std::pair<Block, u256> > m_blockCache;
 
+	/// Blocks executed here, for Block::enactOn() to take rather than enact again; see ExecutedBlockCache.
+	mutable ExecutedBlockCache m_executedBlocks;
+
 	friend std::ostream& operator<<(std::ostream& _out, BlockChain const& _bc); 
 };
 std::ostream& operator<<(std::ostream& _out, BlockChain const& _bc);
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <unordered_map>
+#include <libdevcore/ClockCache.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/RLP.h>
 #include "TransactionReceipt.h"
@@ -96,6 +99,146 @@ using TransactionAddressHash = std::unordered_map<h256, TransactionAddress>;
 using BlockHashHash = std::unordered_map<uint64_t, BlockHash>;
 using BlocksBloomsHash = std::unordered_map<h256, BlocksBlooms>;
 
+/// Rough memory taken by an extra once decoded, against which BlockChain's cache budgets are kept.
+struct ExtrasCost
+{
+	size_t operator()(BlockDetails const& _d) const { return sizeof(_d) + _d.children.size() * sizeof(h256); }
+	size_t operator()(BlockLogBlooms const& _b) const { return sizeof(_b) + _b.blooms.size() * sizeof(LogBloom); }
+	size_t operator()(BlocksBlooms const& _b) const { return sizeof(_b); }
+	size_t operator()(BlockReceipts const& _r) const
+	{
+		size_t ret = sizeof(_r) + _r.receipts.size() * sizeof(TransactionReceipt);
+		for (TransactionReceipt const& r: _r.receipts)
+			for (LogEntry const& l: r.log())
+				ret += sizeof(l) + l.topics.size() * sizeof(h256) + l.data.size();
+		return ret;
+	}
+	size_t operator()(BlockHash const& _h) const { return sizeof(_h); }
+	size_t operator()(TransactionAddress const& _a) const { return sizeof(_a); }
+};
+
+/**
+ * @brief One kind of BlockChain extra: the values written since they were last settled, and a
+ * read-through ClockCache of the rest.
+ *
+ * Writers hold the extra's x_* lock for writing, as they did over the map this replaces, and update
+ * values in place through operator[]; erase(), clear() and count() also want it held. A written value
+ * is authoritative until settle(): it is never evicted, whatever the budget, so the write batch built
+ * from it (`m_details[h].rlp()`) carries what was written. settle(), once the values are in the
+ * database, hands them over to the ClockCache.
+ *
+ * Readers look among the written values, with the x_* lock shared, only while there are any; otherwise
+ * a hit costs the ClockCache's shared shard lock and nothing more.
+ */
+template <class K, class V>
+class ExtrasCache
+{
+public:
+	/// Reads a value that has not been written from the database, for operator[].
+	using Loader = std::function<V(K const&)>;
+
+	ExtrasCache(SharedMutex& _x, size_t _budget, Loader const& _load): m_x(_x), m_cache(_budget), m_load(_load) {}
+
+	/// The value of @a _k for writing, read through the Loader if it has not been written yet.
+	V& operator[](K const& _k)
+	{
+		auto it = m_written.find(_k);
+		if (it == m_written.end())
+		{
+			it = m_written.emplace(_k, m_load(_k)).first;
+			m_writtenCount.store(m_written.size(), std::memory_order_release);
+		}
+		return it->second;
+	}
+
+	size_t count(K const& _k) const { return m_written.count(_k) + m_cache.count(_k); }
+
+	void erase(K const& _k)
+	{
+		m_written.erase(_k);
+		m_writtenCount.store(m_written.size(), std::memory_order_release);
+		evict(_k);
+	}
+
+	void clear()
+	{
+		m_written.clear();
+		m_writtenCount.store(0, std::memory_order_release);
+		evictAll();
+	}
+
+	/// Moves the written values into the ClockCache. Takes the x_* lock; only for once they are in the
+	/// database, since they may be evicted and read back from there.
+	void settle()
+	{
+		WriteGuard l(m_x);
+		++m_generation;
+		for (auto const& i: m_written)
+			m_cache.insert(i.first, i.second);
+		m_written.clear();
+		m_writtenCount.store(0, std::memory_order_release);
+	}
+
+	/// @returns true and sets @a o_value if @a _k has been written and not settled. Lock-free while
+	/// nothing is.
+	bool lookupWritten(K const& _k, V& o_value) const
+	{
+		if (!m_writtenCount.load(std::memory_order_acquire))
+			return false;
+		ReadGuard l(m_x);
+		auto it = m_written.find(_k);
+		if (it == m_written.end())
+			return false;
+		o_value = it->second;
+		return true;
+	}
+
+	/// @returns true and sets @a o_value if @a _k is in the ClockCache.
+	bool lookup(K const& _k, V& o_value) const { return m_cache.lookup(_k, o_value); }
+
+	/// What to pass fill() with a value read from the database.
+	uint64_t generation() const { return m_generation.load(std::memory_order_acquire); }
+	/// Caches @a _v, read from the database after generation() returned @a _generation, unless it has
+	/// been settled over or evicted since, in which case it may be stale.
+	void fill(K const& _k, V const& _v, uint64_t _generation) { m_cache.insertIf(_k, _v, [&]() { return m_generation.load(std::memory_order_acquire) == _generation; }); }
+
+	/// Drops @a _k from the ClockCache, but not from the written values; needs no lock.
+	void evict(K const& _k) { ++m_generation; m_cache.erase(_k); }
+	void evictAll() { ++m_generation; m_cache.clear(); }
+
+	void setBudget(size_t _budget) { m_cache.setBudget(_budget); }
+	size_t budget() const { return m_cache.budget(); }
+
+	/// The ClockCache's statistics, with the written values counted among its entries and bytes.
+	ClockCacheStats stats() const
+	{
+		ClockCacheStats ret = m_cache.stats();
+		if (m_writtenCount.load(std::memory_order_acquire))
+		{
+			ReadGuard l(m_x);
+			ret.entries += m_written.size();
+			for (auto const& i: m_written)
+				ret.bytes += ExtrasCost()(i.second);
+		}
+		return ret;
+	}
+
+private:
+	SharedMutex& m_x;
+	std::unordered_map<K, V> m_written;
+	std::atomic<size_t> m_writtenCount{0};		///< m_written.size(), for readers not to lock while it is empty.
+	std::atomic<uint64_t> m_generation{0};		///< Bumped whenever the ClockCache may hold stale values.
+	ClockCache<K, V, ExtrasCost> m_cache;
+	Loader m_load;
+};
+
+using BlockDetailsCache = ExtrasCache<h256, BlockDetails>;
+using BlockLogBloomsCache = ExtrasCache<h256, BlockLogBlooms>;
+using BlockReceiptsCache = ExtrasCache<h256, BlockReceipts>;
+using TransactionAddressCache = ExtrasCache<h256, TransactionAddress>;
+using BlockHashCache = ExtrasCache<uint64_t, BlockHash>;
+using BlocksBloomsCache = ExtrasCache<h256, BlocksBlooms>;
+
 static const BlockDetails NullBlockDetails;
 static const BlockLogBlooms NullBlockLogBlooms;
 static const BlockReceipts NullBlockReceipts;
@@ -6,6 +6,7 @@
 #include <boost/thread.hpp>
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
+#include <libdevcore/MemoryAccounting.h>
 #include <libethcore/Common.h>
 #include <libdevcore/Guards.h>
 #include <libethcore/Common.h>
@@ -50,6 +51,8 @@ template<class T>
 class SizedBlockQueue
 {
 public:
+	~SizedBlockQueue() { releaseMemory(MemoryTag::BlockQueue, m_size); }
+
 	std::size_t count() const { return m_queue.size(); }
 
 	std::size_t size() const { return m_size; }
@@ -63,13 +66,13 @@ public:
 	void clear()
 	{
 		m_queue.clear();
-		m_size = 0;
+		releaseMemory(MemoryTag::BlockQueue, m_size.exchange(0));
 	}
 
 	void enqueue(T&& _t)
 	{
 		m_queue.emplace_back(std::move(_t));
-		m_size += m_queue.back().blockData.size();
+		grow(m_queue.back().blockData.size());
 	}
 
 	T dequeue()
@@ -77,7 +80,7 @@ public:
 		T t;
 		std::swap(t, m_queue.front());
 		m_queue.pop_front();
-		m_size -= t.blockData.size();
+		shrink(t.blockData.size());
 
 		return t;
 	}
@@ -108,14 +111,18 @@ public:
 		if (it == m_queue.end())
 			return false;
 
-		m_size -= it->blockData.size();
-		m_size += _t.blockData.size();
+		shrink(it->blockData.size());
+		grow(_t.blockData.size());
 		*it = std::move(_t);
 
 		return true;
 	}
 
 private:
+	/// Keeps the size and the memory charged to the block queue in step.
+	void grow(size_t _bytes) { m_size += _bytes; chargeMemory(MemoryTag::BlockQueue, _bytes); }
+	void shrink(size_t _bytes) { m_size -= _bytes; releaseMemory(MemoryTag::BlockQueue, _bytes); }
+
 	static std::function<bool(T const&)> sha3UnclesEquals(h256 const& _hash)
 	{
 		return [&_hash](T const& _t) { return _t.verified.info.sha3Uncles() == _hash; };
@@ -126,7 +133,7 @@ private:
 		std::vector<T> ret(std::make_move_iterator(_begin), std::make_move_iterator(_end));
 
 		for (auto it = ret.begin(); it != ret.end(); ++it)
-			m_size -= it->blockData.size();
+			shrink(it->blockData.size());
 
 		m_queue.erase(_begin, _end);
 		return ret;
@@ -140,6 +147,8 @@ template<class KeyType>
 class SizedBlockMap
 {
 public:
+	~SizedBlockMap() { releaseMemory(MemoryTag::BlockQueue, m_size); }
+
 	std::size_t count() const { return m_map.size(); }
 
 	std::size_t size() const { return m_size; }
@@ -151,15 +160,18 @@ public:
 	void clear()
 	{
 		m_map.clear();
-		m_size = 0;
+		releaseMemory(MemoryTag::BlockQueue, m_size.exchange(0));
 	}
 
 	void insert(KeyType const& _key, h256 const& _hash, bytes&& _blockData)
 	{
+		// Take the size before the data is moved out.
+		size_t size = _blockData.size();
 		auto hashAndBlock = std::make_pair(_hash, std::move(_blockData));
 		auto keyAndValue = std::make_pair(_key, std::move(hashAndBlock));
 		m_map.insert(std::move(keyAndValue));
-		m_size += _blockData.size();
+		m_size += size;
+		chargeMemory(MemoryTag::BlockQueue, size);
 	}
 
 	std::vector<std::pair<h256, bytes>> removeByKeyEqual(KeyType const& _key)
@@ -187,6 +199,7 @@ private:
 		}
 
 		m_size -= removedSize;
+		releaseMemory(MemoryTag::BlockQueue, removedSize);
 		m_map.erase(_begin, _end);
 
 		return removed;
@@ -275,7 +288,7 @@ private:
 
 	BlockChain const* m_bc;												///< The blockchain into which our imports go.
 
-	mutable boost::shared_mutex m_lock;									///< General lock for the sets, m_future and m_unknown.
+	mutable SharedMutex m_lock;									///< General lock for the sets, m_future and m_unknown.
 	h256Hash m_drainingSet;												///< All blocks being imported.
 	h256Hash m_readySet;												///< All blocks ready for chain import.
 	h256Hash m_unknownSet;												///< Set of all blocks whose parents are not ready/in-chain.
@@ -0,0 +1,171 @@
+#include "CanonicalHashIndex.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DEV_HAVE_MMAP 1
+#endif
+#include <libdevcore/CommonData.h>
+#include <libdevcore/Log.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+static char const c_magic[8] = {'X', 'C', 'N', 'U', 'M', 'I', 'X', '1'};
+static const uint64_t c_countOffset = 8;		///< Where the entry count lives in the header.
+
+}
+
+CanonicalHashIndex::CanonicalHashIndex(string const& _path, uint64_t _reserve):
+	m_path(_path),
+	m_reserve(_reserve)
+{
+#if DEV_HAVE_MMAP
+	m_fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (m_fd < 0)
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot open " + _path + ": " + strerror(errno)));
+	struct stat st;
+	if (fstat(m_fd, &st) != 0)
+	{
+		::close(m_fd);
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot stat " + _path));
+	}
+	m_fileSize = st.st_size;
+	if (m_fileSize > m_reserve)
+	{
+		::close(m_fd);
+		BOOST_THROW_EXCEPTION(DatabaseError(_path + " is larger than the reserved mapping"));
+	}
+
+	void* m = mmap(nullptr, m_reserve, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, m_fd, 0);
+	if (m == MAP_FAILED)
+	{
+		::close(m_fd);
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot map " + _path + ": " + strerror(errno)));
+	}
+	m_map = (byte*)m;
+
+	if (m_fileSize == 0)
+	{
+		ensureEntries(0);
+		memcpy(m_map, c_magic, sizeof(c_magic));
+		storeCount(0);
+	}
+	else
+	{
+		uint64_t count;
+		memcpy(&count, m_map + c_countOffset, sizeof(count));
+		if (m_fileSize < c_headerSize || memcmp(m_map, c_magic, sizeof(c_magic)) || c_headerSize + count * h256::size > m_fileSize)
+		{
+			munmap(m_map, m_reserve);
+			::close(m_fd);
+			BOOST_THROW_EXCEPTION(DatabaseError(_path + " is not a block number index"));
+		}
+		m_count = count;
+		m_published = count;
+	}
+#else
+	BOOST_THROW_EXCEPTION(DatabaseError("CanonicalHashIndex is not supported on this platform"));
+#endif
+}
+
+CanonicalHashIndex::~CanonicalHashIndex()
+{
+#if DEV_HAVE_MMAP
+	if (m_map)
+	{
+		flush();
+		munmap(m_map, m_reserve);
+	}
+	if (m_fd >= 0)
+		::close(m_fd);
+#endif
+}
+
+size_t CanonicalHashIndex::hashes(uint64_t _from, uint64_t _to, h256s& o_hashes) const
+{
+	while (true)
+	{
+		size_t old = o_hashes.size();
+		uint64_t seq = m_seq.load(memory_order_acquire);
+		if (seq & 1)
+			continue;
+		uint64_t to = min(_to, m_count.load(memory_order_acquire));
+		if (_from >= to)
+			return 0;
+		o_hashes.resize(old + to - _from);
+		memcpy(o_hashes[old].data(), entry(_from), (to - _from) * h256::size);
+		atomic_thread_fence(memory_order_acquire);
+		if (m_seq.load(memory_order_relaxed) == seq)
+			return to - _from;
+		o_hashes.resize(old);
+	}
+}
+
+void CanonicalHashIndex::set(uint64_t _number, h256 const& _hash)
+{
+	Guard l(x_write);
+	uint64_t count = m_count.load(memory_order_relaxed);
+	if (_number > count)
+		BOOST_THROW_EXCEPTION(DatabaseError(m_path + ": block " + toString(_number) + " set with only " + toString(count) + " indexed"));
+	ensureEntries(_number + 1);
+	if (_number < m_published)
+	{
+		// Readers that saw a longer index may be reading the entry we are about to overwrite: make them retry.
+		uint64_t seq = m_seq.load(memory_order_relaxed);
+		m_seq.store(seq + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		m_count.store(_number, memory_order_relaxed);
+		memcpy(entry(_number), _hash.data(), h256::size);
+		m_seq.store(seq + 2, memory_order_release);
+	}
+	else
+		memcpy(entry(_number), _hash.data(), h256::size);
+	m_count.store(_number + 1, memory_order_release);
+	m_published = max(m_published, _number + 1);
+	storeCount(_number + 1);
+}
+
+void CanonicalHashIndex::truncate(uint64_t _count)
+{
+	Guard l(x_write);
+	if (_count < m_count.load(memory_order_relaxed))
+	{
+		m_count.store(_count, memory_order_release);
+		storeCount(_count);
+	}
+}
+
+void CanonicalHashIndex::flush()
+{
+#if DEV_HAVE_MMAP
+	Guard l(x_write);
+	msync(m_map, c_headerSize + m_count.load(memory_order_relaxed) * h256::size, MS_SYNC);
+#endif
+}
+
+void CanonicalHashIndex::ensureEntries(uint64_t _count)
+{
+#if DEV_HAVE_MMAP
+	uint64_t size = c_headerSize + _count * h256::size;
+	if (size <= m_fileSize)
+		return;
+	if (size > m_reserve)
+		BOOST_THROW_EXCEPTION(DatabaseError(m_path + " is full (reserve of " + toString(m_reserve) + " bytes)"));
+	uint64_t grown = min(m_reserve, c_headerSize + (_count + c_growEntries - 1) / c_growEntries * c_growEntries * h256::size);
+	if (ftruncate(m_fd, grown) != 0)
+		BOOST_THROW_EXCEPTION(DatabaseError("Cannot grow " + m_path + ": " + strerror(errno)));
+	m_fileSize = grown;
+#else
+	(void)_count;
+#endif
+}
+
+void CanonicalHashIndex::storeCount(uint64_t _count)
+{
+	memcpy(m_map + c_countOffset, &_count, sizeof(_count));
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <libdevcore/Common.h>
+#include <libdevcore/DatabaseFace.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Dense, memory-mapped array of the canonical block hashes, indexed by block number.
+ *
+ * The file is a 64-byte header (magic and entry count) followed by one 32-byte hash per block number
+ * from 0. It is mapped once into a reserved address range and grown in steps underneath, so an entry
+ * never moves and a lookup is an array read with no lock: appends publish themselves by bumping the
+ * count after the hash is written, and the rarer rewrites of entries readers may have seen (after
+ * truncate() or set() below the end, on chain reversion) are bracketed by a sequence counter that
+ * readers check, seqlock style.
+ *
+ * The array is derived data; the extras database stays authoritative. The count in the header is
+ * only made durable by flush(), so after a crash the tail may be short or stale and has to be checked
+ * against the extras on open.
+ */
+class CanonicalHashIndex
+{
+public:
+	/// Address space reserved for the mapping: 2^31 blocks.
+	static const uint64_t c_defaultReserve = uint64_t(1) << 36;
+	/// The file grows by this many entries at a time.
+	static const uint64_t c_growEntries = 1 << 20;
+
+	/// Opens, creating if missing, the index file at @a _path. Throws DatabaseError on failure.
+	explicit CanonicalHashIndex(std::string const& _path, uint64_t _reserve = c_defaultReserve);
+	~CanonicalHashIndex();
+	CanonicalHashIndex(CanonicalHashIndex const&) = delete;
+	CanonicalHashIndex& operator=(CanonicalHashIndex const&) = delete;
+
+	/// The number of entries, i.e. one past the highest block number indexed.
+	uint64_t size() const { return m_count.load(std::memory_order_acquire); }
+
+	/// @returns the hash at @a _number, or a null hash if it is not indexed.
+	h256 hash(uint64_t _number) const
+	{
+		h256 ret;
+		while (true)
+		{
+			uint64_t seq = m_seq.load(std::memory_order_acquire);
+			if (seq & 1)
+				continue;
+			if (_number >= m_count.load(std::memory_order_acquire))
+				return h256();
+			memcpy(ret.data(), entry(_number), h256::size);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (m_seq.load(std::memory_order_relaxed) == seq)
+				return ret;
+		}
+	}
+
+	/// Copies the hashes of blocks [@a _from, @a _to) into @a o_hashes, in order; stops early at the end
+	/// of the index. @returns how many were copied.
+	size_t hashes(uint64_t _from, uint64_t _to, h256s& o_hashes) const;
+
+	/// Sets the hash at @a _number, which must be at most size(). Below size(), everything from
+	/// @a _number on is dropped first, as a new branch takes over from there.
+	void set(uint64_t _number, h256 const& _hash);
+	/// Drops the entries from @a _count on.
+	void truncate(uint64_t _count);
+
+	/// Writes the mapping and the header to disk.
+	void flush();
+
+private:
+	static const uint64_t c_headerSize = 64;
+
+	byte const* entry(uint64_t _number) const { return m_map + c_headerSize + _number * h256::size; }
+	byte* entry(uint64_t _number) { return m_map + c_headerSize + _number * h256::size; }
+	void ensureEntries(uint64_t _count);
+	/// Writes the count to the header.
+	void storeCount(uint64_t _count);
+
+	std::string m_path;
+	int m_fd = -1;
+	byte* m_map = nullptr;
+	uint64_t m_reserve;
+	uint64_t m_fileSize = 0;
+
+	Mutex x_write;						///< Serialises writers.
+	std::atomic<uint64_t> m_count{0};
+	std::atomic<uint64_t> m_seq{0};		///< Odd while an entry readers may have seen is being rewritten.
+	uint64_t m_published = 0;			///< The highest count readers may have seen; entries below it are rewritten under m_seq.
+};
+
+}
+}
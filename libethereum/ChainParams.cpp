@@ -50,6 +50,21 @@ ChainParams ChainParams::loadConfig(string const& _json, h256 const& _stateRoot)
 	string genesisStr = json_spirit::write_string(obj["genesis"], false);
 	cp.dataDir = obj.count("datadir") ? obj["datadir"].get_str() : "/tmp/ethereum/data/";
 	cp.broadcastToNormalNode = obj.count("broadcastToNormalNode") ? ( (obj["broadcastToNormalNode"].get_str() == "ON") ? true : false) : false;
+	if (obj.count("extrasCache"))
+	{
+		js::mObject cache = obj["extrasCache"].get_obj();
+		auto budget = [&](char const* _name, size_t& o_bytes) { if (cache.count(_name)) o_bytes = (size_t)cache[_name].get_int() << 20; };
+		budget("details", cp.extrasCache.details);
+		budget("blockHashes", cp.extrasCache.blockHashes);
+		budget("transactionAddresses", cp.extrasCache.transactionAddresses);
+		budget("logBlooms", cp.extrasCache.logBlooms);
+		budget("receipts", cp.extrasCache.receipts);
+		budget("blocksBlooms", cp.extrasCache.blocksBlooms);
+	}
+	if (obj.count("stateCache"))
+		cp.stateCache = (size_t)obj["stateCache"].get_int() << 20;
+	cp.lockProfiling = obj.count("lockProfiling") ? obj["lockProfiling"].get_bool() : false;
+	cp.asyncLog = obj.count("asyncLog") ? (size_t)obj["asyncLog"].get_int() : 0;
 	cp = cp.loadGenesis(genesisStr, _stateRoot);
 	// genesis state
 	string genesisStateStr = json_spirit::write_string(obj["accounts"], false);
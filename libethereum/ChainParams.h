@@ -37,6 +37,27 @@ struct ChainParams: public ChainOperationParams
         unsigned sealFields = 0;
 	bytes sealRLP;
 
+	/// Byte budgets of BlockChain's caches of decoded block extras. Zero turns a cache off.
+	struct ExtrasCacheBudgets
+	{
+		size_t details = 16 << 20;
+		size_t blockHashes = 4 << 20;
+		size_t transactionAddresses = 16 << 20;
+		size_t logBlooms = 16 << 20;
+		size_t receipts = 64 << 20;
+		size_t blocksBlooms = 8 << 20;
+	};
+	/// Set from the optional "extrasCache" object of the config, in MB per cache, e.g. { "receipts": 256 }.
+	ExtrasCacheBudgets extrasCache;
+	/// Byte budget of the state database's cache of committed trie nodes, from the optional "stateCache"
+	/// of the config, in MB. Zero turns it off.
+	size_t stateCache = 64 << 20;
+	/// From the optional "lockProfiling" of the config: record lock waits and log the worst sites once a minute.
+	bool lockProfiling = false;
+	/// Records per logging thread of the async log, from the optional "asyncLog" of the config. Zero logs
+	/// on the calling thread, as before.
+	size_t asyncLog = 0;
+
 	h256 calculateStateRoot(bool _force = false) const;
 
 	/// Genesis block info.
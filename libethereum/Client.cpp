@@ -3,7 +3,9 @@
 #include <memory>
 #include <thread>
 #include <boost/filesystem.hpp>
+#include <libdevcore/AsyncLog.h>
 #include <libdevcore/Log.h>
+#include <libdevcore/MemoryAccounting.h>
 #include <libp2p/Host.h>
 #include "Defaults.h"
 #include "Executive.h"
@@ -59,16 +61,31 @@ Client::Client(
 Client::~Client()
 {
 	stopWorking();
+	m_stateDB.stopPriming();
+	// Last, so that what the worker logged on its way out is written too.
+	if (m_asyncLogging)
+		stopAsyncLogging();
 }
 
 void Client::init(p2p::Host* _extNet, std::string const& _dbPath, WithExisting _forceAction, u256 _networkId)
 {
 	DEV_TIMED_FUNCTION_ABOVE(500);
 
+	bc().setCacheBudgets(bc().chainParams().extrasCache);
+	if (bc().chainParams().lockProfiling)
+		g_lockProfiling = true;
+	if (bc().chainParams().asyncLog && !isAsyncLogging())
+	{
+		startAsyncLogging(bc().chainParams().asyncLog);
+		m_asyncLogging = true;
+	}
+	bc().openNumberIndex();
+
 	// Cannot be opened until after blockchain is open, since BlockChain may upgrade the database.
 	// TODO: consider returning the upgrade mechanism here. will delaying the opening of the blockchain database
 	// until after the construction.
 	m_stateDB = State::openDB(_dbPath, bc().genesisHash(), _forceAction);
+	prepareStateDB();
 	// LAZY. TODO: move genesis state construction/commiting to stateDB openning and have this just take the root from the genesis block.
 	m_preSeal = bc().genesisBlock(m_stateDB);
 	m_postSeal = m_preSeal;
@@ -210,6 +227,27 @@ void Client::doneWorking()
 	}
 }
 
+void Client::prepareStateDB()
+{
+	m_stateDB.setCacheSize(chainParams().stateCache);
+	// Priming reads every key of the database, so it runs as a background task; until it is done lookups
+	// just go to disk on a miss, as they would without it.
+	m_stateDB.startPriming();
+}
+
+void Client::logDiagnostics()
+{
+	for (MemoryUsage const& u: memoryUsage())
+		clog(ClientNote) << "Memory " << u;
+	if (isAsyncLogging())
+	{
+		AsyncLogStats s = asyncLogStats();
+		clog(ClientNote) << "Async log: " << s.written << " written, " << s.dropped << " dropped";
+	}
+	if (g_lockProfiling)
+		clog(ClientNote) << "Lock contention:\n" << lockContentionReport();
+}
+
 void Client::reopenChain(WithExisting _we)
 {
 	reopenChain(bc().chainParams(), _we);
@@ -236,9 +274,13 @@ void Client::reopenChain(ChainParams const& _p, WithExisting _we)
 		m_postSeal = Block(chainParams().accountStartNonce);
 		m_working = Block(chainParams().accountStartNonce);
 
+		// The priming task holds the database open; it has to let go before the path is opened again.
+		m_stateDB.stopPriming();
 		m_stateDB = OverlayDB();
 		bc().reopen(_p, _we);
+		bc().openNumberIndex();
 		m_stateDB = State::openDB(Defaults::dbPath(), bc().genesisHash(), _we);
+		prepareStateDB();
 
 		m_preSeal = bc().genesisBlock(m_stateDB);
 		m_preSeal.setAuthor(author);
@@ -384,7 +426,13 @@ void Client::syncBlockQueue()
 
 	if (count)
 	{
-		clog(ClientNote) << count << "blocks imported in" << unsigned(elapsed * 1000) << "ms (" << (count / elapsed) << "blocks/s) in #" << bc().number();
+		ImportThroughput imported;
+		imported.blocks = count;
+		imported.transactions = ir.goodTranactions.size();
+		imported.seconds = elapsed;
+		clog(ClientNote) << imported << "in #" << bc().number();
+		DEV_WRITE_GUARDED(x_syncThroughput)
+			m_syncThroughput += imported;
 	}
 
 	if (elapsed > c_targetDuration * 1.1 && count > c_syncMin)
@@ -536,6 +584,7 @@ void Client::onChainChanged(ImportRoute const& _ir)
 {
 //	ctrace << "onChainChanged()";
 	h256Hash changeds;
+	bc().updateNumberIndex(_ir);
 	onDeadBlocks(_ir.deadBlocks, changeds);
 	for (auto const& t: _ir.goodTranactions)
 	{
@@ -686,9 +735,15 @@ void Client::tick()
 		m_report.ticks++;
 		checkWatchGarbage();
 		m_bq.tick();
+		bc().updateNumberIndex();
 		m_lastTick = chrono::system_clock::now();
 		if (m_report.ticks == 15)
 			clog(ClientTrace) << activityReport();
+		if (m_lastTick - m_lastDiagnostics > chrono::minutes(1))
+		{
+			logDiagnostics();
+			m_lastDiagnostics = m_lastTick;
+		}
 	}
 }
 
@@ -708,8 +763,9 @@ void Client::checkWatchGarbage()
 		for (auto i: toUninstall)
 			uninstallWatch(i);
 
-		// blockchain GC
+		// blockchain GC; syncBlockQueue() is done with its writes, so they can go to the caches.
 		bc().garbageCollect();
+		bc().settleExtras();
 
 		m_lastGarbageCollection = chrono::system_clock::now();
 	}
@@ -19,6 +19,7 @@
 #include "Block.h"
 #include "CommonNet.h"
 #include "ClientBase.h"
+#include "ImportThroughput.h"
 
 namespace dev
 {
@@ -114,6 +115,9 @@ public:
 	TransactionQueue::Status transactionQueueStatus() const { return m_tq.status(); }
 	TransactionQueue::Limits transactionQueueLimits() const { return m_tq.limits(); }
 
+	/// Blocks and transactions imported from the block queue so far, and the time spent on it.
+	ImportThroughput syncThroughput() const { ReadGuard l(x_syncThroughput); return m_syncThroughput; }
+
 	/// Freeze worker thread and sync some of the block queue.
 	std::tuple<ImportRoute, bool, unsigned> syncQueue(unsigned _max = 1);
 
@@ -222,6 +226,14 @@ protected:
 	/// Called when Worker is exiting.
 	void doneWorking() override;
 
+	/// Sizes the freshly opened m_stateDB's node cache from the chain params and starts priming its existence
+	/// filter, which reopenChain() and the destructor stop.
+	void prepareStateDB();
+
+	/// Logs the diagnostics: memory use by tag, the async log's counts when it is on, and lock contention when lock profiling is on.
+	/// Called by tick() once a minute.
+	void logDiagnostics();
+
 	/// Called when wouldSeal(), pendingTransactions() have changed.
 	void rejigSealing();
 
@@ -300,8 +312,13 @@ protected:
 											///< When did we last both doing GC on the watches?
 	mutable std::chrono::system_clock::time_point m_lastTick = std::chrono::system_clock::now();
 											///< When did we last tick()?
+	std::chrono::system_clock::time_point m_lastDiagnostics = std::chrono::system_clock::now();
+											///< When did tick() last log the diagnostics?
+	bool m_asyncLogging = false;			///< Whether init() started async logging, for the destructor to stop.
 
 	unsigned m_syncAmount = 50;				///< Number of blocks to sync in each go.
+	mutable SharedMutex x_syncThroughput;
+	ImportThroughput m_syncThroughput;		///< What syncBlockQueue() has imported.
 
 	ActivityReport m_report;
 
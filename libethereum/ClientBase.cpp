@@ -235,18 +235,19 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 	end = min(end, (unsigned)numberFromHash(ancestor) + 1);
 
 	// Handle blocks from main chain
-	set<unsigned> matchingBlocks;
 	if (!_f.isRangeFilter())
+	{
+		set<unsigned> matchingBlocks;
 		for (auto const& i: _f.bloomPossibilities())
 			for (auto u: bc().withBlockBloom(i, end, begin))
 				matchingBlocks.insert(u);
-	else
+		for (auto n: matchingBlocks)
+			prependLogsFromBlock(_f, bc().numberHash(n), BlockPolarity::Live, ret);
+	}
+	else if (end <= begin)
 		// if it is a range filter, we want to get all logs from all blocks in given range
-		for (unsigned i = end; i <= begin; i++)
-			matchingBlocks.insert(i);
-
-	for (auto n: matchingBlocks)
-		prependLogsFromBlock(_f, bc().numberHash(n), BlockPolarity::Live, ret);
+		for (h256 const& h: bc().numberHashes(end, begin + 1))
+			prependLogsFromBlock(_f, h, BlockPolarity::Live, ret);
 
 	reverse(ret.begin(), ret.end());
 	return ret;
@@ -255,10 +256,12 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 void ClientBase::prependLogsFromBlock(LogFilter const& _f, h256 const& _blockHash, BlockPolarity _polarity, LocalisedLogEntries& io_logs) const
 {
 	auto receipts = bc().receipts(_blockHash).receipts;
+	auto hashes = bc().transactionHashes(_blockHash);
 	for (size_t i = 0; i < receipts.size(); i++)
 	{
 		TransactionReceipt receipt = receipts[i];
-		auto th = transaction(_blockHash, i).sha3();
+		// Receipts without a transaction (the block is missing or cut short) keep their logs, as before.
+		h256 th = i < hashes.size() ? hashes[i] : h256();
 		LogEntries le = _f.matches(receipt);
 		for (unsigned j = 0; j < le.size(); ++j)
 			io_logs.insert(io_logs.begin(), LocalisedLogEntry(le[j], _blockHash, (BlockNumber)bc().number(_blockHash), th, i, 0, _polarity));
@@ -374,10 +377,9 @@ LocalisedTransaction ClientBase::localisedTransaction(h256 const& _transactionHa
 
 Transaction ClientBase::transaction(h256 _blockHash, unsigned _i) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	if (_i < b[1].itemCount())
-		return Transaction(b[1][_i].data(), CheckTransaction::Cheap);
+	auto b = bc().indexedBlock(_blockHash);
+	if (b && _i < b->transactions.size())
+		return Transaction(b->transaction(_i), CheckTransaction::Cheap);
 	else
 		return Transaction();
 }
@@ -414,11 +416,11 @@ pair<h256, unsigned> ClientBase::transactionLocation(h256 const& _transactionHas
 
 Transactions ClientBase::transactions(h256 _blockHash) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
+	auto b = bc().indexedBlock(_blockHash);
 	Transactions res;
-	for (unsigned i = 0; i < b[1].itemCount(); i++)
-		res.emplace_back(b[1][i].data(), CheckTransaction::Cheap);
+	if (b)
+		for (size_t i = 0; i < b->transactions.size(); i++)
+			res.emplace_back(b->transaction(i), CheckTransaction::Cheap);
 	return res;
 }
 
@@ -429,10 +431,9 @@ TransactionHashes ClientBase::transactionHashes(h256 _blockHash) const
 
 BlockHeader ClientBase::uncle(h256 _blockHash, unsigned _i) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	if (_i < b[2].itemCount())
-		return BlockHeader(b[2][_i].data(), HeaderData);
+	auto b = bc().indexedBlock(_blockHash);
+	if (b && _i < b->uncles.size())
+		return BlockHeader(b->uncle(_i), HeaderData);
 	else
 		return BlockHeader();
 }
@@ -444,16 +445,14 @@ UncleHashes ClientBase::uncleHashes(h256 _blockHash) const
 
 unsigned ClientBase::transactionCount(h256 _blockHash) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	return b[1].itemCount();
+	auto b = bc().indexedBlock(_blockHash);
+	return b ? b->transactions.size() : 0;
 }
 
 unsigned ClientBase::uncleCount(h256 _blockHash) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	return b[2].itemCount();
+	auto b = bc().indexedBlock(_blockHash);
+	return b ? b->uncles.size() : 0;
 }
 
 unsigned ClientBase::number() const
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <thread>
 #include <libdevcore/Common.h>
+#include <libdevcore/RLPEncoder.h>
 #include <libp2p/Host.h>
 #include <libp2p/Session.h>
 #include <libethcore/Exceptions.h>
@@ -237,12 +238,12 @@ pair<bytes, unsigned> blockBodies(RLP const& _blockHashes) const override
 			{
 				bytes blockBytes = m_chain.block(h);
 				RLP block{blockBytes};
-				RLPStream body;
-				body.appendList(2);
-				body.appendRaw(block[1].data()); // transactions
-				body.appendRaw(block[2].data()); // uncles
-				auto bodyBytes = body.out();
-				rlp.insert(rlp.end(), bodyBytes.begin(), bodyBytes.end());
+				RLPEncoder::local().encodeInto(rlp, [&](RLPEncoder& _e)
+				{
+					_e.appendList(2);
+					_e.appendRaw(block[1].data()); // transactions
+					_e.appendRaw(block[2].data()); // uncles
+				});
 				++n;
 			}
 		}
@@ -308,7 +309,7 @@ private:
 
 EthereumHost::EthereumHost(BlockChain const& _ch, OverlayDB const& _db, TransactionQueue& _tq, BlockQueue& _bq, u256 _networkId):
 	HostCapability<EthereumPeer>(),
-	Worker		("ethsync"),
+	PooledWorker("ethsync"),
 	m_chain		(_ch),
 	m_db(_db),
 	m_tq		(_tq),
@@ -326,6 +327,8 @@ EthereumHost::EthereumHost(BlockChain const& _ch, OverlayDB const& _db, Transact
 
 EthereumHost::~EthereumHost()
 {
+	// Runs come from the pool, so make sure none is in flight while the members go.
+	stopWorking();
 }
 
 bool EthereumHost::ensureInitialised()
@@ -9,7 +9,7 @@
 #include <thread>
 
 #include <libdevcore/Guards.h>
-#include <libdevcore/Worker.h>
+#include <libdevcore/TaskScheduler.h>
 #include <libethcore/Common.h>
 #include <libp2p/Common.h>
 #include <libdevcore/OverlayDB.h>
@@ -37,7 +37,7 @@ struct EthereumHostTrace: public LogChannel { static const char* name(); static
  * @warning None of this is thread-safe. You have been warned.
  * @doWork Syncs to peers and sends new blocks and transactions.
  */
-class EthereumHost: public p2p::HostCapability<EthereumPeer>, Worker
+class EthereumHost: public p2p::HostCapability<EthereumPeer>, PooledWorker
 {
 public:
 	/// Start server, but don't listen.
@@ -0,0 +1,78 @@
+#include "ExecutedBlockCache.h"
+#include <ostream>
+#include "Block.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+ostream& dev::eth::operator<<(ostream& _out, ExecutedBlockCacheStats const& _s)
+{
+	return _out << _s.hits << " imported without executing, " << _s.reexecutions << " executed again, "
+		<< _s.dropped << " dropped, " << _s.entries << " waiting";
+}
+
+void ExecutedBlockCache::insert(Block const& _block, u256 const& _tdIncrease)
+{
+	Entry e{make_shared<Block>(_block), _tdIncrease, (unsigned)_block.info().number()};
+	h256 hash = _block.info().hash(WithoutSeal);
+	Guard l(x_entries);
+	m_entries[hash] = move(e);
+	++m_stats.inserted;
+	while (m_entries.size() > c_maxEntries)
+	{
+		auto lowest = m_entries.begin();
+		for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+			if (it->second.number < lowest->second.number)
+				lowest = it;
+		m_entries.erase(lowest);
+		++m_stats.dropped;
+	}
+}
+
+shared_ptr<Block> ExecutedBlockCache::take(BlockHeader const& _sealed, u256& o_tdIncrease)
+{
+	h256 hash = _sealed.hash(WithoutSeal);
+	Guard l(x_entries);
+	auto it = m_entries.find(hash);
+	// Not executed here, or already dropped (and counted so); either way not a re-execution to count.
+	if (it == m_entries.end())
+		return nullptr;
+	Entry e = move(it->second);
+	m_entries.erase(it);
+	if (e.block->rootHash() != _sealed.stateRoot())
+	{
+		++m_stats.reexecutions;
+		return nullptr;
+	}
+	++m_stats.hits;
+	o_tdIncrease = e.tdIncrease;
+	return e.block;
+}
+
+void ExecutedBlockCache::prune(unsigned _number)
+{
+	Guard l(x_entries);
+	for (auto it = m_entries.begin(); it != m_entries.end();)
+		if (it->second.number <= _number)
+		{
+			it = m_entries.erase(it);
+			++m_stats.dropped;
+		}
+		else
+			++it;
+}
+
+void ExecutedBlockCache::clear()
+{
+	Guard l(x_entries);
+	m_stats.dropped += m_entries.size();
+	m_entries.clear();
+}
+
+ExecutedBlockCacheStats ExecutedBlockCache::stats() const
+{
+	Guard l(x_entries);
+	ExecutedBlockCacheStats ret = m_stats;
+	ret.entries = m_entries.size();
+	return ret;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <unordered_map>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+class Block;
+class BlockHeader;
+
+struct ExecutedBlockCacheStats
+{
+	uint64_t inserted = 0;
+	uint64_t hits = 0;				///< Blocks imported without executing them again.
+	uint64_t reexecutions = 0;		///< Blocks executed here that were executed again on import, their state root not the sealed block's.
+	uint64_t dropped = 0;			///< Blocks executed but never imported: view changes, or pushed out.
+	size_t entries = 0;
+};
+
+std::ostream& operator<<(std::ostream& _out, ExecutedBlockCacheStats const& _s);
+
+/**
+ * @brief Blocks this node has executed itself, kept so that importing them does not execute them again.
+ *
+ * A PBFT leader executes the block it proposes (PBFTClient::rejigSealing()) and then imports the sealed
+ * block through the BlockQueue, which would enact it once more. Here the executed Block, its state changes
+ * still in its overlay, waits under the hash of its unsealed header, and Block::enactOn() takes it back
+ * with take() to commit it instead of enacting, provided the sealed block has that hash, passes the family
+ * checks against its parent, and the executed state has its state root. The seal only adds the PBFT signatures, which do not change what executing the block does.
+ * Blocks this node never executed (those it syncs) are not counted at all. A follower executes the block
+ * it is asked to sign in BlockChain::checkBlockValid() but does not keep it here, so it executes it again
+ * on import.
+ */
+class ExecutedBlockCache
+{
+public:
+	/// The most blocks kept; the lowest numbered go first.
+	static const size_t c_maxEntries = 8;
+
+	void insert(Block const& _block, u256 const& _tdIncrease);
+	/// @returns the block executed for @a _sealed, with @a o_tdIncrease, and forgets it; null if there is
+	/// none that matches, in which case it has to be executed (again, if it was executed here).
+	std::shared_ptr<Block> take(BlockHeader const& _sealed, u256& o_tdIncrease);
+	/// Drops the blocks numbered @a _number or lower; once one is imported the others cannot be.
+	void prune(unsigned _number);
+	void clear();
+
+	ExecutedBlockCacheStats stats() const;
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Block> block;
+		u256 tdIncrease;
+		unsigned number;
+	};
+
+	mutable Mutex x_entries;
+	std::unordered_map<h256, Entry> m_entries;		///< By the hash of the unsealed header.
+	ExecutedBlockCacheStats m_stats;				///< Guarded by x_entries; entries filled in by stats().
+};
+
+}
+}
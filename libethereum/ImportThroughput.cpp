@@ -0,0 +1,11 @@
+#include "ImportThroughput.h"
+#include <ostream>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+ostream& dev::eth::operator<<(ostream& _out, ImportThroughput const& _t)
+{
+	return _out << _t.blocks << " blocks, " << _t.transactions << " txs in " << unsigned(_t.seconds * 1000) << "ms ("
+		<< unsigned(_t.blocksPerSecond()) << " blocks/s, " << unsigned(_t.transactionsPerSecond()) << " txs/s)";
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+namespace dev
+{
+namespace eth
+{
+
+/// Blocks and transactions imported and the time it took.
+struct ImportThroughput
+{
+	uint64_t blocks = 0;
+	uint64_t transactions = 0;
+	double seconds = 0;
+
+	double blocksPerSecond() const { return seconds > 0 ? blocks / seconds : 0; }
+	double transactionsPerSecond() const { return seconds > 0 ? transactions / seconds : 0; }
+
+	ImportThroughput& operator+=(ImportThroughput const& _t) { blocks += _t.blocks; transactions += _t.transactions; seconds += _t.seconds; return *this; }
+};
+
+std::ostream& operator<<(std::ostream& _out, ImportThroughput const& _t);
+
+}
+}
@@ -38,7 +38,7 @@ bool LogFilter::isRangeFilter() const
 	return true;
 }
 
-bool LogFilter::matches(LogBloom _bloom) const
+bool LogFilter::matches(LogBloom const& _bloom) const
 {
 	if (m_addresses.size())
 	{
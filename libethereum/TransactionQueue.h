@@ -7,6 +7,8 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/Guards.h>
 #include <libdevcore/Log.h>
+#include <libdevcore/MemoryAccounting.h>
+#include <libdevcore/SmallBytes.h>
 #include <libethcore/Common.h>
 #include "Transaction.h"
 
@@ -122,7 +124,7 @@ private:
 	struct UnverifiedTransaction
 	{
 		UnverifiedTransaction() {}
-		UnverifiedTransaction(bytesConstRef const& _t, h512 const& _nodeId): transaction(_t.toBytes()), nodeId(_nodeId) {}
+		UnverifiedTransaction(bytesConstRef const& _t, h512 const& _nodeId): transaction(_t), nodeId(_nodeId) {}
 		UnverifiedTransaction(UnverifiedTransaction&& _t): transaction(std::move(_t.transaction)), nodeId(std::move(_t.nodeId)) {}
 		UnverifiedTransaction& operator=(UnverifiedTransaction&& _other)
 		{
@@ -136,7 +138,10 @@ private:
 		UnverifiedTransaction(UnverifiedTransaction const&) = delete;
 		UnverifiedTransaction& operator=(UnverifiedTransaction const&) = delete;
 
-		bytes transaction;	///< RLP encoded transaction data
+		/// Most transactions fit in place, so queueing one allocates nothing beyond the queue's own blocks.
+		static const unsigned c_inlineBytes = 256;
+
+		SmallBytes<c_inlineBytes, MemoryTag::TxQueue> transaction;	///< RLP encoded transaction data
 		h512 nodeId;		///< Network Id of the peer transaction comes from
 	};
 
@@ -185,7 +190,7 @@ struct PriorityCompare
 
 	std::condition_variable m_queueReady;										///< Signaled when m_unverified has a new entry.
 	std::vector<std::thread> m_verifiers;
-	std::deque<UnverifiedTransaction> m_unverified;								///< Pending verification queue
+	std::deque<UnverifiedTransaction, TaggedAllocator<UnverifiedTransaction, MemoryTag::TxQueue>> m_unverified;	///< Pending verification queue
 	mutable Mutex x_queue;														///< Verification queue mutex
 	std::atomic<bool> m_aborting = {false};										///< Exit condition for verifier.
 
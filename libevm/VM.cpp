@@ -6,19 +6,12 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
-uint64_t VM::memNeed(u256 _offset, u256 _size)
+uint64_t VM::memNeed(uint256 const& _offset, uint256 const& _size)
 {
-	return toInt63(_size ? u512(_offset) + _size : u512(0));
-}
-
-template <class S> S divWorkaround(S const& _a, S const& _b)
-{
-	return (S)(s512(_a) / s512(_b));
-}
-
-template <class S> S modWorkaround(S const& _a, S const& _b)
-{
-	return (S)(s512(_a) % s512(_b));
+	if (!_size)
+		return 0;
+	// each below 2^63, so the sum cannot wrap
+	return toInt63(toInt63(_offset) + toInt63(_size));
 }
 
 
@@ -122,7 +115,7 @@ void VM::updateMem(uint64_t _newMem)
 void VM::logGasMem()
 {
 	unsigned n = (unsigned)m_OP - (unsigned)Instruction::LOG0;
-	m_runGas = toInt63(m_schedule->logGas + m_schedule->logTopicGas * n + u512(m_schedule->logDataGas) * m_SP[1]);
+	m_runGas = toInt63(m_schedule->logGas + m_schedule->logTopicGas * n + u512(m_schedule->logDataGas) * u256(m_SP[1]));
 	updateMem(memNeed(m_SP[0], m_SP[1]));
 }
 
@@ -278,7 +271,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = (u256)*(h256 const*)(m_mem.data() + (unsigned)m_SP[0]);
+			m_SPP[0] = uint256::fromBigEndian(bytesConstRef(m_mem.data() + (unsigned)m_SP[0], 32));
 		}
 		NEXT
 
@@ -288,7 +281,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			*(h256*)&m_mem[(unsigned)m_SP[0]] = (h256)m_SP[1];
+			m_SP[1].toBigEndian(&m_mem[(unsigned)m_SP[0]]);
 		}
 		NEXT
 
@@ -304,14 +297,14 @@ void VM::interpretCases()
 
 		CASE(SHA3)
 		{
-			m_runGas = toInt63(m_schedule->sha3Gas + (u512(m_SP[1]) + 31) / 32 * m_schedule->sha3WordGas);
+			m_runGas = toInt63(m_schedule->sha3Gas + (u512(u256(m_SP[1])) + 31) / 32 * m_schedule->sha3WordGas);
 			updateMem(memNeed(m_SP[0], m_SP[1]));
 			ON_OP();
 			updateIOGas();
 
 			uint64_t inOff = (uint64_t)m_SP[0];
 			uint64_t inSize = (uint64_t)m_SP[1];
-			m_SPP[0] = (u256)sha3(bytesConstRef(m_mem.data() + inOff, inSize));
+			m_SPP[0] = uint256(sha3(bytesConstRef(m_mem.data() + inOff, inSize)));
 		}
 		NEXT
 
@@ -331,7 +324,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_ext->log({m_SP[2]}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
+			m_ext->log({m_SP[2].asHash()}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
 		}
 		NEXT
 
@@ -341,7 +334,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_ext->log({m_SP[2], m_SP[3]}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
+			m_ext->log({m_SP[2].asHash(), m_SP[3].asHash()}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
 		}
 		NEXT
 
@@ -351,7 +344,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_ext->log({m_SP[2], m_SP[3], m_SP[4]}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
+			m_ext->log({m_SP[2].asHash(), m_SP[3].asHash(), m_SP[4].asHash()}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
 		}
 		NEXT
 
@@ -361,18 +354,18 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_ext->log({m_SP[2], m_SP[3], m_SP[4], m_SP[5]}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
+			m_ext->log({m_SP[2].asHash(), m_SP[3].asHash(), m_SP[4].asHash(), m_SP[5].asHash()}, bytesConstRef(m_mem.data() + (uint64_t)m_SP[0], (uint64_t)m_SP[1]));
 		}
 		NEXT	
 
 		CASE(EXP)
 		{
-			u256 expon = m_SP[1];
-			m_runGas = toInt63(m_schedule->expGas + m_schedule->expByteGas * (32 - (h256(expon).firstBitSet() / 8)));
+			uint256 expon = m_SP[1];
+			m_runGas = toInt63(m_schedule->expGas + m_schedule->expByteGas * expon.byteLength());
 			ON_OP();
 			updateIOGas();
 
-			u256 base = m_SP[0];
+			uint256 base = m_SP[0];
 			m_SPP[0] = exp256(base, expon);
 		}
 		NEXT
@@ -419,7 +412,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_SP[1] ? divWorkaround(m_SP[0], m_SP[1]) : 0;
+			m_SPP[0] = m_SP[0] / m_SP[1];
 		}
 		NEXT
 
@@ -428,7 +421,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_SP[1] ? s2u(divWorkaround(u2s(m_SP[0]), u2s(m_SP[1]))) : 0;
+			m_SPP[0] = sdiv(m_SP[0], m_SP[1]);
 			--m_SP;
 		}
 		NEXT
@@ -438,7 +431,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_SP[1] ? modWorkaround(m_SP[0], m_SP[1]) : 0;
+			m_SPP[0] = m_SP[0] % m_SP[1];
 		}
 		NEXT
 
@@ -447,7 +440,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_SP[1] ? s2u(modWorkaround(u2s(m_SP[0]), u2s(m_SP[1]))) : 0;
+			m_SPP[0] = smod(m_SP[0], m_SP[1]);
 		}
 		NEXT
 
@@ -483,7 +476,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = u2s(m_SP[0]) < u2s(m_SP[1]) ? 1 : 0;
+			m_SPP[0] = slt(m_SP[0], m_SP[1]) ? 1 : 0;
 		}
 		NEXT
 
@@ -492,7 +485,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = u2s(m_SP[0]) > u2s(m_SP[1]) ? 1 : 0;
+			m_SPP[0] = sgt(m_SP[0], m_SP[1]) ? 1 : 0;
 		}
 		NEXT
 
@@ -546,7 +539,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_SP[0] < 32 ? (m_SP[1] >> (unsigned)(8 * (31 - m_SP[0]))) & 0xff : 0;
+			m_SPP[0] = m_SP[0] < 32 ? (m_SP[1] >> (8 * (31 - (unsigned)m_SP[0]))) & 0xff : 0;
 		}
 		NEXT
 
@@ -555,7 +548,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_SP[2] ? u256((u512(m_SP[0]) + u512(m_SP[1])) % m_SP[2]) : 0;
+			m_SPP[0] = addmod(m_SP[0], m_SP[1], m_SP[2]);
 		}
 		NEXT
 
@@ -564,7 +557,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_SP[2] ? u256((u512(m_SP[0]) * u512(m_SP[1])) % m_SP[2]) : 0;
+			m_SPP[0] = mulmod(m_SP[0], m_SP[1], m_SP[2]);
 		}
 		NEXT
 
@@ -573,16 +566,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			if (m_SP[0] < 31)
-			{
-				unsigned testBit = static_cast<unsigned>(m_SP[0]) * 8 + 7;
-				u256& number = m_SP[1];
-				u256 mask = ((u256(1) << testBit) - 1);
-				if (boost::multiprecision::bit_test(number, testBit))
-					number |= ~mask;
-				else
-					number &= mask;
-			}
+			m_SPP[0] = signextend(m_SP[0], m_SP[1]);
 		}
 		NEXT
 
@@ -639,15 +623,15 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			if (u512(m_SP[0]) + 31 < m_ext->data.size())
-				m_SP[0] = (u256)*(h256 const*)(m_ext->data.data() + (size_t)m_SP[0]);
+			if (m_SP[0] < m_ext->data.size() && (size_t)m_SP[0] + 32 <= m_ext->data.size())
+				m_SP[0] = uint256::fromBigEndian(m_ext->data.cropped((size_t)m_SP[0], 32));
 			else if (m_SP[0] >= m_ext->data.size())
-				m_SP[0] = u256(0);
+				m_SP[0] = 0;
 			else
 			{ 	h256 r;
 				for (uint64_t i = (uint64_t)m_SP[0], e = (uint64_t)m_SP[0] + (uint64_t)32, j = 0; i < e; ++i, ++j)
 					r[j] = i < m_ext->data.size() ? m_ext->data[i] : 0;
-				m_SP[0] = (u256)r;
+				m_SP[0] = uint256(r);
 			};
 		}
 		NEXT
@@ -731,7 +715,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = (u256)m_ext->blockHash(m_SP[0]);
+			m_SPP[0] = uint256(m_ext->blockHash(u256(m_SP[0])));
 		}
 		NEXT
 
@@ -740,7 +724,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = (u160)m_ext->envInfo().author();
+			m_SPP[0] = fromAddress(m_ext->envInfo().author());
 		}
 		NEXT
 
@@ -849,12 +833,11 @@ void VM::interpretCases()
 			updateIOGas();
 
 			int numBytes = (int)m_OP - (int)Instruction::PUSH1 + 1;
-			m_SPP[0] = 0;
 			// Construct a number out of PUSH bytes.
 			// This requires the code has been copied and extended by 32 zero
 			// bytes to handle "out of code" push data here.
-			for (++m_PC; numBytes--; ++m_PC)
-				m_SPP[0] = (m_SPP[0] << 8) | m_code[m_PC];
+			m_SPP[0] = uint256::fromBigEndian(bytesConstRef(&m_code[m_PC + 1], numBytes));
+			m_PC += numBytes + 1;
 		}
 		CONTINUE
 
@@ -1038,15 +1021,17 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_SPP[0] = m_ext->store(m_SP[0]);
+			m_SPP[0] = m_ext->store(u256(m_SP[0]));
 		}
 		NEXT
 
 		CASE(SSTORE)
 		{
-			if (!m_ext->store(m_SP[0]) && m_SP[1])
+			u256 key(m_SP[0]);
+			bool wasSet = !!m_ext->store(key);
+			if (!wasSet && m_SP[1])
 				m_runGas = toInt63(m_schedule->sstoreSetGas);
-			else if (m_ext->store(m_SP[0]) && !m_SP[1])
+			else if (wasSet && !m_SP[1])
 			{
 				m_runGas = toInt63(m_schedule->sstoreResetGas);
 				m_ext->sub.refunds += m_schedule->sstoreRefundGas;
@@ -1056,7 +1041,7 @@ void VM::interpretCases()
 			ON_OP();
 			updateIOGas();
 	
-			m_ext->setStore(m_SP[0], m_SP[1]);
+			m_ext->setStore(key, u256(m_SP[1]));
 		}
 		NEXT
 
@@ -5,6 +5,7 @@
 #include <libethcore/Common.h>
 #include <libevmcore/Instruction.h>
 #include <libdevcore/SHA3.h>
+#include <libdevcore/Uint256.h>
 #include <libethcore/BlockHeader.h>
 #include "VMFace.h"
 
@@ -21,6 +22,11 @@ inline Address asAddress(u256 _item)
 	return right160(h256(_item));
 }
 
+inline Address asAddress(uint256 const& _item)
+{
+	return right160(_item.asHash());
+}
+
 inline u256 fromAddress(Address _a)
 {
 	return (u160)_a;
@@ -41,7 +47,7 @@ public:
 #if EVM_JUMPS_AND_SUBS
 	// invalid code will throw an exeption
 	void validate(ExtVMFace& _ext);
-	void validateSubroutine(uint64_t _PC, uint64_t* _rp, u256* _sp);
+	void validateSubroutine(uint64_t _PC, uint64_t* _rp, uint256* _sp);
 #endif
 
 	bytes const& memory() const { return m_mem; }
@@ -60,7 +66,7 @@ public:
 
 	static std::array<InstructionMetric, 256> c_metrics;
 	static void initMetrics();
-	static u256 exp256(u256 _base, u256 _exponent);
+	static uint256 exp256(uint256 _base, uint256 _exponent);
 	void copyCode(int);
 	const void* const* c_jumpTable = 0;
 	bool m_caseInit = false;
@@ -81,8 +87,8 @@ public:
 	bytes m_code;
 
 	// space for data stack, grows towards smaller addresses from the end
-	u256 m_stack[1024];
-	u256 *m_stackEnd = &m_stack[1024];
+	uint256 m_stack[1024];
+	uint256 *m_stackEnd = &m_stack[1024];
 	size_t stackSize() { return m_stackEnd - m_SP; }
 	
 #if EVM_JUMPS_AND_SUBS
@@ -94,13 +100,13 @@ public:
 #endif
 
 	// constant pool
-	u256 m_pool[256];
+	uint256 m_pool[256];
 
 	// interpreter state
 	Instruction m_OP;                   // current operation
 	uint64_t    m_PC    = 0;            // program counter
-	u256*       m_SP    = m_stackEnd;   // stack pointer
-	u256*       m_SPP   = m_SP;         // stack pointer prime (next SP)
+	uint256*    m_SP    = m_stackEnd;   // stack pointer
+	uint256*    m_SPP   = m_SP;         // stack pointer prime (next SP)
 #if EVM_JUMPS_AND_SUBS
 	uint64_t*   m_RP    = m_return - 1; // return pointer
 #endif
@@ -122,8 +128,8 @@ public:
 	bool caseCallSetup(CallParameters*, bytesRef& o_output);
 	void caseCall();
 
-	void copyDataToMemory(bytesConstRef _data, u256*_sp);
-	uint64_t memNeed(u256 _offset, u256 _size);
+	void copyDataToMemory(bytesConstRef _data, uint256*_sp);
+	uint64_t memNeed(uint256 const& _offset, uint256 const& _size);
 
 	void throwOutOfGas();
 	void throwBadInstruction();
@@ -133,9 +139,9 @@ public:
 
 	std::vector<uint64_t> m_beginSubs;
 	std::vector<uint64_t> m_jumpDests;
-	int64_t verifyJumpDest(u256 const& _dest, bool _throw = true);
+	int64_t verifyJumpDest(uint256 const& _dest, bool _throw = true);
 
-	int poolConstant(const u256&);
+	int poolConstant(const uint256&);
 
 	void onOperation();
 	void adjustStack(unsigned _removed, unsigned _added);
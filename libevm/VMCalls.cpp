@@ -5,14 +5,13 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
-void VM::copyDataToMemory(bytesConstRef _data, u256*_sp)
+void VM::copyDataToMemory(bytesConstRef _data, uint256*_sp)
 {
 	auto offset = static_cast<size_t>(_sp[0]);
-	s512 bigIndex = _sp[1];
-	auto index = static_cast<size_t>(bigIndex);
+	auto index = static_cast<size_t>(_sp[1]);
 	auto size = static_cast<size_t>(_sp[2]);
 
-	size_t sizeToBeCopied = bigIndex + size > _data.size() ? _data.size() < bigIndex ? 0 : _data.size() - index : size;
+	size_t sizeToBeCopied = _sp[1] >= _data.size() ? 0 : std::min(size, _data.size() - index);
 
 	if (sizeToBeCopied > 0)
 		std::memcpy(m_mem.data() + offset, _data.data() + index, sizeToBeCopied);
@@ -66,7 +65,7 @@ void VM::throwRevertInstruction(owning_bytes_ref&& _output)
 	throw RevertInstruction(move(_output));
 }
 
-int64_t VM::verifyJumpDest(u256 const& _dest, bool _throw)
+int64_t VM::verifyJumpDest(uint256 const& _dest, bool _throw)
 {
 	// check for overflow
 	if (_dest <= 0x7FFFFFFFFFFFFFFF) {
@@ -101,7 +100,7 @@ void VM::caseCreate()
 		if (!m_schedule->staticCallDepthLimit())
 			createGas -= createGas / 64;
 		u256 gas = createGas;
-		m_SPP[0] = (u160)m_ext->create(endowment, gas, bytesConstRef(m_mem.data() + initOff, initSize), m_onOp);
+		m_SPP[0] = fromAddress(m_ext->create(u256(endowment), gas, bytesConstRef(m_mem.data() + initOff, initSize), m_onOp));
 		*m_io_gas_p -= (createGas - gas);
 		m_io_gas = uint64_t(*m_io_gas_p);
 	}
@@ -141,10 +140,10 @@ bool VM::caseCallSetup(CallParameters *callParams, bytesRef& o_output)
 		m_runGas += toInt63(m_schedule->callValueTransferGas);
 
 	size_t sizesOffset = m_OP == Instruction::DELEGATECALL ? 2 : 3;
-	u256 inputOffset  = m_SP[sizesOffset];
-	u256 inputSize    = m_SP[sizesOffset + 1];
-	u256 outputOffset = m_SP[sizesOffset + 2];
-	u256 outputSize   = m_SP[sizesOffset + 3];
+	uint256 const& inputOffset  = m_SP[sizesOffset];
+	uint256 const& inputSize    = m_SP[sizesOffset + 1];
+	uint256 const& outputOffset = m_SP[sizesOffset + 2];
+	uint256 const& outputSize   = m_SP[sizesOffset + 3];
 	uint64_t inputMemNeed = memNeed(inputOffset, inputSize);
 	uint64_t outputMemNeed = memNeed(outputOffset, outputSize);
 
@@ -156,13 +155,13 @@ bool VM::caseCallSetup(CallParameters *callParams, bytesRef& o_output)
 	if (m_schedule->staticCallDepthLimit())
 	{
 		// With static call depth limit we just charge the provided gas amount.
-		callParams->gas = m_SP[0];
+		callParams->gas = u256(m_SP[0]);
 	}
 	else
 	{
 		// Apply "all but one 64th" rule.
-		u256 maxAllowedCallGas = m_io_gas - m_io_gas / 64;
-		callParams->gas = std::min(m_SP[0], maxAllowedCallGas);
+		uint256 maxAllowedCallGas = m_io_gas - m_io_gas / 64;
+		callParams->gas = u256(std::min(m_SP[0], maxAllowedCallGas));
 	}
 
 	m_runGas = toInt63(callParams->gas);
@@ -182,7 +181,7 @@ bool VM::caseCallSetup(CallParameters *callParams, bytesRef& o_output)
 	}
 	else
 	{
-		callParams->apparentValue = callParams->valueTransfer = m_SP[2];
+		callParams->apparentValue = callParams->valueTransfer = u256(m_SP[2]);
 		inOutOffset = 1;
 	}
 
@@ -115,10 +115,10 @@ void VM::optimize()
 			const uint32_t FNV_PRIME2 = 16777619;
 			uint32_t hash = FNV_PRIME1;
 			
-			u256 (&table)[256];
+			uint256 (&table)[256];
 			bool empty[256];
 			
-			hash256(u256 (&table)[256]) : table(table)
+			hash256(uint256 (&table)[256]) : table(table)
 			{
 				for (int i = 0; i < 256; ++i)
 				{
@@ -136,7 +136,7 @@ void VM::optimize()
 			byte getHash() { return ((hash >> 8) ^ hash) & 0xff; }
 		
 			// insert value at byte index in table, false if collision
-			bool insertVal(byte hash, u256& val)
+			bool insertVal(byte hash, uint256& val)
 			{
 				if (empty[hash])
 				{
@@ -161,7 +161,7 @@ void VM::optimize()
 	TRACE_STR(1, "Do first pass optimizations")
 	for (size_t pc = 0; pc < nBytes; ++pc)
 	{
-		u256 val = 0;
+		uint256 val = 0;
 		Instruction op = Instruction(m_code[pc]);
 
 		if ((byte)Instruction::PUSH1 <= (byte)op && (byte)op <= (byte)Instruction::PUSH32)
@@ -246,21 +246,10 @@ void VM::initEntry()
 
 // Implementation of EXP.
 //
-// This implements exponentiation by squaring algorithm.
-// Is faster than boost::multiprecision::powm() because it avoids explicit
-// mod operation.
+// This implements exponentiation by squaring algorithm, see dev::exp().
 // Do not inline it.
-u256 VM::exp256(u256 _base, u256 _exponent)
+uint256 VM::exp256(uint256 _base, uint256 _exponent)
 {
-	using boost::multiprecision::limb_type;
-	u256 result = 1;
-	while (_exponent)
-	{
-		if (static_cast<limb_type>(_exponent) & 1)	// If exponent is odd.
-			result *= _base;
-		_base *= _base;
-		_exponent >>= 1;
-	}
-	return result;
+	return exp(_base, _exponent);
 }
 
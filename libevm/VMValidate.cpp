@@ -41,7 +41,7 @@ void VM::validate(ExtVMFace& _ext)
 // - PC is the offset in the code to start validating at
 // - RP is the top PC on return stack that RETURNSUB returns to
 // - SP = FP at the top level, so the stack size is also the frame size
-void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, u256* _sp)
+void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, uint256* _sp)
 {
 	// set current interpreter state
 	m_PC = _pc, m_RP = _rp, m_SP = _sp;
@@ -117,7 +117,7 @@ void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, u256* _sp)
 			for (size_t sub = 0, nSubs = m_code[m_PC+1]; sub < nSubs; ++sub)
 			{
 				// check for enough arguments on stack
-				u256 slot = sub;
+				uint256 slot = sub;
 				_sp = &slot;
 				size_t destPC = decodeJumpvDest(m_code, _pc, _sp);
 				byte nArgs = m_code[destPC+1];
@@ -32,6 +32,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/RLP.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/MemoryAccounting.h>
 #include "RLPXFrameCoder.h"
 #include "RLPXSocket.h"
 #include "Common.h"
@@ -159,7 +160,7 @@ private:
 	std::shared_ptr<RLPXSocket> m_socket;		///< Socket of peer's connection.
 	Mutex x_framing;						///< Mutex for the write queue.
 	std::deque<bytes> m_writeQueue;			///< The write queue.
-	std::vector<byte> m_data;			    ///< Buffer for ingress packet data.
+	TaggedBytes<MemoryTag::P2P> m_data;		///< Buffer for ingress packet data.
 	bytes m_incoming;						///< Read buffer for ingress bytes.
 
 	std::shared_ptr<Peer> m_peer;			///< The Peer object.
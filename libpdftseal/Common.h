@@ -1,9 +1,12 @@
 #pragma once
 
-#include <libdevcore/concurrent_queue.h>
+#include <libdevcore/BoundedQueue.h>
+#include <libdevcore/MemoryAccounting.h>
 //#include <libdevcore/easylog.h>
 #include <libdevcore/RLP.h>
+#include <libdevcore/RLPEncoder.h>
 #include <libdevcore/SHA3.h>
+#include <libdevcore/SmallBytes.h>
 #include <libdevcrypto/Common.h>
 #include <libethcore/Exceptions.h>
 
@@ -27,17 +30,20 @@ enum PBFTPacketType : byte
 
 // for pbft
 struct PBFTMsgPacket {
+	/// Sign, commit and view change messages are about 200 bytes and are kept in place; prepares carry a block.
+	static const unsigned c_inlineBytes = 224;
+
 	u256 node_idx;
 	h512 node_id;
 	unsigned packet_id;
-	bytes data; // rlp data
+	SmallBytes<c_inlineBytes, MemoryTag::Consensus> data; // rlp data
 	u256 timestamp;
 
 	PBFTMsgPacket(): node_idx(h256(0)), node_id(h512(0)), packet_id(0), timestamp(utcTime()) {}
 	PBFTMsgPacket(u256 _idx, h512 _id, unsigned _pid, bytesConstRef _data)
-		: node_idx(_idx), node_id(_id), packet_id(_pid), data(_data.toBytes()), timestamp(utcTime()) {}
+		: node_idx(_idx), node_id(_id), packet_id(_pid), data(_data), timestamp(utcTime()) {}
 };
-using PBFTMsgQueue = dev::concurrent_queue<PBFTMsgPacket>;
+using PBFTMsgQueue = dev::BoundedQueue<PBFTMsgPacket>;
 
 enum PBFTStatus
 {
@@ -85,9 +91,7 @@ struct PBFTMsg {
 	}
 
 	h256 fieldsWithoutBlock() const {
-		RLPStream ts;
-		ts << height << view << idx << timestamp;
-		return dev::sha3(ts.out());
+		return dev::sha3(RLPEncoder::local().encode([&](RLPEncoder& _e) { _e << height << view << idx << timestamp; }));
 	}
 };
 
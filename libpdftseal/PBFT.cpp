@@ -71,6 +71,15 @@ void PBFT::initEnv(std::weak_ptr<PBFTHost> _host, BlockChain* _bc, OverlayDB* _d
 }
 
 
+void PBFT::queueMsg(PBFTMsgPacket&& _p) {
+	if (m_msg_queue.pushFor(std::move(_p), std::chrono::milliseconds(kMsgQueueWait)))
+		return;
+	// log the 1st, 2nd, 4th, 8th... drop, so that a storm does not flood the log as well
+	uint64_t dropped = m_msg_queue.dropped();
+	if (!(dropped & (dropped - 1)))
+		cwarn << "PBFT msg queue full for" << kMsgQueueWait << "ms, dropped packet" << _p.packet_id << "from" << _p.node_idx << "; dropped so far:" << dropped;
+}
+
 void PBFT::initBackupDB() {
 	ldb::Options o;
 	o.max_open_files = 256;
@@ -184,6 +193,9 @@ bool PBFT::generateSeal(BlockHeader const& _bi, bytes const& _block_data, u256 &
 
 bool PBFT::generateCommit(BlockHeader const& _bi, bytes const& _block_data, u256 const& _view)
 {
+	// Don't vote for a block whose parent state may still be in flight to disk.
+	m_stateDB->waitFlushed(m_bc->info(_bi.parentHash()).stateRoot());
+
 	Guard l(m_mutex);
 
 	if (_view != m_view) {
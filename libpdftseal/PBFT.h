@@ -1,7 +1,6 @@
 #pragma once
 
 #include <set>
-#include <libdevcore/concurrent_queue.h>
 #include <libdevcore/db.h>
 #include <libdevcore/Worker.h>
 #include <libdevcrypto/Common.h>
@@ -68,6 +67,7 @@ public:
 	// report newest block 
 	void reportBlock(BlockHeader const& _b, u256 const& td);
 
+	/// Called by PBFTHost on the p2p I/O thread that read the packet; hands it to the worker through queueMsg().
 	void onPBFTMsg(unsigned _id, std::shared_ptr<p2p::Capability> _peer, RLP const& _r);
 
 	h512s getMinerNodeList() const {  /*Guard l(m_mutex);*/ return m_miner_list; }
@@ -90,6 +90,9 @@ public:
 
 	void collectGarbage();
 
+	// puts a received packet on m_msg_queue for workLoop(); see kMsgQueueWait
+	void queueMsg(PBFTMsgPacket&& _p);
+
 
 	bool getMinerList(int _blk_no, h512s & _miner_list) const;
 
@@ -202,8 +205,12 @@ private:
 	std::condition_variable m_signalled;
 	Mutex x_signalled;
 
-	// msg queue 
-	PBFTMsgQueue m_msg_queue;
+	// msg queue; fed by the p2p I/O thread (onPBFTMsg()), drained by workLoop()
+	PBFTMsgQueue m_msg_queue{kMsgQueueSize, PBFTMsgQueue::Overflow::Block};
+	static const size_t kMsgQueueSize = 8192;
+	// how long queueMsg() holds up the I/O thread, shared with every other capability, waiting for room
+	// before it drops the packet; a dropped packet costs at worst a view change
+	static const unsigned kMsgQueueWait = 50; // ms
 
 	static const unsigned kCollectInterval = 60; // second
 	static const size_t kKnownPrepare = 1024;
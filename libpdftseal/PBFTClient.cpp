@@ -61,6 +61,10 @@ void PBFTClient::init(ChainParams const& _params, p2p::Host *_host) {
 		pbft()->onPBFTMsg(_id, _peer, _r);
 	}));
 
+	// State commits stay synchronous (m_stateDB.setAsyncCommit() is off): BlockChain::import() writes the
+	// block's extras and the new head right after Block::cleanup() commits its state, without waiting for
+	// the flusher, so with async commits a crash could leave the head on a state root that is not on disk.
+
 	pbft()->initEnv(pbft_host, &m_bc, &m_stateDB, &m_bq, _host->keyPair(), static_cast<unsigned>(sealEngine()->getIntervalBlockTime()) * 3);
 	pbft()->setOmitEmptyBlock(m_omit_empty_block);
 
@@ -371,7 +375,7 @@ void PBFTClient::rejigSealing() {
 				{
 					m_working.commitToSealAfterExecTx(bc());
 
-					bc().addBlockCache(m_working, m_working.info().difficulty());
+					bc().addExecutedBlock(m_working, m_working.info().difficulty());
 
 					m_sealingInfo = m_working.info();
 					RLPStream ts2;